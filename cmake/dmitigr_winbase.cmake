@@ -25,12 +25,35 @@ dmitigr_libs_set_library_info(winbase 0 0 0 "Windows base stuff")
 # ------------------------------------------------------------------------------
 
 if (NOT WIN32)
+  # Only the tests of the portable code are built. The ones of combase.hpp are
+  # built against the portable OLE model.
+  if(DMITIGR_LIBS_TESTS)
+    find_package(Threads REQUIRED)
+    foreach(test benchmark_combase combase_array combase_binary combase_portable
+      registry)
+      set(target dmitigr_winbase_${test})
+      add_executable(${target}
+        ${CMAKE_CURRENT_LIST_DIR}/../test/winbase-unit-${test}.cpp)
+      target_compile_features(${target} PRIVATE cxx_std_20)
+      target_include_directories(${target}
+        PRIVATE ${CMAKE_CURRENT_LIST_DIR}/../test/ole_model)
+      target_link_libraries(${target} PRIVATE Threads::Threads)
+      add_test(NAME ${target} COMMAND ${target})
+    endforeach()
+    unset(target)
+  endif()
   return()
 endif()
 
 set(dmitigr_winbase_headers
   account.hpp
   combase.hpp
+  combase_binary.hpp
+  combase_date.hpp
+  combase_decimal.hpp
+  combase_guid.hpp
+  combase_memory.hpp
+  combase_native.hpp
   dialog.hpp
   error.hpp
   exceptions.hpp
@@ -40,12 +63,22 @@ set(dmitigr_winbase_headers
   ipc_wm.hpp
   iphelper.hpp
   job.hpp
+  memory.hpp
   menu.hpp
   netman.hpp
   processenv.hpp
   process.hpp
   program.hpp
   registry.hpp
+  registry_async.hpp
+  registry_backend.hpp
+  registry_batch.hpp
+  registry_hive.hpp
+  registry_image.hpp
+  registry_memory.hpp
+  registry_snapshot.hpp
+  registry_text.hpp
+  registry_value.hpp
   resource.hpp
   security.hpp
   shell.hpp
@@ -73,6 +106,8 @@ if(DMITIGR_LIBS_TESTS)
   set(CMAKE_CXX_STANDARD 20)
   set(CMAKE_CXX_STANDARD_REQUIRED ON)
 
-  set(dmitigr_winbase_tests account netman safearray wts)
-  set(dmitigr_winbase_tests_target_link_libraries dmitigr_base)
+  set(dmitigr_winbase_tests account benchmark_combase combase_array
+    combase_binary combase_portable netman registry safearray wts)
+  find_package(Threads REQUIRED)
+  set(dmitigr_winbase_tests_target_link_libraries dmitigr_base Threads::Threads)
 endif()
@@ -15,19 +15,37 @@
 // limitations under the License.
 
 #pragma once
+#ifdef _MSC_VER
 #pragma comment(lib, "ole32")
 #pragma comment(lib, "oleaut32")
+#endif
 
 #include "../base/noncopymove.hpp"
 #include "../base/traits.hpp"
+#include "combase_binary.hpp"
+#include "combase_date.hpp"
+#include "combase_decimal.hpp"
+#include "combase_guid.hpp"
+#include "combase_memory.hpp"
+#include "combase_native.hpp"
+#include "memory.hpp"
 #include "strconv.hpp"
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
 #include <new>
 #include <optional>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -103,6 +121,70 @@ private:
   T* value_{};
 };
 
+/// The memory source of `CoTaskMemAlloc()`.
+struct Taskmem_source final {
+  /// The alignment of allocated blocks.
+  static constexpr std::size_t alignment{MEMORY_ALLOCATION_ALIGNMENT};
+
+  /// @returns The block of `size` bytes, or null on failure.
+  void* allocate(const std::size_t size) const noexcept
+  {
+    return CoTaskMemAlloc(size);
+  }
+
+  /// @returns The `block` resized to `size` bytes, or null on failure.
+  void* reallocate(void* const block, const std::size_t size) const noexcept
+  {
+    return CoTaskMemRealloc(block, size);
+  }
+
+  /// Releases the `block`.
+  void deallocate(void* const block) const noexcept
+  {
+    CoTaskMemFree(block);
+  }
+};
+
+/// The memory resource of `CoTaskMemAlloc()`.
+using Taskmem_resource = Basic_memory_resource<Taskmem_source>;
+
+/**
+ * @brief The buffer to be handed over to COM.
+ *
+ * @details The result of `release()` can be owned by `Taskmem`.
+ */
+template<typename T>
+using Taskmem_buffer = Basic_outbound_buffer<T, Taskmem_source>;
+
+/// @returns The memory resource of `CoTaskMemAlloc()`.
+inline Taskmem_resource* taskmem_resource() noexcept
+{
+  static Taskmem_resource result;
+  return &result;
+}
+
+// -----------------------------------------------------------------------------
+// GUID
+// -----------------------------------------------------------------------------
+
+static_assert(sizeof(Guid) == sizeof(GUID));
+
+/// @returns The portable GUID of `id`.
+constexpr Guid to_guid(REFGUID id) noexcept
+{
+  return Guid{static_cast<std::uint32_t>(id.Data1), id.Data2, id.Data3,
+    {id.Data4[0], id.Data4[1], id.Data4[2], id.Data4[3], id.Data4[4],
+    id.Data4[5], id.Data4[6], id.Data4[7]}};
+}
+
+/// @returns The GUID of `id`.
+constexpr GUID to_com_guid(const Guid& id) noexcept
+{
+  return GUID{id.data1, id.data2, id.data3, {id.data4[0], id.data4[1],
+    id.data4[2], id.data4[3], id.data4[4], id.data4[5], id.data4[6],
+    id.data4[7]}};
+}
+
 inline auto to_com_string(REFCLSID id)
 {
   LPOLESTR str{};
@@ -119,10 +201,18 @@ inline auto to_com_string(REFCLSID id)
 // Registry
 // -----------------------------------------------------------------------------
 
+inline std::wstring server_registry_root(const Guid& id)
+{
+  constexpr std::wstring_view prefix{LR"(SOFTWARE\Classes\CLSID\)"};
+  std::wstring result(prefix.size() + guid_string_size, L'\0');
+  prefix.copy(result.data(), prefix.size());
+  to_chars(result.data() + prefix.size(), id);
+  return result;
+}
+
 inline std::wstring server_registry_root(REFCLSID id)
 {
-  return std::wstring{LR"(SOFTWARE\Classes\CLSID\)"}
-    .append(to_com_string(id).value());
+  return server_registry_root(to_guid(id));
 }
 
 inline std::wstring server_registry_localserver32(REFCLSID id)
@@ -134,14 +224,14 @@ inline std::wstring server_registry_localserver32(REFCLSID id)
 // BSTR
 // -----------------------------------------------------------------------------
 
-inline std::wstring_view to_wstring_view(const BSTR bstr)
+inline Wstring_view to_wstring_view(const BSTR bstr)
 {
   return {bstr, SysStringLen(bstr)};
 }
 
-inline std::wstring to_wstring(const BSTR bstr)
+inline Wstring to_wstring(const BSTR bstr)
 {
-  return std::wstring{to_wstring_view(bstr)};
+  return Wstring{to_wstring_view(bstr)};
 }
 
 inline std::string to_string(const BSTR bstr, const UINT code_page = CP_UTF8)
@@ -252,7 +342,7 @@ public:
     return is(VT_NULL);
   }
 
-  const BSTR as_bstr() const
+  BSTR as_bstr() const
   {
     check(VT_BSTR, "BSTR string");
     return data_.bstrVal;
@@ -270,7 +360,7 @@ public:
     return com::to_string(data_.bstrVal, CP_ACP);
   }
 
-  std::wstring as_wstring() const
+  Wstring as_wstring() const
   {
     check(VT_BSTR, "UTF-16 string");
     return com::to_wstring(data_.bstrVal);
@@ -354,7 +444,20 @@ public:
     return data_.date;
   }
 
-  const PVOID as_pvoid() const
+  Decimal as_decimal() const
+  {
+    check(VT_DECIMAL, "DECIMAL");
+    const auto& dec = data_.decVal;
+    return Decimal{dec.Lo64, dec.Hi32, dec.scale, bool(dec.sign & DECIMAL_NEG)};
+  }
+
+  Currency as_currency() const
+  {
+    check(VT_CY, "CY");
+    return Currency{data_.cyVal.int64};
+  }
+
+  PVOID as_pvoid() const
   {
     check_bits(VT_BYREF, "PVOID");
     return data_.byref;
@@ -387,7 +490,8 @@ private:
 
   template<bool, bool> friend class Basic_variant;
 
-  void copy_from(const Basic_variant& rhs)
+  template<bool IsRhsConst, bool IsRhsOwns>
+  void copy_from(const Basic_variant<IsRhsConst, IsRhsOwns>& rhs)
   {
     const auto err = VariantCopyInd(&data_, &rhs.data_);
     if (FAILED(err))
@@ -423,14 +527,13 @@ private:
   }
 };
 
-struct Date final {
-  DATE value{};
-};
 static_assert(sizeof(Date) == sizeof(DATE));
+static_assert(sizeof(Currency) == sizeof(CY));
+static_assert(sizeof(Decimal) == sizeof(DECIMAL));
 
 namespace detail {
-template<typename> struct Variant_type_traits final {
-  static_assert(false, "not specialized");
+template<typename T> struct Variant_type_traits final {
+  static_assert(false_value<T>, "not specialized");
 };
 template<> struct Variant_type_traits<std::int8_t> final {
   static constexpr const VARENUM vt{VT_I1};
@@ -468,6 +571,12 @@ template<> struct Variant_type_traits<bool> final {
 template<> struct Variant_type_traits<Date> final {
   static constexpr const VARENUM vt{VT_DATE};
 };
+template<> struct Variant_type_traits<Currency> final {
+  static constexpr const VARENUM vt{VT_CY};
+};
+template<> struct Variant_type_traits<Decimal> final {
+  static constexpr const VARENUM vt{VT_DECIMAL};
+};
 template<> struct Variant_type_traits<PVOID> final {
   static constexpr const VARENUM vt{VT_BYREF};
 };
@@ -475,50 +584,94 @@ template<typename Ch, class Tr, class Al>
 struct Variant_type_traits<std::basic_string<Ch, Tr, Al>> final {
   static constexpr const VARENUM vt{VT_BSTR};
 };
-} // namespace detail
 
-/**
- * @param flags Flags which are passed to Basic_variant::to_variant().
- *
- * @returns The value of type `T` coerced from `variant`.
- */
+/// @returns `true` if the SAFEARRAY elements of `vt` can be accessed as `T`.
+template<typename T>
+constexpr bool is_element_vartype(const VARTYPE vt) noexcept
+{
+  using D = std::remove_cv_t<T>;
+  using std::is_same_v;
+  if constexpr (is_same_v<D, float>)
+    return vt == VT_R4;
+  else if constexpr (is_same_v<D, double>) // DATE is double
+    return vt == VT_R8 || vt == VT_DATE;
+  else if constexpr (is_same_v<D, Date>)
+    return vt == VT_DATE;
+  else if constexpr (is_same_v<D, CY> || is_same_v<D, Currency>)
+    return vt == VT_CY;
+  else if constexpr (is_same_v<D, DECIMAL> || is_same_v<D, Decimal>)
+    return vt == VT_DECIMAL;
+  else if constexpr (std::is_integral_v<D> && !is_same_v<D, bool>) {
+    constexpr bool is_signed{std::is_signed_v<D>};
+    if constexpr (sizeof(D) == 1)
+      return vt == (is_signed ? VT_I1 : VT_UI1);
+    else if constexpr (sizeof(D) == 2) // VARIANT_BOOL is short
+      return is_signed ? vt == VT_I2 || vt == VT_BOOL : vt == VT_UI2;
+    else if constexpr (sizeof(D) == 4)
+      return is_signed ? vt == VT_I4 || vt == VT_INT || vt == VT_ERROR :
+        vt == VT_UI4 || vt == VT_UINT;
+    else if constexpr (sizeof(D) == 8)
+      return vt == (is_signed ? VT_I8 : VT_UI8);
+    else
+      static_assert(false_value<T>);
+  } else
+    static_assert(false_value<T>);
+}
+
+/// @returns The value of type `T` stored in `variant` without coercion.
 template<typename T, bool IsConst, bool IsOwns>
-T to(const Basic_variant<IsConst, IsOwns>& variant, const USHORT flags = {})
+T as(const Basic_variant<IsConst, IsOwns>& variant)
 {
   using D = std::decay_t<T>;
   using std::is_same_v;
-  const auto var = variant.to_variant(detail::Variant_type_traits<T>::vt, flags);
   if constexpr (is_same_v<D, bool>)
-    return var.as_bool();
+    return variant.as_bool();
   else if constexpr (is_same_v<D, Date>)
-    return Date{var.as_date()};
+    return Date{variant.as_date()};
+  else if constexpr (is_same_v<D, Currency>)
+    return variant.as_currency();
+  else if constexpr (is_same_v<D, Decimal>)
+    return variant.as_decimal();
   else if constexpr (is_same_v<D, std::int8_t>)
-    return var.as_int8();
+    return variant.as_int8();
   else if constexpr (is_same_v<D, std::uint8_t>)
-    return var.as_uint8();
+    return variant.as_uint8();
   else if constexpr (is_same_v<D, std::int16_t>)
-    return var.as_int16();
+    return variant.as_int16();
   else if constexpr (is_same_v<D, std::uint16_t>)
-    return var.as_uint16();
+    return variant.as_uint16();
   else if constexpr (is_same_v<D, std::int32_t>)
-    return var.as_int32();
+    return variant.as_int32();
   else if constexpr (is_same_v<D, std::uint32_t>)
-    return var.as_uint32();
+    return variant.as_uint32();
   else if constexpr (is_same_v<D, std::int64_t>)
-    return var.as_int64();
+    return variant.as_int64();
   else if constexpr (is_same_v<D, std::uint64_t>)
-    return var.as_uint64();
+    return variant.as_uint64();
   else if constexpr (is_same_v<D, float>)
-    return var.as_real32();
+    return variant.as_real32();
   else if constexpr (is_same_v<D, double>)
-    return var.as_real64();
+    return variant.as_real64();
   else if constexpr (is_same_v<D, std::string>)
-    return var.as_string_utf8();
-  else if constexpr (is_same_v<D, std::wstring>)
-    return var.as_wstring();
+    return variant.as_string_utf8();
+  else if constexpr (is_same_v<D, Wstring>)
+    return variant.as_wstring();
   else
     static_assert(false_value<T>);
 }
+} // namespace detail
+
+/**
+ * @param flags Flags which are passed to Basic_variant::to_variant().
+ *
+ * @returns The value of type `T` coerced from `variant`.
+ */
+template<typename T, bool IsConst, bool IsOwns>
+T to(const Basic_variant<IsConst, IsOwns>& variant, const USHORT flags = {})
+{
+  return detail::as<T>(variant.to_variant(detail::Variant_type_traits<T>::vt,
+    flags));
+}
 
 // -----------------------------------------------------------------------------
 // SAFEARRAY
@@ -570,12 +723,9 @@ public:
     copy_from(rhs);
   }
 
-  /// Copies the instance.
-  template<bool IsRhsConst, bool IsRhsOwns,
-    typename = std::enable_if_t<IsOwns == IsRhsOwns || !IsOwns && IsRhsOwns>>
+  /// Copies the instance (and the underlying data if `IsOwns`).
   Basic_safe_array(const Basic_safe_array& rhs)
   {
-    static_assert(IsOwns || IsConst || !IsRhsConst);
     if constexpr (IsOwns)
       copy_from(rhs);
     else
@@ -583,9 +733,7 @@ public:
   }
 
   /// Copy-assignable.
-  template<bool IsRhsConst, bool IsRhsOwns,
-    typename = std::enable_if_t<IsOwns == IsRhsOwns || !IsOwns && IsRhsOwns>>
-  Basic_safe_array& operator=(const Basic_safe_array<IsRhsConst, IsRhsOwns>& rhs)
+  Basic_safe_array& operator=(const Basic_safe_array& rhs)
   {
     Basic_safe_array tmp{rhs};
     swap(tmp);
@@ -593,18 +741,13 @@ public:
   }
 
   /// Move-constructible.
-  template<bool IsRhsConst, bool IsRhsOwns,
-    typename = std::enable_if_t<IsOwns == IsRhsOwns>>
   Basic_safe_array(Basic_safe_array&& rhs) noexcept
     : data_{rhs.data_}
   {
-    static_assert(IsConst || !IsRhsConst);
     rhs.data_ = {};
   }
 
   /// Move-assignable.
-  template<bool IsRhsConst, bool IsRhsOwns,
-    typename = std::enable_if_t<IsOwns == IsRhsOwns>>
   Basic_safe_array& operator=(Basic_safe_array&& rhs) noexcept
   {
     Basic_safe_array tmp{std::move(rhs)};
@@ -620,7 +763,7 @@ public:
   }
 
   // Forward declaration of an array slice.
-  template<bool IsConst> class Basic_slice;
+  template<bool IsSliceConst> class Basic_slice;
 
   /// A modifiable slice.
   using Slice = Basic_slice<false>;
@@ -629,7 +772,7 @@ public:
   using Const_slice = Basic_slice<true>;
 
   /// An array slice.
-  template<bool IsConst>
+  template<bool IsSliceConst>
   class Basic_slice final : Noncopymove {
   public:
     /// Decrements the lock count of the array.
@@ -651,7 +794,6 @@ public:
       using std::is_same_v;
       using D = std::decay_t<T>;
       USHORT feat{};
-      const char* msg{};
       if constexpr (is_same_v<D, BSTR>)
         feat = FADF_BSTR;
       else if constexpr (is_same_v<D, IUnknown>)
@@ -668,13 +810,39 @@ public:
     }
 
     /// @overload
-    template<typename T>
+    template<typename T, bool IsMutable = !IsSliceConst,
+      typename = std::enable_if_t<IsMutable>>
     T* array()
     {
-      static_assert(!IsConst);
       return const_cast<T*>(static_cast<const Basic_slice*>(this)->array<T>());
     }
 
+    /**
+     * @tparam T An integral type (except `bool`: use `VARIANT_BOOL` instead),
+     * `float`, `double`, `Date`, `CY`, `DECIMAL`, `Currency` or `Decimal`.
+     *
+     * @returns The elements of the underlying part of array which is
+     * represented by this slice. The span is valid while this slice is alive.
+     *
+     * @throws `std::runtime_error` if `T` doesn't match the VARTYPE or the
+     * element size of the array.
+     */
+    template<typename T>
+    std::span<const T> span() const
+    {
+      self_.template check_element_type<T>("cannot get span of requested type");
+      return {static_cast<const T*>(self_.data().pvData) + absolute_offset_, size_};
+    }
+
+    /// @overload
+    template<typename T, bool IsMutable = !IsSliceConst,
+      typename = std::enable_if_t<IsMutable>>
+    std::span<T> span()
+    {
+      const auto result = static_cast<const Basic_slice*>(this)->span<T>();
+      return {const_cast<T*>(result.data()), result.size()};
+    }
+
     /// @returns An instance of Variant at the specified `index`.
     Const_variant_view variant(const std::size_t index) const
     {
@@ -682,9 +850,10 @@ public:
     }
 
     /// @overload
+    template<bool IsMutable = !IsSliceConst,
+      typename = std::enable_if_t<IsMutable>>
     Variant_view variant(const std::size_t index)
     {
-      static_assert(!IsConst);
       return Variant_view{array<VARIANT>()[index]};
     }
 
@@ -729,9 +898,10 @@ public:
     }
 
     /// @overload
+    template<bool IsMutable = !IsSliceConst,
+      typename = std::enable_if_t<IsMutable>>
     Slice slice(const std::size_t index)
     {
-      static_assert(!IsConst);
       return make_slice<Slice>(index);
     }
 
@@ -780,6 +950,157 @@ public:
     }
   };
 
+  /**
+   * @brief A multi-dimensional view of the array in the style of `std::mdspan`
+   * with `std::layout_left`.
+   *
+   * @details Dimensions are numbered as in `SafeArrayGetElement()`, so the
+   * first dimension varies fastest. The array is locked once for the lifetime
+   * of the view.
+   *
+   * @tparam T The element type, possibly const-qualified.
+   * @tparam Rank The dimension count.
+   */
+  template<typename T, std::size_t Rank>
+  class Md_view final : Noncopymove {
+    static_assert(Rank > 0);
+  public:
+    /// Decrements the lock count of the array.
+    ~Md_view()
+    {
+      SafeArrayUnlock(array_);
+    }
+
+    /// @returns The dimension count.
+    static constexpr std::size_t rank() noexcept
+    {
+      return Rank;
+    }
+
+    /// @returns The element count of dimension `d`.
+    std::size_t extent(const std::size_t d) const noexcept
+    {
+      return extents_[d];
+    }
+
+    /// @returns The distance between adjacent elements of dimension `d`.
+    std::size_t stride(const std::size_t d) const noexcept
+    {
+      return strides_[d];
+    }
+
+    /// @returns The lower bound of dimension `d`.
+    LONG lower_bound(const std::size_t d) const noexcept
+    {
+      return lower_bounds_[d];
+    }
+
+    /// @returns The total element count.
+    std::size_t size() const noexcept
+    {
+      return size_;
+    }
+
+    /// @returns The pointer to the first element.
+    T* data_handle() const noexcept
+    {
+      return data_;
+    }
+
+    /// @returns All the elements in memory order.
+    std::span<T> elements() const noexcept
+    {
+      return {data_, size_};
+    }
+
+    /// @returns The element at the zero-based `indices` (unchecked).
+    template<typename ... Indices>
+    T& operator()(const Indices ... indices) const noexcept
+    {
+      static_assert(sizeof...(Indices) == Rank);
+      std::size_t offset{};
+      std::size_t d{};
+      ((offset += static_cast<std::size_t>(indices)*strides_[d++]), ...);
+      return data_[offset];
+    }
+
+    /**
+     * @returns The element at the `indices` counted from the lower bounds as
+     * in `SafeArrayGetElement()`.
+     *
+     * @throws `std::out_of_range` if any of `indices` is out of bounds.
+     */
+    template<typename ... Indices>
+    T& at(const Indices ... indices) const
+    {
+      static_assert(sizeof...(Indices) == Rank);
+      std::size_t offset{};
+      std::size_t d{};
+      const auto add = [this, &offset, &d](const LONG index)
+      {
+        const auto i = std::int64_t{index} - lower_bounds_[d];
+        if (i < 0 || !(static_cast<std::uint64_t>(i) < extents_[d]))
+          throw std::out_of_range{"Safe_array index out of range"};
+        offset += static_cast<std::size_t>(i)*strides_[d++];
+      };
+      (add(static_cast<LONG>(indices)), ...);
+      return data_[offset];
+    }
+
+  private:
+    friend Basic_safe_array;
+
+    SAFEARRAY* array_{};
+    T* data_{};
+    std::size_t size_{1};
+    std::array<std::size_t, Rank> extents_{};
+    std::array<std::size_t, Rank> strides_{};
+    std::array<LONG, Rank> lower_bounds_{};
+
+    /// Increments the lock count of the array.
+    explicit Md_view(SAFEARRAY& array)
+      : array_{&array}
+    {
+      if (array_->cDims != Rank)
+        throw std::invalid_argument{"cannot create Safe_array::Md_view:"
+          " dimension count mismatch"};
+      else if (FAILED(SafeArrayLock(array_)))
+        throw std::runtime_error{"cannot create Safe_array::Md_view:"
+          " cannot lock SAFEARRAY"};
+
+      // The bounds are stored in the reverse order of dimensions.
+      for (std::size_t d{}; d < Rank; ++d) {
+        const auto& bound = array_->rgsabound[Rank - 1 - d];
+        extents_[d] = bound.cElements;
+        lower_bounds_[d] = bound.lLbound;
+        strides_[d] = size_;
+        size_ *= bound.cElements;
+      }
+      data_ = static_cast<T*>(array_->pvData);
+    }
+  };
+
+  /**
+   * @tparam T Any type accepted by Basic_slice::span() or Basic_slice::array().
+   *
+   * @returns The multi-dimensional view of the array.
+   */
+  template<typename T, std::size_t Rank>
+  Md_view<const T, Rank> md_view() const
+  {
+    check_element_type<T>("cannot create Safe_array::Md_view: type mismatch");
+    return Md_view<const T, Rank>{const_cast<SAFEARRAY&>(data())};
+  }
+
+  /// @overload
+  template<typename T, std::size_t Rank>
+  Md_view<T, Rank> md_view()
+  {
+    static_assert(!IsConst);
+    check_element_type<T>("cannot create Safe_array::Md_view: type mismatch");
+    return Md_view<T, Rank>{data()};
+  }
+
   /// @returns The VARTYPE stored in the underlying safe array.
   std::optional<VARTYPE> vartype() const
   {
@@ -861,10 +1182,50 @@ public:
     return data_;
   }
 
+  /**
+   * @returns The underlying data.
+   *
+   * @par Effects
+   * `!data_ptr()`. The caller is responsible for destroying the result.
+   */
+  SAFEARRAY* release() noexcept
+  {
+    static_assert(IsOwns);
+    return std::exchange(data_, nullptr);
+  }
+
 private:
+  template<bool, bool> friend class Basic_safe_array;
+
   SAFEARRAY* data_{};
 
-  void copy_from(Basic_safe_array& rhs)
+  /// @throws `std::runtime_error` with `what` if elements are not of type `T`.
+  template<typename T>
+  void check_element_type(const char* const what) const
+  {
+    using D = std::remove_cv_t<T>;
+    using std::is_same_v;
+    bool is_match{};
+    if constexpr (is_same_v<D, VARIANT>)
+      is_match = bool(features() & FADF_VARIANT);
+    else if constexpr (is_same_v<D, BSTR>)
+      is_match = bool(features() & FADF_BSTR);
+    else if constexpr (is_same_v<D, IUnknown*>)
+      is_match = bool(features() & (FADF_UNKNOWN | FADF_DISPATCH));
+    else if constexpr (is_same_v<D, IDispatch*>)
+      is_match = bool(features() & FADF_DISPATCH);
+    else {
+      const auto vt = vartype();
+      is_match = element_size() == sizeof(T) && (vt ?
+        detail::is_element_vartype<T>(*vt) : !bool(features() &
+          (FADF_BSTR | FADF_UNKNOWN | FADF_DISPATCH | FADF_VARIANT | FADF_RECORD)));
+    }
+    if (!is_match)
+      throw std::runtime_error{what};
+  }
+
+  template<bool IsRhsConst, bool IsRhsOwns>
+  void copy_from(const Basic_safe_array<IsRhsConst, IsRhsOwns>& rhs)
   {
     if (rhs.data_) {
       const auto err = SafeArrayCopy(rhs.data_, &data_);
@@ -894,4 +1255,1820 @@ Safe_array_view Basic_variant<IsConst, IsOwns>::as_array()
   return Safe_array_view{data_.parray};
 }
 
+// -----------------------------------------------------------------------------
+// VARIANT visitation
+// -----------------------------------------------------------------------------
+
+/// The value of VARIANT of type `VT_NULL`.
+struct Null final {};
+
+/// The helper to combine lambdas into a visitor.
+template<class ... Ts>
+struct Overloaded final : Ts... {
+  using Ts::operator()...;
+};
+
+template<class ... Ts>
+Overloaded(Ts...) -> Overloaded<Ts...>;
+
+namespace detail {
+/// The number of base VARTYPEs the visitation table is built for.
+constexpr std::size_t visit_table_width{VT_UINT + 1};
+
+/// @returns The pointer to the value referenced by `var`.
+template<typename T>
+T* byref(const VARIANT& var) noexcept
+{
+  return static_cast<T*>(var.byref);
+}
+
+/**
+ * @returns The result of `f` invoked with the value of `var` of type `Vt`.
+ *
+ * @par Requires
+ * `var.vt == Vt`.
+ */
+template<bool IsConst, VARTYPE Vt, class R, class F>
+R visit_entry(const VARIANT& var, F& f)
+{
+  using Array_view = std::conditional_t<IsConst, Const_safe_array_view,
+    Safe_array_view>;
+  using Var_view = std::conditional_t<IsConst, Const_variant_view,
+    Variant_view>;
+  constexpr VARTYPE t{Vt & VT_TYPEMASK};
+  constexpr bool is_byref{bool(Vt & VT_BYREF)};
+  if constexpr (bool(Vt & VT_ARRAY))
+    return f(Array_view{is_byref ? *var.pparray : var.parray});
+  else if constexpr (t == VT_I1)
+    return is_byref ? f(byref<std::int8_t>(var)) : f(std::int8_t(var.cVal));
+  else if constexpr (t == VT_UI1)
+    return is_byref ? f(byref<std::uint8_t>(var)) : f(std::uint8_t(var.bVal));
+  else if constexpr (t == VT_I2)
+    return is_byref ? f(byref<std::int16_t>(var)) : f(std::int16_t(var.iVal));
+  else if constexpr (t == VT_UI2)
+    return is_byref ? f(byref<std::uint16_t>(var)) :
+      f(std::uint16_t(var.uiVal));
+  else if constexpr (t == VT_I4)
+    return is_byref ? f(byref<std::int32_t>(var)) : f(std::int32_t(var.lVal));
+  else if constexpr (t == VT_INT)
+    return is_byref ? f(byref<std::int32_t>(var)) : f(std::int32_t(var.intVal));
+  else if constexpr (t == VT_UI4)
+    return is_byref ? f(byref<std::uint32_t>(var)) :
+      f(std::uint32_t(var.ulVal));
+  else if constexpr (t == VT_UINT)
+    return is_byref ? f(byref<std::uint32_t>(var)) :
+      f(std::uint32_t(var.uintVal));
+  else if constexpr (t == VT_I8)
+    return is_byref ? f(byref<std::int64_t>(var)) : f(std::int64_t(var.llVal));
+  else if constexpr (t == VT_UI8)
+    return is_byref ? f(byref<std::uint64_t>(var)) :
+      f(std::uint64_t(var.ullVal));
+  else if constexpr (t == VT_R4)
+    return is_byref ? f(byref<float>(var)) : f(float(var.fltVal));
+  else if constexpr (t == VT_R8)
+    return is_byref ? f(byref<double>(var)) : f(double(var.dblVal));
+  else if constexpr (t == VT_BOOL)
+    return is_byref ? f(byref<VARIANT_BOOL>(var)) :
+      f(var.boolVal != VARIANT_FALSE);
+  else if constexpr (t == VT_DATE)
+    return is_byref ? f(byref<Date>(var)) : f(Date{var.date});
+  else if constexpr (t == VT_CY)
+    return is_byref ? f(byref<CY>(var)) : f(var.cyVal);
+  else if constexpr (t == VT_DECIMAL)
+    return is_byref ? f(byref<DECIMAL>(var)) : f(var.decVal);
+  else if constexpr (t == VT_BSTR)
+    return is_byref ? f(byref<BSTR>(var)) : f(to_wstring_view(var.bstrVal));
+  else if constexpr (t == VT_DISPATCH)
+    return is_byref ? f(byref<IDispatch*>(var)) : f(var.pdispVal);
+  else if constexpr (t == VT_UNKNOWN)
+    return is_byref ? f(byref<IUnknown*>(var)) : f(var.punkVal);
+  else if constexpr (t == VT_VARIANT && is_byref)
+    return f(byref<VARIANT>(var));
+  else if constexpr (t == VT_EMPTY && !is_byref)
+    return f(Empty{});
+  else if constexpr (t == VT_NULL && !is_byref)
+    return f(Null{});
+  else
+    return f(Var_view{var});
+}
+
+/// @returns The table of visit_entry() indexed by the VARTYPE.
+template<bool IsConst, class R, class F, std::size_t ... I>
+constexpr auto make_visit_table(std::index_sequence<I...>) noexcept
+{
+  constexpr auto w = visit_table_width;
+  return std::array<R(*)(const VARIANT&, F&), sizeof...(I)>{
+    &visit_entry<IsConst, static_cast<VARTYPE>(I % w |
+      (I / w == 1 ? VT_BYREF : I / w == 2 ? VT_ARRAY | VT_BYREF :
+        I / w == 3 ? VT_ARRAY : 0)), R, F>...};
+}
+
+template<bool IsConst, class F>
+decltype(auto) visit(const VARIANT& var, F&& f)
+{
+  using R = std::invoke_result_t<F&, Empty>;
+  constexpr auto w = visit_table_width;
+  static constexpr auto table = make_visit_table<IsConst, R, F>(
+    std::make_index_sequence<4*w>{});
+  const VARTYPE t = var.vt & VT_TYPEMASK;
+  const VARTYPE flags = var.vt & ~VT_TYPEMASK;
+  const std::size_t mode = flags == VT_BYREF ? 1 :
+    flags == (VT_ARRAY | VT_BYREF) ? 2 : flags == VT_ARRAY ? 3 : 0;
+  if (t < w && (!flags || mode))
+    return table[mode*w + t](var, f);
+  else
+    return visit_entry<IsConst, VT_ILLEGALMASKED, R>(var, f);
+}
+} // namespace detail
+
+/**
+ * @brief Invokes `f` with the value of `variant`.
+ *
+ * @details The dispatching is done via the table indexed by VARTYPE, so no
+ * type checks are repeated and nothing is allocated. `f` is invoked with:
+ *   - `Empty` or `Null` for `VT_EMPTY` or `VT_NULL`;
+ *   - `std::int8_t`, ..., `std::uint64_t`, `float`, `double`, `bool`, `Date`,
+ *   `CY` or `DECIMAL` for numeric types (`VT_INT` and `VT_UINT` are passed as
+ *   `std::int32_t` and `std::uint32_t`);
+ *   - `Wstring_view` for `VT_BSTR`;
+ *   - `IDispatch*` or `IUnknown*` for `VT_DISPATCH` or `VT_UNKNOWN`;
+ *   - the pointer to the referenced value for `VT_BYREF` forms (`BSTR*` and
+ *   `VARIANT_BOOL*` for strings and booleans, `VARIANT*` for `VT_VARIANT`);
+ *   - the view of SAFEARRAY for `VT_ARRAY` forms (with or without `VT_BYREF`);
+ *   - the view of `variant` itself for other types (e.g. `VT_ERROR`).
+ *
+ * @returns The result of `f`. All the overloads of `f` must return the type
+ * which is returned for `Empty`.
+ *
+ * @see Overloaded.
+ */
+template<class F, bool IsConst, bool IsOwns>
+decltype(auto) visit(const Basic_variant<IsConst, IsOwns>& variant, F&& f)
+{
+  return detail::visit<true>(variant.data(), f);
+}
+
+/// @overload
+template<class F, bool IsConst, bool IsOwns>
+decltype(auto) visit(Basic_variant<IsConst, IsOwns>& variant, F&& f)
+{
+  return detail::visit<IsConst>(std::as_const(variant).data(), f);
+}
+
+// -----------------------------------------------------------------------------
+// BSTR allocators
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief The string allocator of combase_memory.hpp which allocates BSTRs by
+ * `SysAllocStringLen()` and releases them by `SysFreeString()`.
+ */
+struct Bstr_allocator final {
+  /// @returns The new BSTR of `size` characters copied from `data`.
+  BSTR allocate(const OLECHAR* const data, const std::size_t size) const
+  {
+    if (size > std::numeric_limits<UINT>::max())
+      throw std::bad_alloc{};
+    const BSTR result{SysAllocStringLen(data, static_cast<UINT>(size))};
+    if (!result)
+      throw std::bad_alloc{};
+    return result;
+  }
+
+  /// Releases `bstr`.
+  void deallocate(const BSTR bstr) const noexcept
+  {
+    SysFreeString(bstr);
+  }
+};
+
+/// The allocator which reuses the released BSTRs.
+using Bstr_pool = Basic_string_pool<OLECHAR, Bstr_allocator>;
+
+/**
+ * @brief The allocator of BSTRs released all at once.
+ *
+ * @warning The BSTRs allocated by this allocator must not be passed to
+ * `SysFreeString()`.
+ */
+using Bstr_arena = Basic_string_arena<OLECHAR>;
+
+// -----------------------------------------------------------------------------
+// SAFEARRAY (bulk conversions)
+// -----------------------------------------------------------------------------
+
+namespace detail {
+/// @returns The VARTYPE of SAFEARRAY elements of type `T`.
+template<typename T>
+constexpr VARENUM element_vartype() noexcept
+{
+  using std::is_same_v;
+  if constexpr (is_same_v<T, float>)
+    return VT_R4;
+  else if constexpr (is_same_v<T, double>)
+    return VT_R8;
+  else if constexpr (is_same_v<T, Date>)
+    return VT_DATE;
+  else if constexpr (is_same_v<T, CY> || is_same_v<T, Currency>)
+    return VT_CY;
+  else if constexpr (is_same_v<T, DECIMAL> || is_same_v<T, Decimal>)
+    return VT_DECIMAL;
+  else if constexpr (std::is_integral_v<T> && !is_same_v<T, bool>) {
+    constexpr bool is_signed{std::is_signed_v<T>};
+    if constexpr (sizeof(T) == 1)
+      return is_signed ? VT_I1 : VT_UI1;
+    else if constexpr (sizeof(T) == 2)
+      return is_signed ? VT_I2 : VT_UI2;
+    else if constexpr (sizeof(T) == 4)
+      return is_signed ? VT_I4 : VT_UI4;
+    else if constexpr (sizeof(T) == 8)
+      return is_signed ? VT_I8 : VT_UI8;
+    else
+      static_assert(false_value<T>);
+  } else
+    static_assert(false_value<T>);
+}
+
+/// `true` if to() accepts `T`.
+template<typename T>
+constexpr bool is_coercible_v{std::is_same_v<T, bool> ||
+  std::is_same_v<T, Date> || std::is_same_v<T, Currency> ||
+  std::is_same_v<T, Decimal> || std::is_same_v<T, std::int8_t> ||
+  std::is_same_v<T, std::uint8_t> || std::is_same_v<T, std::int16_t> ||
+  std::is_same_v<T, std::uint16_t> || std::is_same_v<T, std::int32_t> ||
+  std::is_same_v<T, std::uint32_t> || std::is_same_v<T, std::int64_t> ||
+  std::is_same_v<T, std::uint64_t> || std::is_same_v<T, float> ||
+  std::is_same_v<T, double> || std::is_same_v<T, std::string> ||
+  std::is_same_v<T, Wstring>};
+
+/**
+ * @returns The value of type `T` read right from the union member of `var`.
+ *
+ * @par Requires
+ * `var.vt == Variant_type_traits<T>::vt`.
+ */
+template<typename T>
+T payload(const VARIANT& var)
+{
+  using std::is_same_v;
+  if constexpr (is_same_v<T, bool>)
+    return var.boolVal == VARIANT_TRUE;
+  else if constexpr (is_same_v<T, Date>)
+    return Date{var.date};
+  else if constexpr (is_same_v<T, Currency>)
+    return Currency{var.cyVal.int64};
+  else if constexpr (is_same_v<T, Decimal>) {
+    const auto& dec = var.decVal;
+    return Decimal{dec.Lo64, dec.Hi32, dec.scale, bool(dec.sign & DECIMAL_NEG)};
+  } else if constexpr (is_same_v<T, std::int8_t>)
+    return static_cast<std::int8_t>(var.cVal);
+  else if constexpr (is_same_v<T, std::uint8_t>)
+    return var.bVal;
+  else if constexpr (is_same_v<T, std::int16_t>)
+    return var.iVal;
+  else if constexpr (is_same_v<T, std::uint16_t>)
+    return var.uiVal;
+  else if constexpr (is_same_v<T, std::int32_t>)
+    return var.lVal;
+  else if constexpr (is_same_v<T, std::uint32_t>)
+    return var.ulVal;
+  else if constexpr (is_same_v<T, std::int64_t>)
+    return var.llVal;
+  else if constexpr (is_same_v<T, std::uint64_t>)
+    return var.ullVal;
+  else if constexpr (is_same_v<T, float>)
+    return var.fltVal;
+  else if constexpr (is_same_v<T, double>)
+    return var.dblVal;
+  else // the strings are converted anyway
+    return as<T>(Const_variant_view{var});
+}
+
+/**
+ * @returns The number of UTF-16 code units needed to represent the valid
+ * UTF-8 string `utf8`.
+ */
+inline std::size_t utf16_size(const std::string_view utf8) noexcept
+{
+  std::size_t result{};
+  for (const auto ch : utf8) {
+    const auto b = static_cast<unsigned char>(ch);
+    result += ((b & 0xC0) != 0x80) + (b >= 0xF0);
+  }
+  return result;
+}
+
+/**
+ * @returns The new BSTR with the content of UTF-8 string `utf8` allocated by
+ * `allocator`.
+ */
+template<class A>
+BSTR make_bstr(const std::string_view utf8, A& allocator)
+{
+  static const auto throw_error = []
+  {
+    throw std::runtime_error{"cannot convert an UTF-8 string to BSTR"};
+  };
+
+  const std::size_t size{utf16_size(utf8)};
+  if (size > static_cast<std::size_t>(std::numeric_limits<int>::max()))
+    throw_error();
+
+  const BSTR result{allocator.allocate(nullptr, size)};
+  if (std::all_of(utf8.begin(), utf8.end(),
+      [](const char ch){return !(static_cast<unsigned char>(ch) & 0x80);})) {
+    // ASCII: no need to involve the converter.
+    std::transform(utf8.begin(), utf8.end(), result, [](const char ch)
+    {
+      return static_cast<OLECHAR>(static_cast<unsigned char>(ch));
+    });
+  } else if (size) {
+    const int rs = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS,
+      utf8.data(), static_cast<int>(utf8.size()),
+      result, static_cast<int>(size));
+    if (static_cast<std::size_t>(rs) != size) {
+      allocator.deallocate(result);
+      throw_error();
+    }
+  }
+  return result;
+}
+
+/// @returns The new BSTR with the content of UTF-8 string `utf8`.
+inline BSTR make_bstr(const std::string_view utf8)
+{
+  Bstr_allocator allocator;
+  return make_bstr(utf8, allocator);
+}
+} // namespace detail
+
+/**
+ * @brief Returns the BSTRs of `array` to `allocator` and nulls them, so the
+ * array can be destroyed without `SysFreeString()` calls.
+ *
+ * @par Requires
+ * The BSTRs of `array` must be allocated by `allocator`.
+ */
+template<class A, bool IsConst, bool IsOwns>
+void release_bstrs(Basic_safe_array<IsConst, IsOwns>& array, A& allocator)
+{
+  auto slice = array.slice();
+  const auto bstrs = slice.template array<BSTR>();
+  for (std::size_t i{}; i < slice.size(); ++i) {
+    allocator.deallocate(bstrs[i]);
+    bstrs[i] = nullptr;
+  }
+}
+
+/**
+ * @brief A Safe_array of BSTRs allocated by `A` which returns them to the
+ * allocator on destruction.
+ *
+ * @tparam A The string allocator, such as Bstr_pool or Bstr_arena.
+ *
+ * @remarks The allocator must outlive this instance.
+ */
+template<class A>
+class Allocated_safe_array final : private Noncopy {
+public:
+  /// Returns the BSTRs to the allocator and destroys the array.
+  ~Allocated_safe_array()
+  {
+    if (array_.data_ptr() && bool(array_.features() & FADF_BSTR))
+      release_bstrs(array_, *allocator_);
+  }
+
+  /**
+   * @brief The constructor.
+   *
+   * @par Requires
+   * The BSTRs of `array` must be allocated by `allocator`.
+   */
+  Allocated_safe_array(Safe_array&& array, A& allocator) noexcept
+    : array_{std::move(array)}
+    , allocator_{&allocator}
+  {}
+
+  /// Move-constructible.
+  Allocated_safe_array(Allocated_safe_array&& rhs) noexcept = default;
+
+  /**
+   * @returns The view of the array.
+   *
+   * @remarks The array is not exposed mutably, since the BSTRs must not be
+   * replaced or released other than by the allocator.
+   */
+  Const_safe_array_view view() const noexcept
+  {
+    return Const_safe_array_view{const_cast<SAFEARRAY*>(array_.data_ptr())};
+  }
+
+  /// @returns The underlying data.
+  const SAFEARRAY* data_ptr() const noexcept
+  {
+    return array_.data_ptr();
+  }
+
+private:
+  Safe_array array_;
+  A* allocator_{};
+};
+
+namespace detail {
+/// @returns The one-dimensional array of `elements`.
+template<typename T, class A>
+Safe_array to_safe_array(const std::span<const T> elements, A& allocator)
+{
+  using std::is_same_v;
+  using D = std::remove_cv_t<T>;
+  constexpr bool is_string{is_same_v<D, std::string> ||
+    is_same_v<D, std::string_view>};
+  constexpr bool is_wstring{is_same_v<D, Wstring> ||
+    is_same_v<D, Wstring_view>};
+
+  if (elements.size() > std::numeric_limits<ULONG>::max())
+    throw std::invalid_argument{"cannot create Safe_array: too many elements"};
+
+  const VARTYPE vt = [&]
+  {
+    if constexpr (is_string || is_wstring)
+      return VT_BSTR;
+    else if constexpr (is_same_v<D, bool>)
+      return VT_BOOL;
+    else
+      return element_vartype<D>();
+  }();
+  Safe_array result{vt, {SAFEARRAYBOUND{static_cast<ULONG>(elements.size()), 0}}};
+  if (elements.empty())
+    return result;
+
+  auto slice = result.slice();
+  if constexpr (is_string || is_wstring) {
+    const auto bstrs = slice.template array<BSTR>();
+    try {
+      for (std::size_t i{}; i < elements.size(); ++i) {
+        const auto& e = elements[i];
+        if constexpr (is_string)
+          bstrs[i] = make_bstr(e, allocator);
+        else
+          bstrs[i] = allocator.allocate(e.data(), e.size());
+      }
+    } catch (...) {
+      for (std::size_t i{}; i < elements.size(); ++i) {
+        allocator.deallocate(bstrs[i]);
+        bstrs[i] = nullptr;
+      }
+      throw;
+    }
+  } else if constexpr (is_same_v<D, bool>) {
+    std::transform(elements.begin(), elements.end(),
+      slice.template span<VARIANT_BOOL>().begin(), [](const bool e)
+      {
+        return e ? VARIANT_TRUE : VARIANT_FALSE;
+      });
+  } else
+    std::memcpy(slice.template span<D>().data(), elements.data(),
+      elements.size_bytes());
+  return result;
+}
+} // namespace detail
+
+/**
+ * @brief Creates the one-dimensional array of `elements`.
+ *
+ * @details The array is filled under the single lock: the elements of
+ * fixed-size types are copied by `std::memcpy()`, `bool` is converted to
+ * `VARIANT_BOOL`, and strings are converted to BSTR. The UTF-16 sizes of UTF-8
+ * strings are computed up front, so each string is converted at most once
+ * right into its BSTR, and ASCII strings are just widened.
+ *
+ * @tparam T An integral type, `bool`, `float`, `double`, `Date`, `CY`,
+ * `DECIMAL`, `Currency`, `Decimal`, `std::string`, `std::string_view`,
+ * `Wstring` or `Wstring_view`.
+ */
+template<typename T>
+Safe_array to_safe_array(const std::span<const T> elements)
+{
+  Bstr_allocator allocator;
+  return detail::to_safe_array(elements, allocator);
+}
+
+/// @overload
+template<typename T, class A>
+Safe_array to_safe_array(const std::vector<T, A>& elements)
+{
+  return to_safe_array(std::span<const T>{elements});
+}
+
+/**
+ * @brief Creates the one-dimensional array of `elements` with the BSTRs
+ * allocated by `allocator`.
+ *
+ * @tparam A The string allocator, such as Bstr_pool or Bstr_arena.
+ *
+ * @see to_safe_array().
+ */
+template<typename T, class A>
+Allocated_safe_array<A> to_safe_array(const std::span<const T> elements,
+  A& allocator)
+{
+  return {detail::to_safe_array(elements, allocator), allocator};
+}
+
+namespace detail {
+/**
+ * @returns The locked descriptor of the array of `bounds` (in the order of
+ * dimensions) over `data`.
+ *
+ * @see release_borrowed_descriptor().
+ */
+inline SAFEARRAY* make_borrowed_descriptor(const VARTYPE vt,
+  const ULONG element_size, const std::span<const SAFEARRAYBOUND> bounds,
+  void* const data)
+{
+  SAFEARRAY* result{};
+  if (FAILED(SafeArrayAllocDescriptorEx(vt, static_cast<UINT>(bounds.size()),
+        &result)))
+    throw std::runtime_error{"cannot allocate SAFEARRAY descriptor"};
+
+  // The bounds are stored in the reverse order of dimensions.
+  for (std::size_t d{}; d < bounds.size(); ++d)
+    result->rgsabound[bounds.size() - 1 - d] = bounds[d];
+  result->cbElements = element_size;
+  result->fFeatures |= FADF_AUTO | FADF_FIXEDSIZE;
+  result->pvData = data;
+  if (FAILED(SafeArrayLock(result))) {
+    result->pvData = nullptr;
+    SafeArrayDestroyDescriptor(result);
+    throw std::runtime_error{"cannot lock SAFEARRAY"};
+  }
+  return result;
+}
+
+/// Releases the descriptor made by make_borrowed_descriptor().
+inline void release_borrowed_descriptor(SAFEARRAY* const array) noexcept
+{
+  SafeArrayUnlock(array);
+  array->pvData = nullptr;
+  // If the callee still holds a lock the descriptor is leaked.
+  SafeArrayDestroyDescriptor(array);
+}
+} // namespace detail
+
+/**
+ * @brief An array over the elements owned by the caller, which are exposed to
+ * COM without copying.
+ *
+ * @details The descriptor is allocated by `SafeArrayAllocDescriptorEx()` and
+ * has `FADF_AUTO` and `FADF_FIXEDSIZE` features, so neither the destruction
+ * of the array nor `SafeArrayRedim()` touch the elements. (`FADF_STATIC` is
+ * not used since `SafeArrayDestroy()` zeroes such arrays.) The array is locked
+ * for the lifetime of the instance, so the callee can't destroy it.
+ *
+ * @tparam T An integral type, `float`, `double`, `Date`, `CY`, `DECIMAL`,
+ * `Currency` or `Decimal`.
+ *
+ * @remarks The elements must outlive this instance, and the callee must not
+ * retain the array after the call (it can copy it by `SafeArrayCopy()`).
+ */
+template<typename T>
+class Borrowed_safe_array final : private Noncopymove {
+public:
+  /// Releases the descriptor.
+  ~Borrowed_safe_array()
+  {
+    detail::release_borrowed_descriptor(data_);
+  }
+
+  /**
+   * @brief Constructs the one-dimensional array over `elements`.
+   *
+   * @param lower_bound The lower bound of the array.
+   */
+  explicit Borrowed_safe_array(const std::span<T> elements,
+    const LONG lower_bound = 0)
+    : Borrowed_safe_array{elements, {SAFEARRAYBOUND{
+        static_cast<ULONG>(elements.size()), lower_bound}}}
+  {}
+
+  /**
+   * @brief Constructs the multi-dimensional array over `elements`.
+   *
+   * @param bounds The bounds of each dimension as for `SafeArrayCreate()`.
+   * (Thus, `elements` are in the memory order with the first dimension
+   * varying fastest.)
+   */
+  Borrowed_safe_array(const std::span<T> elements,
+    const std::vector<SAFEARRAYBOUND>& bounds)
+  {
+    static_assert(!std::is_const_v<T>);
+    std::size_t size{1};
+    for (const auto& bound : bounds)
+      size *= bound.cElements;
+    if (bounds.empty() || size != elements.size() ||
+      bounds.size() > std::numeric_limits<USHORT>::max())
+      throw std::invalid_argument{"cannot create Borrowed_safe_array:"
+        " invalid bounds"};
+
+    data_ = detail::make_borrowed_descriptor(detail::element_vartype<T>(),
+      sizeof(T), bounds, elements.data());
+  }
+
+  /// @overload
+  template<class A>
+  explicit Borrowed_safe_array(std::vector<T, A>& elements,
+    const LONG lower_bound = 0)
+    : Borrowed_safe_array{std::span<T>{elements}, lower_bound}
+  {}
+
+  /// Borrowing of the temporary is prohibited.
+  template<class A>
+  Borrowed_safe_array(std::vector<T, A>&&, LONG = 0) = delete;
+
+  /// @returns The view of the array.
+  Safe_array_view view() const noexcept
+  {
+    return Safe_array_view{data_};
+  }
+
+  /// @returns The underlying data.
+  SAFEARRAY* data_ptr() const noexcept
+  {
+    return data_;
+  }
+
+private:
+  SAFEARRAY* data_{};
+};
+
+/// The signature of the VARIANT coercion routine, such as VariantChangeType().
+using Variant_change_type = decltype(&VariantChangeType);
+
+/**
+ * @brief Replaces the content of `result` with the VARIANTs of `slice`
+ * coerced to `T`.
+ *
+ * @details The VARTYPEs of the column are scanned once by the branchless
+ * loop. If all of them are equal to the VARTYPE of `T`, the payloads are just
+ * copied out of the VARIANTs. Otherwise, only the mismatching elements are
+ * coerced by `change_type`.
+ *
+ * @tparam T Any type accepted by to().
+ * @tparam S Basic_safe_array::Basic_slice.
+ *
+ * @param flags Flags which are passed to `change_type`.
+ * @param change_type The coercion routine.
+ *
+ * @throws `std::runtime_error` if `slice` doesn't represent VARIANTs or if
+ * an element can't be coerced.
+ */
+template<typename T, class S>
+void to_column(const S& slice, std::vector<T>& result, const USHORT flags = {},
+  const Variant_change_type change_type = VariantChangeType)
+{
+  static_assert(detail::is_coercible_v<T>);
+  constexpr VARTYPE vt{detail::Variant_type_traits<T>::vt};
+  const auto variants = slice.template array<VARIANT>();
+  const std::size_t size{slice.size()};
+
+  std::size_t mismatch_count{};
+  for (std::size_t i{}; i < size; ++i)
+    mismatch_count += variants[i].vt != vt;
+
+  result.clear();
+  result.reserve(size);
+  if (!mismatch_count) {
+    for (std::size_t i{}; i < size; ++i)
+      result.push_back(detail::payload<T>(variants[i]));
+    return;
+  }
+
+  for (std::size_t i{}; i < size; ++i) {
+    if (variants[i].vt == vt) {
+      result.push_back(detail::payload<T>(variants[i]));
+      continue;
+    }
+
+    Variant coerced;
+    if (change_type(&coerced.data(), &variants[i], flags, vt) != S_OK)
+      throw std::runtime_error{"cannot convert VARIANT to VARIANT"};
+    result.push_back(detail::as<T>(coerced));
+  }
+}
+
+/// @overload
+template<typename T, class S>
+std::vector<T> to_column(const S& slice, const USHORT flags = {},
+  const Variant_change_type change_type = VariantChangeType)
+{
+  std::vector<T> result;
+  to_column(slice, result, flags, change_type);
+  return result;
+}
+
+/**
+ * @brief Replaces the content of `result` with the elements of `array` in
+ * memory order (i.e. the first dimension varies fastest).
+ *
+ * @details The elements are read under the single lock. The elements of
+ * fixed-size types are copied by `std::memcpy()`, BSTRs are converted to
+ * strings, and VARIANTs are coerced to `T` by to_column().
+ *
+ * @tparam T Any type accepted by to_safe_array() except the string views.
+ * VARIANTs can be coerced only to the types accepted by to().
+ *
+ * @param flags Flags which are passed to to_column() if `array` contains
+ * VARIANTs.
+ *
+ * @throws `std::runtime_error` if the elements of `array` can't be represented
+ * as `T`.
+ */
+template<typename T, bool IsConst, bool IsOwns>
+void to_vector(const Basic_safe_array<IsConst, IsOwns>& array,
+  std::vector<T>& result, const USHORT flags = {})
+{
+  using std::is_same_v;
+  result.clear();
+  if (!array.data_ptr())
+    return;
+
+  const auto slice = array.slice();
+  const std::size_t size{slice.size()};
+  if (bool(array.features() & FADF_VARIANT)) {
+    if constexpr (detail::is_coercible_v<T>)
+      to_column(slice, result, flags);
+    else
+      throw std::runtime_error{"cannot coerce VARIANT to requested type"};
+  } else if constexpr (is_same_v<T, std::string> || is_same_v<T, Wstring>) {
+    result.reserve(size);
+    const auto bstrs = slice.template array<BSTR>();
+    for (std::size_t i{}; i < size; ++i) {
+      if constexpr (is_same_v<T, std::string>)
+        result.push_back(to_string(bstrs[i]));
+      else
+        result.emplace_back(to_wstring_view(bstrs[i]));
+    }
+  } else if constexpr (is_same_v<T, bool>) {
+    const auto bools = slice.template span<VARIANT_BOOL>();
+    result.assign(bools.begin(), bools.end());
+  } else {
+    const auto elements = slice.template span<T>();
+    result.resize(elements.size());
+    if (!elements.empty())
+      std::memcpy(result.data(), elements.data(), elements.size_bytes());
+  }
+}
+
+/// @overload
+template<typename T, bool IsConst, bool IsOwns>
+std::vector<T> to_vector(const Basic_safe_array<IsConst, IsOwns>& array,
+  const USHORT flags = {})
+{
+  std::vector<T> result;
+  to_vector(array, result, flags);
+  return result;
+}
+
+/**
+ * @brief UTF-8 strings stored contiguously.
+ *
+ * @details The strings are converted from BSTRs in a batch: the buffer is
+ * sized once by using the lengths stored in the BSTR prefixes, and then each
+ * BSTR is converted right into the buffer (ASCII strings are just narrowed).
+ */
+class Utf8_arena final {
+public:
+  /// Constructs the empty instance.
+  Utf8_arena() = default;
+
+  /// Constructs the instance with the content of `bstrs`.
+  explicit Utf8_arena(const std::span<const BSTR> bstrs)
+  {
+    assign(bstrs);
+  }
+
+  /// Replaces the content with the content of `bstrs`.
+  void assign(const std::span<const BSTR> bstrs)
+  {
+    std::size_t capacity{};
+    for (const auto bstr : bstrs)
+      capacity += SysStringLen(bstr);
+    // A UTF-16 code unit takes at most 3 bytes in UTF-8.
+    buffer_.resize(3*capacity);
+    offsets_.resize(bstrs.size() + 1);
+
+    std::size_t offset{};
+    for (std::size_t i{}; i < bstrs.size(); ++i) {
+      offsets_[i] = offset;
+      const Wstring_view str{to_wstring_view(bstrs[i])};
+      if (std::all_of(str.begin(), str.end(),
+          [](const OLECHAR ch){return ch < 0x80;})) {
+        std::transform(str.begin(), str.end(), buffer_.data() + offset,
+          [](const OLECHAR ch){return static_cast<char>(ch);});
+        offset += str.size();
+      } else {
+        const auto max = static_cast<std::size_t>(
+          std::numeric_limits<int>::max());
+        if (str.size() > max)
+          throw std::runtime_error{"cannot convert BSTR to UTF-8: too long"};
+        const int rs = WideCharToMultiByte(CP_UTF8, 0,
+          str.data(), static_cast<int>(str.size()),
+          buffer_.data() + offset,
+          static_cast<int>(std::min(buffer_.size() - offset, max)),
+          nullptr, nullptr);
+        if (!rs)
+          throw std::runtime_error{"cannot convert BSTR to UTF-8"};
+        offset += rs;
+      }
+    }
+    offsets_.back() = offset;
+    buffer_.resize(offset);
+  }
+
+  /// @returns The number of strings.
+  std::size_t size() const noexcept
+  {
+    return offsets_.empty() ? 0 : offsets_.size() - 1;
+  }
+
+  /// @returns `size() == 0`.
+  bool is_empty() const noexcept
+  {
+    return !size();
+  }
+
+  /// @returns The string at `index`.
+  std::string_view operator[](const std::size_t index) const noexcept
+  {
+    return {buffer_.data() + offsets_[index],
+      offsets_[index + 1] - offsets_[index]};
+  }
+
+  /// @returns All the strings concatenated.
+  std::string_view buffer() const noexcept
+  {
+    return buffer_;
+  }
+
+  /**
+   * @returns The offsets of strings in buffer() followed by the size of
+   * buffer(). (The span is empty if the content was never assigned.)
+   */
+  std::span<const std::size_t> offsets() const noexcept
+  {
+    return offsets_;
+  }
+
+  /// Clears the instance.
+  void clear() noexcept
+  {
+    buffer_.clear();
+    offsets_.clear();
+  }
+
+private:
+  std::string buffer_;
+  std::vector<std::size_t> offsets_;
+};
+
+/// @returns The UTF-8 arena with the BSTRs of `array` in memory order.
+template<bool IsConst, bool IsOwns>
+Utf8_arena to_utf8_arena(const Basic_safe_array<IsConst, IsOwns>& array)
+{
+  const auto slice = array.slice();
+  return Utf8_arena{{slice.template array<BSTR>(), slice.size()}};
+}
+
+// -----------------------------------------------------------------------------
+// VARIANT binary codec
+// -----------------------------------------------------------------------------
+
+static_assert(sizeof(OLECHAR) == sizeof(char16_t));
+
+namespace detail {
+/// The maximum nesting depth of arrays of VARIANTs which can be decoded.
+inline constexpr unsigned max_binary_depth{64};
+
+/// @returns The size of value of `vt`, or zero if `vt` is not fixed-size.
+constexpr std::size_t fixed_size(const VARTYPE vt) noexcept
+{
+  switch (vt) {
+  case VT_I1: case VT_UI1:
+    return 1;
+  case VT_I2: case VT_UI2: case VT_BOOL:
+    return 2;
+  case VT_I4: case VT_UI4: case VT_INT: case VT_UINT: case VT_R4:
+  case VT_ERROR:
+    return 4;
+  case VT_I8: case VT_UI8: case VT_R8: case VT_CY: case VT_DATE:
+    return 8;
+  case VT_DECIMAL:
+    return sizeof(DECIMAL);
+  default:
+    return 0;
+  }
+}
+
+/// @returns `true` if the arrays of `vt` can be encoded.
+constexpr bool is_binary_element_vartype(const VARTYPE vt) noexcept
+{
+  return fixed_size(vt) || vt == VT_BSTR || vt == VT_VARIANT;
+}
+
+[[noreturn]] inline void throw_unsupported_binary_type()
+{
+  throw std::runtime_error{"cannot encode VARIANT of unsupported type"};
+}
+
+[[noreturn]] inline void throw_invalid_binary_type()
+{
+  throw std::runtime_error{"cannot decode VARIANT: invalid type"};
+}
+
+inline void encode_string(Binary_writer& writer, const BSTR bstr)
+{
+  if (bstr)
+    writer.write_string(reinterpret_cast<const char16_t*>(bstr),
+      SysStringLen(bstr));
+  else
+    writer.write_null_string();
+}
+
+inline void encode_value(Binary_writer& writer, const VARIANT& value);
+
+/// Encodes the bounds and the elements of `array` of `vt`.
+inline void encode_array(Binary_writer& writer, const VARTYPE vt,
+  const Const_safe_array_view& array)
+{
+  if (!array.data_ptr())
+    throw std::runtime_error{"cannot encode null SAFEARRAY"};
+  else if (!is_binary_element_vartype(vt))
+    throw_unsupported_binary_type();
+
+  // The bounds are stored in the reverse order of dimensions.
+  const USHORT dimension_count{array.dimension_count()};
+  std::vector<Binary_bound> bounds(dimension_count);
+  for (USHORT d{}; d < dimension_count; ++d) {
+    const auto& bound = array.data().rgsabound[dimension_count - 1 - d];
+    bounds[d] = {bound.cElements, bound.lLbound};
+  }
+  writer.write_bounds(bounds);
+
+  const auto slice = array.slice();
+  const std::size_t size{slice.size()};
+  if (const auto element_size = fixed_size(vt)) {
+    if (array.element_size() != element_size)
+      throw std::runtime_error{"cannot encode SAFEARRAY:"
+        " element size mismatch"};
+    writer.write_fixed(array.data().pvData, element_size, size);
+  } else if (vt == VT_BSTR) {
+    const auto bstrs = slice.template array<BSTR>();
+    for (std::size_t i{}; i < size; ++i)
+      encode_string(writer, bstrs[i]);
+  } else {
+    const auto variants = slice.template array<VARIANT>();
+    for (std::size_t i{}; i < size; ++i)
+      encode_value(writer, variants[i]);
+  }
+}
+
+/// Encodes `value` with the `VT_BYREF` forms dereferenced.
+inline void encode_value(Binary_writer& writer, const VARIANT& value)
+{
+  const bool is_byref(value.vt & VT_BYREF);
+  const VARTYPE vt(value.vt & ~VT_BYREF);
+  if (vt == VT_VARIANT) {
+    if (!is_byref)
+      throw_unsupported_binary_type();
+    return encode_value(writer, *value.pvarVal);
+  } else if (vt & VT_ARRAY) {
+    writer.write_type(vt);
+    encode_array(writer, vt & VT_TYPEMASK,
+      Const_safe_array_view{is_byref ? *value.pparray : value.parray});
+  } else if (vt == VT_EMPTY || vt == VT_NULL) {
+    writer.write_type(vt);
+  } else if (vt == VT_BSTR) {
+    writer.write_type(vt);
+    encode_string(writer, is_byref ? *value.pbstrVal : value.bstrVal);
+  } else if (vt == VT_DECIMAL) {
+    auto dec = is_byref ? *value.pdecVal : value.decVal;
+    dec.wReserved = 0; // overlaps VARIANT::vt
+    writer.write_type(vt);
+    writer.write_fixed(&dec, sizeof(dec));
+  } else if (const auto size = fixed_size(vt)) {
+    writer.write_type(vt);
+    writer.write_fixed(is_byref ? value.byref : &value.llVal, size);
+  } else
+    throw_unsupported_binary_type();
+}
+
+/**
+ * @returns The bounds of array read from `reader` in the order of dimensions,
+ * and the element count.
+ */
+inline std::pair<std::vector<SAFEARRAYBOUND>, std::size_t>
+read_bounds(Binary_reader& reader)
+{
+  const auto bounds = reader.read_bounds();
+  std::vector<SAFEARRAYBOUND> result(bounds.size());
+  std::size_t count{1};
+  for (std::size_t d{}; d < bounds.size(); ++d) {
+    const auto [cnt, lower_bound] = bounds[d];
+    // Each element takes at least one byte.
+    if (cnt && count > reader.remaining_size() / cnt)
+      throw std::runtime_error{"cannot decode SAFEARRAY: truncated data"};
+    count *= cnt;
+    result[d] = {cnt, lower_bound};
+  }
+  return {std::move(result), count};
+}
+
+inline BSTR decode_string(Binary_reader& reader)
+{
+  const auto bytes = reader.read_string_bytes();
+  if (!bytes)
+    return nullptr;
+
+  const auto result = SysAllocStringLen(nullptr,
+    static_cast<UINT>(bytes->size() / sizeof(OLECHAR)));
+  if (!result)
+    throw std::bad_alloc{};
+  if (!bytes->empty())
+    std::memcpy(result, bytes->data(), bytes->size());
+  return result;
+}
+
+inline SAFEARRAY* decode_array(Binary_reader& reader, VARTYPE vt,
+  unsigned depth);
+
+/**
+ * @brief Decodes the value to `result`.
+ *
+ * @par Requires
+ * `result` must be empty.
+ */
+inline void decode_value(Binary_reader& reader, VARIANT& result,
+  const unsigned depth)
+{
+  const VARTYPE vt{reader.read_type()};
+  if (vt & VT_ARRAY) {
+    if (vt & ~(VT_ARRAY | VT_TYPEMASK))
+      throw_invalid_binary_type();
+    result.parray = decode_array(reader, vt & VT_TYPEMASK, depth);
+  } else if (vt == VT_BSTR)
+    result.bstrVal = decode_string(reader);
+  else if (vt == VT_DECIMAL)
+    std::memcpy(&result.decVal, reader.read_fixed(sizeof(DECIMAL)).data(),
+      sizeof(DECIMAL));
+  else if (const auto size = fixed_size(vt))
+    std::memcpy(&result.llVal, reader.read_fixed(size).data(), size);
+  else if (vt != VT_EMPTY && vt != VT_NULL)
+    throw_invalid_binary_type();
+  result.vt = vt;
+}
+
+/// @returns The array of `vt` decoded from `reader`.
+inline SAFEARRAY* decode_array(Binary_reader& reader, const VARTYPE vt,
+  const unsigned depth)
+{
+  if (depth > max_binary_depth)
+    throw std::runtime_error{"cannot decode SAFEARRAY: too deep nesting"};
+  else if (!is_binary_element_vartype(vt))
+    throw_invalid_binary_type();
+
+  auto [bounds, count] = read_bounds(reader);
+  const auto element_size = fixed_size(vt);
+  const auto elements = element_size ?
+    reader.read_fixed(element_size, count) : std::span<const std::byte>{};
+  Safe_array result{vt, std::move(bounds)};
+  {
+    auto slice = result.slice();
+    if (element_size) {
+      if (!elements.empty())
+        std::memcpy(result.data().pvData, elements.data(), elements.size());
+    } else if (vt == VT_BSTR) {
+      const auto bstrs = slice.template array<BSTR>();
+      for (std::size_t i{}; i < count; ++i)
+        bstrs[i] = decode_string(reader);
+    } else {
+      const auto variants = slice.template array<VARIANT>();
+      for (std::size_t i{}; i < count; ++i)
+        decode_value(reader, variants[i], depth + 1);
+    }
+  }
+  return result.release();
+}
+} // namespace detail
+
+/**
+ * @brief Appends `value` in the binary format to `writer`.
+ *
+ * @details The `VT_BYREF` forms are encoded as the values they refer to.
+ *
+ * @throws `std::runtime_error` if `value` is (or contains) an interface or a
+ * record. (The content of `writer` is unspecified in this case.)
+ */
+template<bool IsConst, bool IsOwns>
+void encode(Binary_writer& writer, const Basic_variant<IsConst, IsOwns>& value)
+{
+  detail::encode_value(writer, value.data());
+}
+
+/// @overload
+template<bool IsConst, bool IsOwns>
+void encode(Binary_writer& writer,
+  const Basic_safe_array<IsConst, IsOwns>& array)
+{
+  const Const_safe_array_view view{const_cast<SAFEARRAY*>(array.data_ptr())};
+  VARTYPE vt{};
+  if (!view.data_ptr())
+    throw std::runtime_error{"cannot encode null SAFEARRAY"};
+  else if (const auto array_vt = view.vartype())
+    vt = *array_vt;
+  else if (bool(view.features() & FADF_BSTR))
+    vt = VT_BSTR;
+  else if (bool(view.features() & FADF_VARIANT))
+    vt = VT_VARIANT;
+  else
+    detail::throw_unsupported_binary_type();
+  writer.write_type(VT_ARRAY | vt);
+  detail::encode_array(writer, vt, view);
+}
+
+/**
+ * @returns The value read from `reader`.
+ *
+ * @throws `std::runtime_error` if the data is invalid or truncated.
+ */
+inline Variant decode_variant(Binary_reader& reader)
+{
+  Variant result;
+  detail::decode_value(reader, result.data(), 0);
+  return result;
+}
+
+/**
+ * @returns The array read from `reader`.
+ *
+ * @throws `std::runtime_error` if the data is invalid or truncated, or if the
+ * value is not an array.
+ */
+inline Safe_array decode_safe_array(Binary_reader& reader)
+{
+  const VARTYPE vt{reader.read_type()};
+  if (!(vt & VT_ARRAY) || (vt & ~(VT_ARRAY | VT_TYPEMASK)))
+    throw std::runtime_error{"cannot decode SAFEARRAY: not an array"};
+  return Safe_array{detail::decode_array(reader, vt & VT_TYPEMASK, 0)};
+}
+
+/**
+ * @brief A VARIANT decoded from the binary format without copying.
+ *
+ * @details The BSTRs point right into the buffer, and the arrays are the
+ * descriptors with `FADF_AUTO` feature over the buffer (as Borrowed_safe_array).
+ * Only the arrays of BSTRs and VARIANTs allocate memory for the elements.
+ * Thus, the buffer must be aligned to 8 (see Binary_reader::is_aligned()).
+ *
+ * @warning The value is read-only and is valid while both the buffer and this
+ * instance are alive. It must not be freed or retained by the callee.
+ */
+class Binary_variant_view final : private Noncopymove {
+public:
+  /**
+   * @brief Decodes the value read from `reader`.
+   *
+   * @throws `std::invalid_argument` if `!reader.is_aligned()`, or
+   * `std::runtime_error` if the data is invalid or truncated.
+   */
+  explicit Binary_variant_view(Binary_reader& reader)
+  {
+    if (!reader.is_aligned())
+      throw std::invalid_argument{"cannot decode binary VARIANT view:"
+        " misaligned buffer"};
+    decode(reader, value_, 0);
+  }
+
+  /// @returns The view of the value.
+  Const_variant_view value() const noexcept
+  {
+    return Const_variant_view{value_};
+  }
+
+private:
+  struct Descriptor_deleter final {
+    void operator()(SAFEARRAY* const array) const noexcept
+    {
+      detail::release_borrowed_descriptor(array);
+    }
+  };
+
+  VARIANT value_{};
+  std::vector<std::unique_ptr<SAFEARRAY, Descriptor_deleter>> arrays_;
+  std::vector<std::unique_ptr<BSTR[]>> bstrs_;
+  std::vector<std::unique_ptr<VARIANT[]>> variants_;
+
+  static BSTR decode_string(Binary_reader& reader)
+  {
+    const auto str = reader.read_string();
+    return str ? const_cast<BSTR>(reinterpret_cast<const OLECHAR*>(
+        str->data())) : nullptr;
+  }
+
+  void decode(Binary_reader& reader, VARIANT& result, const unsigned depth)
+  {
+    const VARTYPE vt{reader.read_type()};
+    if (vt & VT_ARRAY) {
+      if (vt & ~(VT_ARRAY | VT_TYPEMASK))
+        detail::throw_invalid_binary_type();
+      result.parray = decode_array(reader, vt & VT_TYPEMASK, depth);
+    } else if (vt == VT_BSTR)
+      result.bstrVal = decode_string(reader);
+    else if (vt == VT_DECIMAL)
+      std::memcpy(&result.decVal, reader.read_fixed(sizeof(DECIMAL)).data(),
+        sizeof(DECIMAL));
+    else if (const auto size = detail::fixed_size(vt))
+      std::memcpy(&result.llVal, reader.read_fixed(size).data(), size);
+    else if (vt != VT_EMPTY && vt != VT_NULL)
+      detail::throw_invalid_binary_type();
+    result.vt = vt;
+  }
+
+  SAFEARRAY* decode_array(Binary_reader& reader, const VARTYPE vt,
+    const unsigned depth)
+  {
+    if (depth > detail::max_binary_depth)
+      throw std::runtime_error{"cannot decode SAFEARRAY: too deep nesting"};
+    else if (!detail::is_binary_element_vartype(vt))
+      detail::throw_invalid_binary_type();
+
+    const auto [bounds, count] = detail::read_bounds(reader);
+    ULONG element_size(detail::fixed_size(vt));
+    void* data{};
+    if (element_size)
+      data = const_cast<std::byte*>(
+        reader.read_fixed(element_size, count).data());
+    else if (vt == VT_BSTR) {
+      element_size = sizeof(BSTR);
+      auto& bstrs = bstrs_.emplace_back(std::make_unique<BSTR[]>(count));
+      for (std::size_t i{}; i < count; ++i)
+        bstrs[i] = decode_string(reader);
+      data = bstrs.get();
+    } else {
+      element_size = sizeof(VARIANT);
+      auto& variants = variants_.emplace_back(
+        std::make_unique<VARIANT[]>(count));
+      for (std::size_t i{}; i < count; ++i)
+        decode(reader, variants[i], depth + 1);
+      data = variants.get();
+    }
+    return arrays_.emplace_back(detail::make_borrowed_descriptor(vt,
+        element_size, bounds, data)).get();
+  }
+};
+
+// -----------------------------------------------------------------------------
+// Native_variant (conversions)
+// -----------------------------------------------------------------------------
+
+/// @returns The instance of Variant with the value of `native`.
+inline Variant to_variant(const Native_variant& native)
+{
+  Variant result;
+  auto& data = result.data();
+  visit(native, [&data](const auto value)
+  {
+    using T = std::remove_const_t<decltype(value)>;
+    using std::is_same_v;
+    if constexpr (is_same_v<T, std::string_view>)
+      data.bstrVal = detail::make_bstr(value);
+    else if constexpr (is_same_v<T, bool>)
+      data.boolVal = value ? VARIANT_TRUE : VARIANT_FALSE;
+    else if constexpr (is_same_v<T, Date>)
+      data.date = value.value;
+    else if constexpr (!is_same_v<T, Empty>)
+      std::memcpy(&data.llVal, &value, sizeof(value));
+  });
+  data.vt = static_cast<VARTYPE>(native.type());
+  return result;
+}
+
+/**
+ * @returns The instance of Native_variant with the value of `variant`.
+ * `VT_INT` and `VT_UINT` are converted to 32-bit integers, strings are
+ * converted to UTF-8.
+ *
+ * @throws `std::runtime_error` if `variant` is of type which can't be
+ * represented as Native_variant (e.g. `VT_BYREF` forms, since the referenced
+ * value can't be owned).
+ */
+template<bool IsConst, bool IsOwns>
+Native_variant to_native_variant(const Basic_variant<IsConst, IsOwns>& variant)
+{
+  return visit(variant, [](const auto& value) -> Native_variant
+  {
+    using T = std::decay_t<decltype(value)>;
+    using std::is_same_v;
+    if constexpr (is_same_v<T, Empty> || is_same_v<T, Date> ||
+      std::is_arithmetic_v<T>)
+      return value;
+    else if constexpr (is_same_v<T, Wstring_view>)
+      return Native_variant{winbase::utf16_to_utf8(value)};
+    else
+      throw std::runtime_error{"cannot convert VARIANT to Native_variant"};
+  });
+}
+
+// -----------------------------------------------------------------------------
+// IDispatch
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief The cache of DISPIDs by the pair of type and member name.
+ *
+ * @details The type of object is identified by the GUID of its `ITypeInfo`, so
+ * the DISPIDs resolved for one object are reused for all the objects of the
+ * same type, even if they provide distinct instances of `ITypeInfo`. The
+ * objects without type information (or whose type has no GUID) are identified
+ * by themselves. The cache holds the references to such objects until clear()
+ * or destruction, so their identities can't be reused.
+ *
+ * @remarks The objects which add members dynamically (e.g. `IDispatchEx` based
+ * ones) might share the type information while resolving the same names
+ * differently. Such objects must be used with a separate cache.
+ *
+ * @remarks The names are cached as given, i.e. case-sensitively.
+ */
+class Dispid_cache final : private Noncopymove {
+public:
+  /// The destructor.
+  ~Dispid_cache()
+  {
+    clear();
+  }
+
+  /// The default constructor.
+  Dispid_cache() = default;
+
+  /// @returns The number of cached DISPIDs.
+  std::size_t size() const noexcept
+  {
+    std::size_t result{};
+    for (const auto& [type, table] : type_tables_)
+      result += table.size();
+    for (const auto& [object, table] : object_tables_)
+      result += table.size();
+    return result;
+  }
+
+  /// Releases all the cached DISPIDs and the references to the objects.
+  void clear() noexcept
+  {
+    type_tables_.clear();
+    for (const auto& [object, table] : object_tables_)
+      object->Release();
+    object_tables_.clear();
+  }
+
+private:
+  friend class Dispatcher;
+
+  struct Name_hash final {
+    using is_transparent = void;
+
+    std::size_t operator()(const Wstring_view name) const noexcept
+    {
+      return std::hash<Wstring_view>{}(name);
+    }
+  };
+
+  using Table = std::unordered_map<Wstring, DISPID, Name_hash,
+    std::equal_to<>>;
+
+  std::unordered_map<Guid, Table> type_tables_;
+  std::unordered_map<IUnknown*, Table> object_tables_;
+
+  /// @returns The table of DISPIDs of the type of `object`.
+  Table& table(IDispatch& object, const LCID locale)
+  {
+    if (const auto type = type_guid(object, locale))
+      return type_tables_[*type];
+
+    const auto [i, is_inserted] = object_tables_.try_emplace(&object);
+    if (is_inserted)
+      object.AddRef();
+    return i->second;
+  }
+
+  /**
+   * @returns The GUID of the type of `object`, or `std::nullopt` if there is
+   * no type information or the type has no GUID.
+   */
+  static std::optional<Guid> type_guid(IDispatch& object,
+    const LCID locale) noexcept
+  {
+    UINT count{};
+    ITypeInfo* type{};
+    if (FAILED(object.GetTypeInfoCount(&count)) || !count ||
+      FAILED(object.GetTypeInfo(0, locale, &type)) || !type)
+      return std::nullopt;
+
+    std::optional<Guid> result;
+    TYPEATTR* attr{};
+    if (SUCCEEDED(type->GetTypeAttr(&attr)) && attr) {
+      if (const auto guid = to_guid(attr->guid); guid != Guid{})
+        result = guid;
+      type->ReleaseTypeAttr(attr);
+    }
+    type->Release();
+    return result;
+  }
+};
+
+/**
+ * @brief The reusable buffer of arguments for `IDispatch::Invoke()`.
+ *
+ * @details The arguments are appended in the natural order (they're reversed
+ * for `DISPPARAMS` around the invocation). clear() keeps the allocated memory,
+ * so the buffer can be reused for many invocations without reallocation.
+ */
+class Dispatch_arguments final : private Noncopymove {
+public:
+  /// The destructor.
+  ~Dispatch_arguments()
+  {
+    clear();
+  }
+
+  /// The default constructor.
+  Dispatch_arguments() = default;
+
+  /// Appends the argument by taking the ownership of `value`.
+  void push_back(Variant&& value)
+  {
+    push_back(value.data(), true);
+    VariantInit(&value.data());
+  }
+
+  /// Appends the copy of `value`.
+  template<bool IsValueConst>
+  void push_back(const Basic_variant<IsValueConst, true>& value)
+  {
+    Variant copy;
+    const HRESULT err{VariantCopy(&copy.data(), &value.data())};
+    if (err == E_OUTOFMEMORY)
+      throw std::bad_alloc{};
+    else if (FAILED(err))
+      throw std::runtime_error{"cannot copy VARIANT argument: error "
+        + std::to_string(err)};
+    push_back(std::move(copy));
+  }
+
+  /**
+   * @brief Appends the argument borrowed from `value` without copying.
+   *
+   * @par Requires
+   * The value of `value` must outlive the invocation.
+   */
+  template<bool IsValueConst>
+  void push_back(const Basic_variant<IsValueConst, false>& value)
+  {
+    push_back(value.data(), false);
+  }
+
+  /// Appends the argument converted from `value`.
+  void push_back(const Native_variant& value)
+  {
+    push_back(to_variant(value));
+  }
+
+  /// @returns The number of arguments.
+  std::size_t size() const noexcept
+  {
+    return values_.size();
+  }
+
+  /// @returns `true` if there are no arguments.
+  bool is_empty() const noexcept
+  {
+    return values_.empty();
+  }
+
+  /// Releases the owned arguments. (The allocated memory is kept.)
+  void clear() noexcept
+  {
+    for (std::size_t i{}; i < values_.size(); ++i) {
+      if (is_owned_[i])
+        VariantClear(&values_[i]);
+    }
+    values_.clear();
+    is_owned_.clear();
+  }
+
+private:
+  friend class Dispatcher;
+
+  std::vector<VARIANT> values_;
+  std::vector<bool> is_owned_;
+
+  /// Appends `value`. (Both vectors are left intact on failure.)
+  void push_back(const VARIANT& value, const bool is_owned)
+  {
+    values_.push_back(value);
+    try {
+      is_owned_.push_back(is_owned);
+    } catch (...) {
+      values_.pop_back();
+      throw;
+    }
+  }
+
+  /// @returns The view of arguments of range [offset, offset + count).
+  std::span<VARIANT> span(const std::size_t offset,
+    const std::size_t count) noexcept
+  {
+    return std::span{values_}.subspan(offset, count);
+  }
+};
+
+/**
+ * @brief The batch of invocations of members of one object.
+ *
+ * @details All the arguments of all the invocations are kept in one
+ * Dispatch_arguments buffer, and clear() keeps the allocated memory, so the
+ * batch can be refilled and invoked repeatedly without reallocation.
+ */
+class Dispatch_batch final : private Noncopymove {
+public:
+  /**
+   * @brief Appends the invocation of the member `id` of kind `flags` (e.g.
+   * `DISPATCH_METHOD`).
+   *
+   * @returns `*this` to append the arguments of the invocation by arg().
+   */
+  Dispatch_batch& add(const DISPID id, const WORD flags)
+  {
+    calls_.push_back(Call{id, flags, arguments_.size()});
+    return *this;
+  }
+
+  /**
+   * @brief Appends the argument of the last appended invocation.
+   *
+   * @see Dispatch_arguments::push_back().
+   */
+  template<typename T>
+  Dispatch_batch& arg(T&& value)
+  {
+    if (calls_.empty())
+      throw std::logic_error{"cannot append argument to empty Dispatch_batch"};
+    arguments_.push_back(std::forward<T>(value));
+    return *this;
+  }
+
+  /// @returns The number of invocations.
+  std::size_t size() const noexcept
+  {
+    return calls_.size();
+  }
+
+  /**
+   * @returns The results of invocations (in the order of appending) performed
+   * by `Dispatcher::invoke()`.
+   */
+  std::span<Variant> results() noexcept
+  {
+    return results_;
+  }
+
+  /// @overload
+  std::span<const Variant> results() const noexcept
+  {
+    return results_;
+  }
+
+  /// Removes all the invocations and the results. (The memory is kept.)
+  void clear() noexcept
+  {
+    calls_.clear();
+    arguments_.clear();
+    results_.clear();
+  }
+
+private:
+  friend class Dispatcher;
+
+  struct Call final {
+    DISPID id{};
+    WORD flags{};
+    std::size_t offset{};
+  };
+
+  std::vector<Call> calls_;
+  Dispatch_arguments arguments_;
+  std::vector<Variant> results_;
+};
+
+/**
+ * @brief The late-bound invoker of members of `IDispatch` object.
+ *
+ * @details The DISPIDs are resolved by `GetIDsOfNames()` only once per type
+ * and name by using Dispid_cache.
+ */
+class Dispatcher final : private Noncopy {
+public:
+  /// The destructor.
+  ~Dispatcher()
+  {
+    if (object_)
+      object_->Release();
+  }
+
+  /**
+   * @brief The constructor.
+   *
+   * @param object The object to invoke the members of.
+   * @param cache The cache of DISPIDs which must outlive this instance.
+   */
+  Dispatcher(IDispatch& object, Dispid_cache& cache,
+    const LCID locale = LOCALE_USER_DEFAULT)
+    : object_{&object}
+    , locale_{locale}
+  {
+    object_->AddRef();
+    try {
+      table_ = &cache.table(*object_, locale_);
+    } catch (...) {
+      object_->Release();
+      throw;
+    }
+  }
+
+  /// The move constructor.
+  Dispatcher(Dispatcher&& rhs) noexcept
+    : object_{std::exchange(rhs.object_, nullptr)}
+    , table_{std::exchange(rhs.table_, nullptr)}
+    , locale_{rhs.locale_}
+  {}
+
+  /// The move assignment operator.
+  Dispatcher& operator=(Dispatcher&& rhs) noexcept
+  {
+    if (this != &rhs) {
+      Dispatcher tmp{std::move(rhs)};
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  /// The swap operation.
+  void swap(Dispatcher& other) noexcept
+  {
+    using std::swap;
+    swap(object_, other.object_);
+    swap(table_, other.table_);
+    swap(locale_, other.locale_);
+  }
+
+  /// @returns The object.
+  IDispatch& object() const noexcept
+  {
+    return *object_;
+  }
+
+  /**
+   * @returns The DISPID of member `name`.
+   *
+   * @throws `std::runtime_error` if `GetIDsOfNames()` fails.
+   */
+  DISPID dispid(const Wstring_view name)
+  {
+    if (const auto i = table_->find(name); i != table_->end())
+      return i->second;
+
+    Wstring key{name};
+    LPOLESTR names[]{key.data()};
+    DISPID result{DISPID_UNKNOWN};
+    const HRESULT err{object_->GetIDsOfNames(IID_NULL, names, 1, locale_,
+      &result)};
+    if (FAILED(err))
+      throw std::runtime_error{"cannot get DISPID of "
+        + winbase::utf16_to_utf8(name) + ": error " + std::to_string(err)};
+    table_->emplace(std::move(key), result);
+    return result;
+  }
+
+  /**
+   * @returns The result of invocation of member `id` of kind `flags` (e.g.
+   * `DISPATCH_METHOD`) with the `args`.
+   *
+   * @throws `std::runtime_error` if `Invoke()` fails.
+   */
+  Variant invoke(const DISPID id, const WORD flags, Dispatch_arguments& args)
+  {
+    return invoke(id, flags, args.span(0, args.size()));
+  }
+
+  /// @overload
+  Variant invoke(const DISPID id, const WORD flags)
+  {
+    return invoke(id, flags, std::span<VARIANT>{});
+  }
+
+  /**
+   * @brief Invokes all the members appended to `batch` in order.
+   *
+   * @details The results are available via `batch.results()`.
+   *
+   * @throws `std::runtime_error` if any of invocations fails. (The results of
+   * preceding invocations are available.)
+   */
+  void invoke(Dispatch_batch& batch)
+  {
+    auto& calls = batch.calls_;
+    auto& args = batch.arguments_;
+    auto& results = batch.results_;
+    results.clear();
+    results.reserve(calls.size());
+    for (std::size_t i{}; i < calls.size(); ++i) {
+      const auto& call = calls[i];
+      const auto end = i + 1 < calls.size() ? calls[i + 1].offset : args.size();
+      results.push_back(invoke(call.id, call.flags,
+        args.span(call.offset, end - call.offset)));
+    }
+  }
+
+  /// @returns The result of method `name` invoked with the `args`.
+  Variant call(const Wstring_view name, Dispatch_arguments& args)
+  {
+    return invoke(dispid(name), DISPATCH_METHOD, args);
+  }
+
+  /// @overload
+  Variant call(const Wstring_view name)
+  {
+    return invoke(dispid(name), DISPATCH_METHOD);
+  }
+
+  /// @returns The value of property `name`.
+  Variant get(const Wstring_view name)
+  {
+    return invoke(dispid(name), DISPATCH_PROPERTYGET);
+  }
+
+  /// Sets the value of property `name` to the single argument of `args`.
+  void put(const Wstring_view name, Dispatch_arguments& args)
+  {
+    invoke(dispid(name), DISPATCH_PROPERTYPUT, args);
+  }
+
+private:
+  IDispatch* object_{};
+  Dispid_cache::Table* table_{};
+  LCID locale_{};
+
+  Variant invoke(const DISPID id, const WORD flags,
+    const std::span<VARIANT> args)
+  {
+    if (args.size() > std::numeric_limits<UINT>::max())
+      throw std::invalid_argument{"cannot invoke IDispatch member:"
+        " too many arguments"};
+
+    const bool is_put{(flags & (DISPATCH_PROPERTYPUT |
+      DISPATCH_PROPERTYPUTREF)) != 0};
+    DISPID put_id{DISPID_PROPERTYPUT};
+    DISPPARAMS params{args.data(), is_put ? &put_id : nullptr,
+      static_cast<UINT>(args.size()), is_put ? 1u : 0u};
+    Variant result;
+    EXCEPINFO exception{};
+    UINT arg_error{};
+    std::reverse(args.begin(), args.end());
+    const HRESULT err{object_->Invoke(id, IID_NULL, locale_, flags, &params,
+      is_put ? nullptr : &result.data(), &exception, &arg_error)};
+    std::reverse(args.begin(), args.end());
+    if (FAILED(err))
+      throw_invoke_error(id, err, exception);
+    return result;
+  }
+
+  [[noreturn]] static void throw_invoke_error(const DISPID id,
+    const HRESULT err, EXCEPINFO& exception)
+  {
+    std::string message{"cannot invoke IDispatch member "
+      + std::to_string(id) + ": error " + std::to_string(err)};
+    if (err == DISP_E_EXCEPTION) {
+      if (exception.pfnDeferredFillIn)
+        exception.pfnDeferredFillIn(&exception);
+      if (exception.bstrDescription) {
+        try {
+          message.append(": ").append(to_string(exception.bstrDescription));
+        } catch (...) {}
+      }
+      SysFreeString(exception.bstrSource);
+      SysFreeString(exception.bstrDescription);
+      SysFreeString(exception.bstrHelpFile);
+    }
+    throw std::runtime_error{message};
+  }
+};
+
 } // namespace dmitigr::winbase::com
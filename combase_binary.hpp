@@ -0,0 +1,331 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::winbase::com {
+
+/*
+ * The binary format of VARIANT (all the fields are in the host byte order,
+ * the alignments are relative to the beginning of the buffer):
+ *
+ *   - header: 'D', 'M', 'V' followed by the version byte;
+ *   - value: the 16-bit VARTYPE followed by the payload of this type.
+ *
+ * The payloads are:
+ *
+ *   - nothing for `VT_EMPTY` and `VT_NULL`;
+ *   - the bytes of the fixed-size value aligned to its size (but to 8 at
+ *   most). `DECIMAL` takes 16 bytes;
+ *   - the BSTR as it's laid out in memory: the 32-bit size in bytes aligned to
+ *   4 (`0xFFFFFFFF` for null BSTR) followed by UTF-16 code units and the
+ *   terminating zero;
+ *   - the array (`VT_ARRAY | vt`): the 16-bit dimension count, the bounds
+ *   (Binary_bound) aligned to 8 in the order of dimensions, and the elements in
+ *   memory order (i.e. the first dimension varies fastest). The fixed-size
+ *   elements are stored contiguously as the single payload, the others are
+ *   stored as consecutive payloads of `vt` (`VT_VARIANT` elements are values).
+ *
+ * Thus, the strings and the arrays of fixed-size elements can be used right
+ * in the buffer aligned to 8.
+ */
+
+/// The bound of the array dimension in the binary format.
+struct Binary_bound final {
+  std::uint32_t count{};
+  std::int32_t lower_bound{};
+};
+static_assert(sizeof(Binary_bound) == 8);
+
+namespace detail {
+inline constexpr char binary_magic[3]{'D', 'M', 'V'};
+inline constexpr std::uint32_t null_string_size{0xFFFFFFFF};
+
+constexpr std::size_t binary_alignment(const std::size_t size) noexcept
+{
+  return size < 8 ? (size ? size : 1) : 8;
+}
+} // namespace detail
+
+/**
+ * @brief A writer of the binary format of VARIANT.
+ *
+ * @details The buffer is reused: clear() keeps the allocated memory.
+ */
+class Binary_writer final {
+public:
+  /// The version of the format.
+  static constexpr std::uint8_t version{1};
+
+  /// Constructs the writer with the empty content.
+  Binary_writer()
+  {
+    clear();
+  }
+
+  /// Replaces the content with the header.
+  void clear()
+  {
+    buffer_.clear();
+    buffer_.append(detail::binary_magic, sizeof(detail::binary_magic));
+    buffer_.push_back(static_cast<char>(version));
+  }
+
+  /// @returns The content.
+  const std::string& bytes() const noexcept
+  {
+    return buffer_;
+  }
+
+  /// @returns The content. The writer is left with the empty content.
+  std::string release()
+  {
+    std::string result{std::move(buffer_)};
+    clear();
+    return result;
+  }
+
+  /// Writes the VARTYPE.
+  void write_type(const std::uint16_t vt)
+  {
+    append(&vt, sizeof(vt));
+  }
+
+  /// Writes `count` fixed-size elements of `element_size` bytes.
+  void write_fixed(const void* const data, const std::size_t element_size,
+    const std::size_t count = 1)
+  {
+    align(detail::binary_alignment(element_size));
+    append(data, element_size*count);
+  }
+
+  /// Writes the string of `size` UTF-16 code units.
+  void write_string(const char16_t* const data, const std::size_t size)
+  {
+    if (size > (detail::null_string_size - 1) / sizeof(char16_t))
+      throw std::length_error{"cannot write too long string"};
+    const auto byte_size = static_cast<std::uint32_t>(size*sizeof(char16_t));
+    align(sizeof(byte_size));
+    append(&byte_size, sizeof(byte_size));
+    append(data, byte_size);
+    buffer_.append(sizeof(char16_t), '\0');
+  }
+
+  /// Writes the null string.
+  void write_null_string()
+  {
+    align(sizeof(detail::null_string_size));
+    append(&detail::null_string_size, sizeof(detail::null_string_size));
+  }
+
+  /// Writes the dimension count and the `bounds` of array.
+  void write_bounds(const std::span<const Binary_bound> bounds)
+  {
+    if (bounds.empty() ||
+      bounds.size() > std::numeric_limits<std::uint16_t>::max())
+      throw std::invalid_argument{"cannot write array bounds:"
+        " invalid dimension count"};
+    const auto count = static_cast<std::uint16_t>(bounds.size());
+    append(&count, sizeof(count));
+    write_fixed(bounds.data(), sizeof(Binary_bound), bounds.size());
+  }
+
+private:
+  std::string buffer_;
+
+  void align(const std::size_t alignment)
+  {
+    buffer_.append((alignment - buffer_.size() % alignment) % alignment, '\0');
+  }
+
+  void append(const void* const data, const std::size_t size)
+  {
+    buffer_.append(static_cast<const char*>(data), size);
+  }
+};
+
+/**
+ * @brief A reader of the binary format of VARIANT.
+ *
+ * @details The strings and the arrays are returned as views of the buffer.
+ * The buffer may be at any address, but the views of strings can be used only
+ * if it's aligned to 8 (see is_aligned()).
+ *
+ * @remarks The buffer must outlive the views.
+ */
+class Binary_reader final {
+public:
+  /**
+   * @brief The constructor.
+   *
+   * @throws `std::runtime_error` if `bytes` doesn't begin with the header of
+   * the supported version.
+   */
+  explicit Binary_reader(const std::span<const std::byte> bytes)
+    : begin_{bytes.data()}
+    , position_{bytes.data()}
+    , end_{bytes.data() + bytes.size()}
+  {
+    const auto* const header = read(sizeof(detail::binary_magic) + 1);
+    if (std::memcmp(header, detail::binary_magic, sizeof(detail::binary_magic))
+      || static_cast<std::uint8_t>(header[3]) != Binary_writer::version)
+      throw std::runtime_error{"cannot read binary VARIANT:"
+        " unsupported format"};
+  }
+
+  /// @overload
+  explicit Binary_reader(const std::string_view bytes)
+    : Binary_reader{std::as_bytes(std::span{bytes})}
+  {}
+
+  /// @returns `true` if all the bytes are read.
+  bool is_end() const noexcept
+  {
+    return position_ == end_;
+  }
+
+  /**
+   * @returns `true` if the buffer is aligned to 8, i.e. if the data read can
+   * be used right in the buffer.
+   */
+  bool is_aligned() const noexcept
+  {
+    return !(reinterpret_cast<std::uintptr_t>(begin_) % 8);
+  }
+
+  /// @returns The number of bytes left.
+  std::size_t remaining_size() const noexcept
+  {
+    return static_cast<std::size_t>(end_ - position_);
+  }
+
+  /// @returns The VARTYPE.
+  std::uint16_t read_type()
+  {
+    std::uint16_t result;
+    std::memcpy(&result, read(sizeof(result)), sizeof(result));
+    return result;
+  }
+
+  /// @returns The view of `count` fixed-size elements of `element_size` bytes.
+  std::span<const std::byte> read_fixed(const std::size_t element_size,
+    const std::size_t count = 1)
+  {
+    align(detail::binary_alignment(element_size));
+    if (element_size && count > remaining_size() / element_size)
+      throw_truncated();
+    return {read(element_size*count), element_size*count};
+  }
+
+  /**
+   * @returns The bytes of the string without the terminating zero, or
+   * `std::nullopt` for the null string.
+   */
+  std::optional<std::span<const std::byte>> read_string_bytes()
+  {
+    align(sizeof(std::uint32_t));
+    std::uint32_t byte_size;
+    std::memcpy(&byte_size, read(sizeof(byte_size)), sizeof(byte_size));
+    if (byte_size == detail::null_string_size)
+      return std::nullopt;
+    else if (byte_size % sizeof(char16_t))
+      throw std::runtime_error{"cannot read binary VARIANT: invalid string"};
+    const auto* const data = read(byte_size + sizeof(char16_t));
+    char16_t terminator;
+    std::memcpy(&terminator, data + byte_size, sizeof(terminator));
+    if (terminator)
+      throw std::runtime_error{"cannot read binary VARIANT:"
+        " string is not terminated"};
+    return std::span{data, byte_size};
+  }
+
+  /**
+   * @returns The view of the string, or `std::nullopt` for the null string.
+   * (The string is followed by the terminating zero and is preceded by its
+   * size in bytes, i.e. is laid out as BSTR.)
+   *
+   * @throws `std::invalid_argument` if `!is_aligned()`.
+   */
+  std::optional<std::u16string_view> read_string()
+  {
+    if (!is_aligned())
+      throw_misaligned();
+    const auto bytes = read_string_bytes();
+    if (!bytes)
+      return std::nullopt;
+    return std::u16string_view{reinterpret_cast<const char16_t*>(
+        bytes->data()), bytes->size() / sizeof(char16_t)};
+  }
+
+  /// @returns The bounds of array.
+  std::vector<Binary_bound> read_bounds()
+  {
+    std::uint16_t count;
+    std::memcpy(&count, read(sizeof(count)), sizeof(count));
+    if (!count)
+      throw std::runtime_error{"cannot read binary VARIANT:"
+        " invalid dimension count"};
+    const auto bytes = read_fixed(sizeof(Binary_bound), count);
+    std::vector<Binary_bound> result(count);
+    std::memcpy(result.data(), bytes.data(), bytes.size());
+    return result;
+  }
+
+private:
+  const std::byte* begin_{};
+  const std::byte* position_{};
+  const std::byte* end_{};
+
+  [[noreturn]] static void throw_misaligned()
+  {
+    throw std::invalid_argument{"cannot read binary VARIANT:"
+      " misaligned buffer"};
+  }
+
+  [[noreturn]] static void throw_truncated()
+  {
+    throw std::runtime_error{"cannot read binary VARIANT: truncated data"};
+  }
+
+  void align(const std::size_t alignment)
+  {
+    const auto offset = static_cast<std::size_t>(position_ - begin_);
+    read((alignment - offset % alignment) % alignment);
+  }
+
+  const std::byte* read(const std::size_t size)
+  {
+    if (size > remaining_size())
+      throw_truncated();
+    return std::exchange(position_, position_ + size);
+  }
+};
+
+} // namespace dmitigr::winbase::com
@@ -0,0 +1,254 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK.
+
+#pragma once
+
+#include "combase_native.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+namespace dmitigr::winbase::com {
+
+/*
+ * The OLE Automation date is the number of days since 1899-12-30 00:00. The
+ * integral part denotes the day and the absolute value of the fractional part
+ * denotes the time of that day, so the dates before 1899-12-30 are not linear:
+ * -1.25 is 1899-12-29 06:00 rather than 1899-12-28 18:00. The valid dates are
+ * from 0100-01-01 to 9999-12-31.
+ *
+ * The conversions below are exact to milliseconds and don't depend on
+ * `VariantTimeToSystemTime()` (which is limited to seconds).
+ */
+
+/// The time point of the precision of conversions of `Date`.
+using Date_time = std::chrono::sys_time<std::chrono::milliseconds>;
+
+namespace detail {
+inline constexpr std::int64_t ms_per_day{86'400'000};
+
+/// The number of days from 1899-12-30 to 1970-01-01.
+inline constexpr std::int64_t unix_epoch_days{25'569};
+
+/// The number of days from 1899-12-30 to 0100-01-01.
+inline constexpr std::int64_t min_date_days{-657'434};
+
+/// The number of days from 1899-12-30 to 9999-12-31.
+inline constexpr std::int64_t max_date_days{2'958'465};
+
+/// @returns `true` if `value` is in the range of OLE Automation dates.
+constexpr bool is_valid_date(const double value) noexcept
+{
+  // The upper bound excludes the values which are rounded to 10000-01-01.
+  return value > min_date_days - 1 &&
+    value < max_date_days + 1 - .5 / ms_per_day; // false for NaN too
+}
+
+/**
+ * @returns The number of milliseconds since the UNIX epoch.
+ *
+ * @par Requires
+ * `is_valid_date(value)`.
+ */
+inline std::int64_t to_unix_ms(const double value) noexcept
+{
+  const double day = std::trunc(value);
+  const double time = std::abs(value - day);
+  return (static_cast<std::int64_t>(day) - unix_epoch_days)*ms_per_day +
+    static_cast<std::int64_t>(time*ms_per_day + .5);
+}
+
+/// @returns `true` if `ms` since the UNIX epoch is the valid date.
+constexpr bool is_valid_unix_ms(const std::int64_t ms) noexcept
+{
+  return ms >= (min_date_days - unix_epoch_days)*ms_per_day &&
+    ms < (max_date_days + 1 - unix_epoch_days)*ms_per_day;
+}
+
+/**
+ * @returns The OLE Automation date of `ms` since the UNIX epoch.
+ *
+ * @par Requires
+ * `is_valid_unix_ms(ms)`.
+ */
+inline double to_date_value(const std::int64_t ms) noexcept
+{
+  const std::int64_t total{ms + unix_epoch_days*ms_per_day};
+  const std::int64_t remainder{total % ms_per_day};
+  const bool is_borrow{remainder < 0};
+  const std::int64_t day{total / ms_per_day - is_borrow};
+  const std::int64_t time{remainder + is_borrow*ms_per_day};
+  return static_cast<double>(day) +
+    static_cast<double>(day < 0 ? -time : time) / ms_per_day;
+}
+} // namespace detail
+
+/**
+ * @returns The time point of `date`.
+ *
+ * @throws `std::out_of_range` if `date` is not a valid OLE Automation date.
+ */
+inline Date_time to_date_time(const Date date)
+{
+  if (!detail::is_valid_date(date.value))
+    throw std::out_of_range{"invalid OLE Automation date"};
+  return Date_time{std::chrono::milliseconds{detail::to_unix_ms(date.value)}};
+}
+
+/**
+ * @returns The OLE Automation date of `time` (truncated to milliseconds).
+ *
+ * @throws `std::out_of_range` if `time` is out of the range of OLE Automation
+ * dates.
+ */
+template<class Duration>
+Date to_date(const std::chrono::sys_time<Duration> time)
+{
+  const auto ms = std::chrono::floor<std::chrono::milliseconds>(time)
+    .time_since_epoch().count();
+  if (!detail::is_valid_unix_ms(ms))
+    throw std::out_of_range{"time point is out of OLE Automation date range"};
+  return Date{detail::to_date_value(ms)};
+}
+
+/// @overload
+inline Date to_date(const std::chrono::year_month_day ymd)
+{
+  if (!ymd.ok())
+    throw std::out_of_range{"invalid calendar date"};
+  return to_date(std::chrono::sys_days{ymd});
+}
+
+/**
+ * @returns The calendar date of `date`.
+ *
+ * @throws `std::out_of_range` if `date` is not a valid OLE Automation date.
+ */
+inline std::chrono::year_month_day to_year_month_day(const Date date)
+{
+  return std::chrono::year_month_day{
+    std::chrono::floor<std::chrono::days>(to_date_time(date))};
+}
+
+/**
+ * @brief Converts `dates` to `result`.
+ *
+ * @details All the values are validated before the conversion, and both
+ * loops are free of branches, so they can be vectorized by the compiler.
+ *
+ * @throws `std::invalid_argument` if the sizes of `dates` and `result` differ,
+ * or `std::out_of_range` if any of `dates` is not a valid OLE Automation date.
+ * (`result` is not modified in both cases.)
+ */
+inline void to_date_time(const std::span<const Date> dates,
+  const std::span<Date_time> result)
+{
+  if (dates.size() != result.size())
+    throw std::invalid_argument{"cannot convert OLE Automation dates:"
+      " size mismatch"};
+
+  bool is_valid{true};
+  for (const auto date : dates)
+    is_valid &= detail::is_valid_date(date.value);
+  if (!is_valid)
+    throw std::out_of_range{"invalid OLE Automation date"};
+
+  for (std::size_t i{}; i < dates.size(); ++i)
+    result[i] = Date_time{std::chrono::milliseconds{
+      detail::to_unix_ms(dates[i].value)}};
+}
+
+/**
+ * @brief Converts `times` to `result`.
+ *
+ * @throws `std::invalid_argument` if the sizes of `times` and `result` differ,
+ * or `std::out_of_range` if any of `times` is out of the range of OLE
+ * Automation dates. (`result` is not modified in both cases.)
+ */
+inline void to_date(const std::span<const Date_time> times,
+  const std::span<Date> result)
+{
+  if (times.size() != result.size())
+    throw std::invalid_argument{"cannot convert to OLE Automation dates:"
+      " size mismatch"};
+
+  bool is_valid{true};
+  for (const auto time : times)
+    is_valid &= detail::is_valid_unix_ms(time.time_since_epoch().count());
+  if (!is_valid)
+    throw std::out_of_range{"time point is out of OLE Automation date range"};
+
+  for (std::size_t i{}; i < times.size(); ++i)
+    result[i] = Date{detail::to_date_value(
+      times[i].time_since_epoch().count())};
+}
+
+/// The maximum size of the output of `to_iso8601()`.
+inline constexpr std::size_t iso8601_max_size{23};
+
+/**
+ * @brief Writes `date` in ISO 8601 format `YYYY-MM-DDThh:mm:ss[.sss]` to
+ * `out`. (The milliseconds are written only if they are not zero.)
+ *
+ * @par Requires
+ * `out` must have space for at least `iso8601_max_size` characters.
+ *
+ * @returns The pointer past the last written character. (No terminating zero
+ * is written.)
+ *
+ * @throws `std::out_of_range` if `date` is not a valid OLE Automation date.
+ */
+inline char* to_iso8601(char* out, const Date date)
+{
+  using namespace std::chrono;
+  const auto time = to_date_time(date);
+  const auto day = floor<days>(time);
+  const year_month_day ymd{day};
+  const auto ms = static_cast<unsigned>((time - day).count());
+  out = detail::write_digits<4>(out, static_cast<std::uint32_t>(
+    static_cast<int>(ymd.year())));
+  *out++ = '-';
+  out = detail::write_digits<2>(out, static_cast<unsigned>(ymd.month()));
+  *out++ = '-';
+  out = detail::write_digits<2>(out, static_cast<unsigned>(ymd.day()));
+  *out++ = 'T';
+  out = detail::write_digits<2>(out, ms / 3'600'000);
+  *out++ = ':';
+  out = detail::write_digits<2>(out, ms / 60'000 % 60);
+  *out++ = ':';
+  out = detail::write_digits<2>(out, ms / 1000 % 60);
+  if (const auto fraction = ms % 1000) {
+    *out++ = '.';
+    out = detail::write_digits<3>(out, fraction);
+  }
+  return out;
+}
+
+/// @overload
+inline std::string to_iso8601(const Date date)
+{
+  char buf[iso8601_max_size];
+  return std::string(buf, to_iso8601(buf, date));
+}
+
+} // namespace dmitigr::winbase::com
@@ -0,0 +1,563 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK.
+
+#pragma once
+
+#include "combase_native.hpp"
+
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace dmitigr::winbase::com {
+
+// -----------------------------------------------------------------------------
+// 192-bit arithmetic
+// -----------------------------------------------------------------------------
+
+namespace detail {
+/// The unsigned integer of 192 bits (the least significant limb first).
+using Uint192 = std::array<std::uint32_t, 6>;
+
+inline constexpr std::uint32_t pow10_u32[]{1, 10, 100, 1000, 10'000, 100'000,
+  1'000'000, 10'000'000, 100'000'000, 1'000'000'000};
+
+inline constexpr double pow10_f64[]{1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+  1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+  1e21, 1e22, 1e23, 1e24, 1e25, 1e26, 1e27, 1e28};
+
+constexpr Uint192 to_uint192(const std::uint64_t low,
+  const std::uint32_t high) noexcept
+{
+  return {static_cast<std::uint32_t>(low),
+    static_cast<std::uint32_t>(low >> 32), high, 0, 0, 0};
+}
+
+/// @returns `true` if `x` fits in 96 bits.
+constexpr bool is_uint96(const Uint192& x) noexcept
+{
+  return !(x[3] | x[4] | x[5]);
+}
+
+constexpr bool is_zero(const Uint192& x) noexcept
+{
+  return is_uint96(x) && !(x[0] | x[1] | x[2]);
+}
+
+/// @returns The negative, zero or positive value if `x` is less, equal or
+/// greater than `y` respectively.
+constexpr int compare(const Uint192& x, const Uint192& y) noexcept
+{
+  for (std::size_t i{x.size()}; i--;) {
+    if (x[i] != y[i])
+      return x[i] < y[i] ? -1 : 1;
+  }
+  return 0;
+}
+
+/// Adds `y` to `x`. (The carry out of the most significant limb is lost.)
+constexpr void add(Uint192& x, const Uint192& y) noexcept
+{
+  std::uint64_t carry{};
+  for (std::size_t i{}; i < x.size(); ++i) {
+    const std::uint64_t sum{std::uint64_t{x[i]} + y[i] + carry};
+    x[i] = static_cast<std::uint32_t>(sum);
+    carry = sum >> 32;
+  }
+}
+
+/// Subtracts `y` from `x`. (Requires `x >= y`.)
+constexpr void subtract(Uint192& x, const Uint192& y) noexcept
+{
+  std::uint64_t borrow{};
+  for (std::size_t i{}; i < x.size(); ++i) {
+    const std::uint64_t difference{std::uint64_t{x[i]} - y[i] - borrow};
+    x[i] = static_cast<std::uint32_t>(difference);
+    borrow = difference >> 63;
+  }
+}
+
+/// Multiplies `x` by `m`. (The carry out of the most significant limb is lost.)
+constexpr void multiply(Uint192& x, const std::uint32_t m) noexcept
+{
+  std::uint64_t carry{};
+  for (auto& limb : x) {
+    const std::uint64_t product{std::uint64_t{limb}*m + carry};
+    limb = static_cast<std::uint32_t>(product);
+    carry = product >> 32;
+  }
+}
+
+/// Multiplies `x` by `10^power`.
+constexpr void multiply_pow10(Uint192& x, unsigned power) noexcept
+{
+  for (; power > 9; power -= 9)
+    multiply(x, pow10_u32[9]);
+  multiply(x, pow10_u32[power]);
+}
+
+/// Divides `x` by `d`. @returns The remainder.
+constexpr std::uint32_t divide(Uint192& x, const std::uint32_t d) noexcept
+{
+  std::uint64_t remainder{};
+  for (std::size_t i{x.size()}; i--;) {
+    const std::uint64_t dividend{remainder << 32 | x[i]};
+    x[i] = static_cast<std::uint32_t>(dividend / d);
+    remainder = dividend % d;
+  }
+  return static_cast<std::uint32_t>(remainder);
+}
+
+/**
+ * @brief Writes the number of `int_size` integral digits followed by
+ * `frac_size` fractional digits to `out`. (The leading zeros of the integral
+ * part and the trailing zeros of the fraction are not written.)
+ *
+ * @returns The pointer past the last written character.
+ */
+inline char* write_number(char* out, const bool is_negative,
+  const char* const digits, const std::size_t int_size,
+  std::size_t frac_size) noexcept
+{
+  while (frac_size && digits[int_size + frac_size - 1] == '0')
+    --frac_size;
+  std::size_t offset{};
+  while (offset + 1 < int_size && digits[offset] == '0')
+    ++offset;
+  if (is_negative && (int_size - offset > 1 || digits[offset] != '0' ||
+      frac_size))
+    *out++ = '-';
+  for (std::size_t i{offset}; i < int_size; ++i)
+    *out++ = digits[i];
+  if (frac_size) {
+    *out++ = '.';
+    for (std::size_t i{}; i < frac_size; ++i)
+      *out++ = digits[int_size + i];
+  }
+  return out;
+}
+} // namespace detail
+
+// -----------------------------------------------------------------------------
+// Currency
+// -----------------------------------------------------------------------------
+
+/// The OLE Automation currency. (Mirrors `CY`.)
+struct Currency final {
+  /// The scale of `value`.
+  static constexpr std::int64_t scale{10'000};
+
+  /// The amount multiplied by `scale`.
+  std::int64_t value{};
+
+  /// @returns The amount of `units` and `ten_thousandths` of the unit.
+  static constexpr Currency from_units(const std::int64_t units,
+    const std::int64_t ten_thousandths = 0)
+  {
+    if (units > std::numeric_limits<std::int64_t>::max() / scale ||
+      units < std::numeric_limits<std::int64_t>::min() / scale)
+      throw std::overflow_error{"Currency overflow"};
+    return Currency{units*scale} + Currency{ten_thousandths};
+  }
+
+  /// @returns The negated amount.
+  constexpr Currency operator-() const
+  {
+    if (value == std::numeric_limits<std::int64_t>::min())
+      throw std::overflow_error{"Currency overflow"};
+    return Currency{-value};
+  }
+
+  /// @returns The sum of `lhs` and `rhs`.
+  friend constexpr Currency operator+(const Currency lhs, const Currency rhs)
+  {
+    using L = std::numeric_limits<std::int64_t>;
+    if (rhs.value > 0 ? lhs.value > L::max() - rhs.value :
+      lhs.value < L::min() - rhs.value)
+      throw std::overflow_error{"Currency overflow"};
+    return Currency{lhs.value + rhs.value};
+  }
+
+  /// @returns The difference of `lhs` and `rhs`.
+  friend constexpr Currency operator-(const Currency lhs, const Currency rhs)
+  {
+    using L = std::numeric_limits<std::int64_t>;
+    if (rhs.value < 0 ? lhs.value > L::max() + rhs.value :
+      lhs.value < L::min() + rhs.value)
+      throw std::overflow_error{"Currency overflow"};
+    return Currency{lhs.value - rhs.value};
+  }
+
+  /// Compares the amounts.
+  friend constexpr auto operator<=>(Currency, Currency) noexcept = default;
+};
+
+/// @returns The nearest `double` of `amount`.
+constexpr double to_double(const Currency amount) noexcept
+{
+  return static_cast<double>(amount.value) / Currency::scale;
+}
+
+/// The maximum size of the output of `to_chars(char*, Currency)`.
+inline constexpr std::size_t currency_max_size{21};
+
+/**
+ * @brief Writes `amount` to `out` in the format `[-]units[.fraction]`. (The
+ * trailing zeros of the fraction are not written.)
+ *
+ * @par Requires
+ * `out` must have space for at least `currency_max_size` characters.
+ *
+ * @returns The pointer past the last written character. (No terminating zero
+ * is written.)
+ */
+inline char* to_chars(char* const out, const Currency amount) noexcept
+{
+  const bool is_negative{amount.value < 0};
+  std::uint64_t magnitude{static_cast<std::uint64_t>(amount.value)};
+  if (is_negative)
+    magnitude = ~magnitude + 1;
+
+  char digits[20];
+  const auto fraction = static_cast<std::uint32_t>(magnitude % 10'000);
+  magnitude /= 10'000;
+  detail::write_digits<4>(digits + 16, fraction);
+  detail::write_digits<8>(digits + 8,
+    static_cast<std::uint32_t>(magnitude % 100'000'000));
+  detail::write_digits<8>(digits,
+    static_cast<std::uint32_t>(magnitude / 100'000'000));
+  return detail::write_number(out, is_negative, digits, 16, 4);
+}
+
+/// @overload
+inline std::string to_string(const Currency amount)
+{
+  char buf[currency_max_size];
+  return std::string(buf, to_chars(buf, amount));
+}
+
+// -----------------------------------------------------------------------------
+// Decimal
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief The OLE Automation decimal: the 96-bit magnitude with the sign and
+ * the power of ten to divide by. (Mirrors the layout of `DECIMAL`.)
+ *
+ * @details The arithmetic is exact as long as the result fits in 96 bits.
+ * Otherwise, the result is rounded to the greatest possible scale (half to
+ * even, as by `VarDecAdd()`). The values which differ only in scale (like
+ * 1.5 and 1.50) are equal.
+ */
+class Decimal final {
+public:
+  /// The maximum scale.
+  static constexpr std::uint8_t max_scale{28};
+
+  /// Constructs zero.
+  constexpr Decimal() noexcept = default;
+
+  /**
+   * @brief Constructs `(is_negative ? -1 : 1) * (high*2^64 + low) / 10^scale`.
+   *
+   * @throws `std::invalid_argument` if `scale > max_scale`.
+   */
+  constexpr Decimal(const std::uint64_t low, const std::uint32_t high,
+    const std::uint8_t scale, const bool is_negative = false)
+    : scale_{scale}
+    , sign_{static_cast<std::uint8_t>(is_negative ? negative_sign : 0)}
+    , high_{high}
+    , low_{low}
+  {
+    if (scale > max_scale)
+      throw std::invalid_argument{"invalid Decimal scale"};
+  }
+
+  /// Constructs the integer.
+  template<typename T,
+    typename = std::enable_if_t<std::is_integral_v<T> &&
+      !std::is_same_v<T, bool>>>
+  constexpr Decimal(const T value) noexcept
+    : sign_{static_cast<std::uint8_t>(value < 0 ? negative_sign : 0)}
+    , low_{value < 0 ? ~static_cast<std::uint64_t>(value) + 1 :
+        static_cast<std::uint64_t>(value)}
+  {}
+
+  /// @returns The low 64 bits of the magnitude.
+  constexpr std::uint64_t low() const noexcept
+  {
+    return low_;
+  }
+
+  /// @returns The high 32 bits of the magnitude.
+  constexpr std::uint32_t high() const noexcept
+  {
+    return high_;
+  }
+
+  /// @returns The power of ten to divide the magnitude by.
+  constexpr std::uint8_t scale() const noexcept
+  {
+    return scale_;
+  }
+
+  /// @returns `true` if the sign is negative.
+  constexpr bool is_negative() const noexcept
+  {
+    return sign_ & negative_sign;
+  }
+
+  /// @returns `true` if the value is zero (of any sign and scale).
+  constexpr bool is_zero() const noexcept
+  {
+    return !(low_ | high_);
+  }
+
+  /**
+   * @returns The value of the given `scale` (rounded half to even if `scale`
+   * is less than the current one).
+   *
+   * @throws `std::invalid_argument` if `scale > max_scale`, or
+   * `std::overflow_error` if the result doesn't fit in 96 bits.
+   */
+  constexpr Decimal rescaled(const std::uint8_t scale) const
+  {
+    if (scale > max_scale)
+      throw std::invalid_argument{"invalid Decimal scale"};
+
+    auto magnitude = detail::to_uint192(low_, high_);
+    if (scale < scale_)
+      return make(magnitude, scale_, is_negative(), scale);
+
+    detail::multiply_pow10(magnitude, scale - scale_);
+    if (!detail::is_uint96(magnitude))
+      throw std::overflow_error{"Decimal overflow"};
+    return make(magnitude, scale, is_negative());
+  }
+
+  /// @returns The negated value.
+  constexpr Decimal operator-() const noexcept
+  {
+    auto result = *this;
+    result.sign_ ^= negative_sign;
+    return result;
+  }
+
+  /// @returns The sum of `lhs` and `rhs`.
+  friend constexpr Decimal operator+(const Decimal& lhs, const Decimal& rhs)
+  {
+    const unsigned scale{lhs.scale_ < rhs.scale_ ? rhs.scale_ : lhs.scale_};
+    auto x = detail::to_uint192(lhs.low_, lhs.high_);
+    auto y = detail::to_uint192(rhs.low_, rhs.high_);
+    detail::multiply_pow10(x, scale - lhs.scale_);
+    detail::multiply_pow10(y, scale - rhs.scale_);
+    if (lhs.is_negative() == rhs.is_negative()) {
+      detail::add(x, y);
+      return make(x, scale, lhs.is_negative());
+    } else if (detail::compare(x, y) >= 0) {
+      detail::subtract(x, y);
+      return make(x, scale, lhs.is_negative());
+    } else {
+      detail::subtract(y, x);
+      return make(y, scale, rhs.is_negative());
+    }
+  }
+
+  /// @returns The difference of `lhs` and `rhs`.
+  friend constexpr Decimal operator-(const Decimal& lhs, const Decimal& rhs)
+  {
+    return lhs + -rhs;
+  }
+
+  /// Compares the values.
+  friend constexpr std::strong_ordering operator<=>(const Decimal& lhs,
+    const Decimal& rhs) noexcept
+  {
+    const bool is_lhs_negative{lhs.is_negative() && !lhs.is_zero()};
+    const bool is_rhs_negative{rhs.is_negative() && !rhs.is_zero()};
+    if (is_lhs_negative != is_rhs_negative)
+      return is_lhs_negative ? std::strong_ordering::less :
+        std::strong_ordering::greater;
+
+    const unsigned scale{lhs.scale_ < rhs.scale_ ? rhs.scale_ : lhs.scale_};
+    auto x = detail::to_uint192(lhs.low_, lhs.high_);
+    auto y = detail::to_uint192(rhs.low_, rhs.high_);
+    detail::multiply_pow10(x, scale - lhs.scale_);
+    detail::multiply_pow10(y, scale - rhs.scale_);
+    const int result{is_lhs_negative ? detail::compare(y, x) :
+      detail::compare(x, y)};
+    return result <=> 0;
+  }
+
+  /// @returns `(lhs <=> rhs) == 0`.
+  friend constexpr bool operator==(const Decimal& lhs,
+    const Decimal& rhs) noexcept
+  {
+    return (lhs <=> rhs) == 0;
+  }
+
+private:
+  static constexpr std::uint8_t negative_sign{0x80}; // DECIMAL_NEG
+
+  std::uint16_t reserved_{};
+  std::uint8_t scale_{};
+  std::uint8_t sign_{};
+  std::uint32_t high_{};
+  std::uint64_t low_{};
+
+  /**
+   * @returns The value of `magnitude` and `scale` rounded half to even to
+   * fit in 96 bits and to have the scale not greater than `max_result_scale`.
+   *
+   * @throws `std::overflow_error` if the integral part doesn't fit in 96 bits.
+   */
+  static constexpr Decimal make(detail::Uint192 magnitude, unsigned scale,
+    const bool is_negative, const unsigned max_result_scale = max_scale)
+  {
+    std::uint32_t digit{};
+    bool is_sticky{};
+    while (!detail::is_uint96(magnitude) || scale > max_result_scale) {
+      if (!scale)
+        throw std::overflow_error{"Decimal overflow"};
+      is_sticky |= digit != 0;
+      digit = detail::divide(magnitude, 10);
+      --scale;
+    }
+    if (digit > 5 || (digit == 5 && (is_sticky || magnitude[0] & 1))) {
+      detail::add(magnitude, detail::Uint192{1});
+      if (!detail::is_uint96(magnitude))
+        return make(magnitude, scale, is_negative, max_result_scale);
+    }
+    return Decimal{std::uint64_t{magnitude[1]} << 32 | magnitude[0],
+      magnitude[2], static_cast<std::uint8_t>(scale),
+      is_negative && !detail::is_zero(magnitude)};
+  }
+};
+
+static_assert(sizeof(Decimal) == 16);
+
+/// @returns The nearest `double` of `value`.
+constexpr double to_double(const Decimal& value) noexcept
+{
+  const double magnitude{static_cast<double>(value.high())*0x1p64 +
+    static_cast<double>(value.low())};
+  const double result{magnitude / detail::pow10_f64[value.scale()]};
+  return value.is_negative() ? -result : result;
+}
+
+/// @returns The exact decimal of `amount`.
+constexpr Decimal to_decimal(const Currency amount) noexcept
+{
+  const bool is_negative{amount.value < 0};
+  const auto magnitude = static_cast<std::uint64_t>(amount.value);
+  return Decimal{is_negative ? ~magnitude + 1 : magnitude, 0, 4, is_negative};
+}
+
+/**
+ * @returns The currency of `value` rounded half to even to ten thousandths.
+ *
+ * @throws `std::overflow_error` if `value` is out of the range of Currency.
+ */
+constexpr Currency to_currency(const Decimal& value)
+{
+  const auto scaled = value.rescaled(4);
+  const auto limit = std::uint64_t{1} << 63;
+  if (scaled.high() || scaled.low() > limit ||
+    (scaled.low() == limit && !scaled.is_negative()))
+    throw std::overflow_error{"Currency overflow"};
+  return Currency{static_cast<std::int64_t>(scaled.is_negative() ?
+      ~scaled.low() + 1 : scaled.low())};
+}
+
+/// The maximum size of the output of `to_chars(char*, const Decimal&)`.
+inline constexpr std::size_t decimal_max_size{31};
+
+/**
+ * @brief Writes `value` to `out` in the format `[-]integer[.fraction]`. (The
+ * trailing zeros of the fraction are not written.)
+ *
+ * @par Requires
+ * `out` must have space for at least `decimal_max_size` characters.
+ *
+ * @returns The pointer past the last written character. (No terminating zero
+ * is written.)
+ */
+inline char* to_chars(char* const out, const Decimal& value) noexcept
+{
+  // The leading zeros of the fraction followed by the (up to 29) digits of the
+  // magnitude.
+  constexpr std::size_t chunk_count{4};
+  char digits[Decimal::max_scale + chunk_count*9];
+  auto magnitude = detail::to_uint192(value.low(), value.high());
+  for (std::size_t i{}; i < Decimal::max_scale; ++i)
+    digits[i] = '0';
+  for (std::size_t i{chunk_count}; i--;)
+    detail::write_digits<9>(digits + Decimal::max_scale + i*9,
+      detail::divide(magnitude, detail::pow10_u32[9]));
+
+  const std::size_t scale{value.scale()};
+  const std::size_t int_size{sizeof(digits) - scale};
+  return detail::write_number(out, value.is_negative(), digits, int_size,
+    scale);
+}
+
+/// @overload
+inline std::string to_string(const Decimal& value)
+{
+  char buf[decimal_max_size];
+  return std::string(buf, to_chars(buf, value));
+}
+
+// -----------------------------------------------------------------------------
+// Batch conversions
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Converts `amounts` to `result`.
+ *
+ * @details The loop is free of branches, so it can be vectorized by the
+ * compiler.
+ *
+ * @throws `std::invalid_argument` if the sizes of `amounts` and `result` differ.
+ */
+inline void to_double(const std::span<const Currency> amounts,
+  const std::span<double> result)
+{
+  if (amounts.size() != result.size())
+    throw std::invalid_argument{"cannot convert Currency: size mismatch"};
+  for (std::size_t i{}; i < amounts.size(); ++i)
+    result[i] = to_double(amounts[i]);
+}
+
+/// @overload
+inline void to_double(const std::span<const Decimal> values,
+  const std::span<double> result)
+{
+  if (values.size() != result.size())
+    throw std::invalid_argument{"cannot convert Decimal: size mismatch"};
+  for (std::size_t i{}; i < values.size(); ++i)
+    result[i] = to_double(values[i]);
+}
+
+} // namespace dmitigr::winbase::com
@@ -0,0 +1,244 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK.
+
+#pragma once
+
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+
+namespace dmitigr::winbase::com {
+
+/// The GUID. (Mirrors the layout of `GUID`.)
+struct Guid final {
+  std::uint32_t data1{};
+  std::uint16_t data2{};
+  std::uint16_t data3{};
+  std::array<std::uint8_t, 8> data4{};
+
+  /// Compares the GUIDs field by field.
+  friend constexpr auto operator<=>(const Guid&, const Guid&) noexcept = default;
+};
+static_assert(sizeof(Guid) == 16);
+
+/// The size of the string representation of GUID (without terminating zero).
+inline constexpr std::size_t guid_string_size{38};
+
+namespace detail {
+/// @returns The value of hexadecimal `digit`, or -1 if it's not a digit.
+template<typename Ch>
+constexpr int hex_value(const Ch digit) noexcept
+{
+  if (digit >= Ch('0') && digit <= Ch('9'))
+    return digit - Ch('0');
+  else if (digit >= Ch('A') && digit <= Ch('F'))
+    return digit - Ch('A') + 10;
+  else if (digit >= Ch('a') && digit <= Ch('f'))
+    return digit - Ch('a') + 10;
+  else
+    return -1;
+}
+
+/**
+ * @returns The eight hexadecimal digits (in upper case) of `value` packed into
+ * the bytes of the result, the most significant digit in the lowest byte.
+ *
+ * @details The nibbles are spread to bytes and converted to digits at once
+ * (SWAR), without branches and lookups.
+ */
+constexpr std::uint64_t hex_digits(const std::uint32_t value) noexcept
+{
+  // Reverse the nibbles first, so the most significant one lands in byte 0.
+  std::uint64_t v{value};
+  v = (v << 16 | v >> 16) & 0xFFFF'FFFF;
+  v = ((v & 0x00FF00FF) << 8 | (v >> 8 & 0x00FF00FF));
+  v = ((v & 0x0F0F0F0F) << 4 | (v >> 4 & 0x0F0F0F0F));
+  // Spread the nibbles to bytes.
+  v = (v | v << 16) & 0x0000'FFFF'0000'FFFF;
+  v = (v | v << 8) & 0x00FF'00FF'00FF'00FF;
+  v = (v | v << 4) & 0x0F0F'0F0F'0F0F'0F0F;
+  // Each byte greater than 9 gets the bit 4 set after adding 6.
+  const std::uint64_t letters{(v + 0x0606'0606'0606'0606) >> 4 &
+    0x0101'0101'0101'0101};
+  return v + 0x3030'3030'3030'3030 + letters*('A' - '0' - 10);
+}
+
+/// Writes the `N` least significant hexadecimal digits of `value` to `out`.
+template<std::size_t N, typename Ch>
+constexpr Ch* write_hex(Ch* const out, const std::uint32_t value) noexcept
+{
+  static_assert(0 < N && N <= 8);
+  const auto digits = hex_digits(value << (32 - 4*N));
+  for (std::size_t i{}; i < N; ++i)
+    out[i] = static_cast<Ch>(digits >> 8*i & 0xFF);
+  return out + N;
+}
+
+/// @returns The folded 128-bit product of `a` and `b`.
+constexpr std::uint64_t multiply_fold(const std::uint64_t a,
+  const std::uint64_t b) noexcept
+{
+  const std::uint64_t a_lo{a & 0xFFFF'FFFF}, a_hi{a >> 32};
+  const std::uint64_t b_lo{b & 0xFFFF'FFFF}, b_hi{b >> 32};
+  const std::uint64_t lo_lo{a_lo*b_lo};
+  const std::uint64_t hi_lo{a_hi*b_lo};
+  const std::uint64_t lo_hi{a_lo*b_hi};
+  const std::uint64_t cross{(lo_lo >> 32) + (hi_lo & 0xFFFF'FFFF) + lo_hi};
+  const std::uint64_t high{a_hi*b_hi + (hi_lo >> 32) + (cross >> 32)};
+  const std::uint64_t low{cross << 32 | (lo_lo & 0xFFFF'FFFF)};
+  return high ^ low;
+}
+} // namespace detail
+
+/**
+ * @returns The GUID of string `str` of form
+ * `{XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}` (the braces are optional, the
+ * digits are case-insensitive).
+ *
+ * @throws `std::invalid_argument` if `str` is not a GUID. (So the invalid
+ * strings are rejected at compile time in constant expressions.)
+ */
+template<typename Ch>
+constexpr Guid to_guid(std::basic_string_view<Ch> str)
+{
+  if (str.size() == guid_string_size) {
+    if (str.front() != Ch('{') || str.back() != Ch('}'))
+      throw std::invalid_argument{"invalid GUID string"};
+    str = str.substr(1, guid_string_size - 2);
+  } else if (str.size() != guid_string_size - 2)
+    throw std::invalid_argument{"invalid GUID string"};
+
+  std::size_t pos{};
+  const auto hex = [&str, &pos](const std::size_t digit_count)
+  {
+    std::uint32_t result{};
+    for (std::size_t i{}; i < digit_count; ++i) {
+      const int value{detail::hex_value(str[pos++])};
+      if (value < 0)
+        throw std::invalid_argument{"invalid GUID string"};
+      result = result << 4 | static_cast<std::uint32_t>(value);
+    }
+    return result;
+  };
+  const auto dash = [&str, &pos]
+  {
+    if (str[pos++] != Ch('-'))
+      throw std::invalid_argument{"invalid GUID string"};
+  };
+
+  Guid result;
+  result.data1 = hex(8);
+  dash();
+  result.data2 = static_cast<std::uint16_t>(hex(4));
+  dash();
+  result.data3 = static_cast<std::uint16_t>(hex(4));
+  dash();
+  for (std::size_t i{}; i < result.data4.size(); ++i) {
+    if (i == 2)
+      dash();
+    result.data4[i] = static_cast<std::uint8_t>(hex(2));
+  }
+  return result;
+}
+
+/// @overload
+template<typename Ch>
+constexpr Guid to_guid(const Ch* const str)
+{
+  return to_guid(std::basic_string_view<Ch>{str});
+}
+
+/**
+ * @brief Writes `guid` to `out` in the form of `StringFromGUID2()`:
+ * `{XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}`.
+ *
+ * @par Requires
+ * `out` must have space for at least `guid_string_size` characters.
+ *
+ * @returns The pointer past the last written character. (No terminating zero
+ * is written.)
+ */
+template<typename Ch>
+constexpr Ch* to_chars(Ch* out, const Guid& guid) noexcept
+{
+  const auto bytes = [&guid](const std::size_t i)
+  {
+    return static_cast<std::uint32_t>(guid.data4[i]) << 8 | guid.data4[i + 1];
+  };
+  *out++ = Ch('{');
+  out = detail::write_hex<8>(out, guid.data1);
+  *out++ = Ch('-');
+  out = detail::write_hex<4>(out, guid.data2);
+  *out++ = Ch('-');
+  out = detail::write_hex<4>(out, guid.data3);
+  *out++ = Ch('-');
+  out = detail::write_hex<4>(out, bytes(0));
+  *out++ = Ch('-');
+  out = detail::write_hex<4>(out, bytes(2));
+  out = detail::write_hex<8>(out, bytes(4) << 16 | bytes(6));
+  *out++ = Ch('}');
+  return out;
+}
+
+/**
+ * @returns The zero-terminated string representation of `guid`.
+ *
+ * @see to_chars().
+ */
+template<typename Ch = wchar_t>
+constexpr std::array<Ch, guid_string_size + 1> to_guid_string(
+  const Guid& guid) noexcept
+{
+  std::array<Ch, guid_string_size + 1> result{};
+  to_chars(result.data(), guid);
+  return result;
+}
+
+/**
+ * @returns The 64-bit hash of `guid`.
+ *
+ * @details All the 128 bits are mixed by the folded multiplication (as in
+ * xxHash3), so the sequentially allocated GUIDs are spread well.
+ */
+constexpr std::uint64_t hash(const Guid& guid) noexcept
+{
+  std::uint64_t low{guid.data1 | std::uint64_t{guid.data2} << 32 |
+    std::uint64_t{guid.data3} << 48};
+  std::uint64_t high{};
+  for (std::size_t i{}; i < guid.data4.size(); ++i)
+    high |= std::uint64_t{guid.data4[i]} << 8*i;
+  auto result = detail::multiply_fold(low ^ 0x9E37'79B9'7F4A'7C15,
+    high ^ 0xC2B2'AE3D'27D4'EB4F);
+  result ^= result >> 29;
+  return result;
+}
+
+} // namespace dmitigr::winbase::com
+
+/// The hash of Guid.
+template<>
+struct std::hash<dmitigr::winbase::com::Guid> final {
+  std::size_t operator()(const dmitigr::winbase::com::Guid& guid) const noexcept
+  {
+    return static_cast<std::size_t>(dmitigr::winbase::com::hash(guid));
+  }
+};
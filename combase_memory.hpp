@@ -0,0 +1,277 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK.
+
+#pragma once
+
+#include "../base/noncopymove.hpp"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::winbase::com {
+
+// -----------------------------------------------------------------------------
+// BSTR layout
+// -----------------------------------------------------------------------------
+
+namespace detail {
+/**
+ * @returns The size of the BSTR-like string `str` (i.e. the length prefix
+ * divided by `sizeof(Ch)`).
+ */
+template<typename Ch>
+std::size_t string_size(const Ch* const str) noexcept
+{
+  std::uint32_t bytes{};
+  std::memcpy(&bytes, reinterpret_cast<const char*>(str) - sizeof(bytes),
+    sizeof(bytes));
+  return bytes / sizeof(Ch);
+}
+
+/**
+ * @brief Sets the size of the BSTR-like string `str` (i.e. the length prefix
+ * and the terminating zero).
+ *
+ * @par Requires
+ * The capacity of `str` must be at least `size`.
+ */
+template<typename Ch>
+void set_string_size(Ch* const str, const std::size_t size) noexcept
+{
+  const auto bytes = static_cast<std::uint32_t>(size*sizeof(Ch));
+  std::memcpy(reinterpret_cast<char*>(str) - sizeof(bytes), &bytes,
+    sizeof(bytes));
+  str[size] = 0;
+}
+} // namespace detail
+
+// -----------------------------------------------------------------------------
+// String allocators
+// -----------------------------------------------------------------------------
+
+/*
+ * The string allocators allocate strings laid out as BSTR: the 32-bit size
+ * in bytes is followed by the characters and the terminating zero. They have
+ * the following interface:
+ *
+ *   - `Ch* allocate(const Ch* data, std::size_t size)` returns the string of
+ *   `size` characters copied from `data` (or uninitialized if `data` is null),
+ *   or throws `std::bad_alloc`;
+ *   - `void deallocate(Ch* str) noexcept` releases the string (ignores null).
+ */
+
+/**
+ * @brief The allocator which reuses the released strings.
+ *
+ * @details Strings not longer than `max_pooled_size` are allocated from
+ * `Source` with capacity rounded up to the power of two (the size class), and
+ * the released ones are kept in the list of their size class to be reused
+ * without calling `Source` (up to `max_class_size` per class).
+ *
+ * @tparam Source The underlying string allocator.
+ *
+ * @remarks Only strings returned by allocate() of this instance can be passed
+ * to deallocate(). Since the size of the string identifies its size class, it
+ * must not be altered.
+ */
+template<typename Ch, class Source>
+class Basic_string_pool final : private Noncopymove {
+public:
+  /// The capacity of the smallest size class.
+  static constexpr std::size_t min_capacity{8};
+
+  /// The number of size classes.
+  static constexpr std::size_t class_count{10};
+
+  /// The size of the longest string which is pooled.
+  static constexpr std::size_t max_pooled_size{
+    min_capacity << (class_count - 1)};
+
+  /// Releases the pooled strings.
+  ~Basic_string_pool()
+  {
+    clear();
+  }
+
+  /// The constructor.
+  explicit Basic_string_pool(Source source = {},
+    const std::size_t max_class_size = 4096)
+    : source_{std::move(source)}
+    , max_class_size_{max_class_size}
+  {}
+
+  /// @returns The string of `size` characters copied from `data`.
+  Ch* allocate(const Ch* const data, const std::size_t size)
+  {
+    const auto c = class_of(size);
+    if (!(c < class_count))
+      return source_.allocate(data, size);
+
+    Ch* result{};
+    if (auto& list = free_[c]; !list.empty()) {
+      result = list.back();
+      list.pop_back();
+      --size_;
+    } else
+      result = source_.allocate(nullptr, min_capacity << c);
+    detail::set_string_size(result, size);
+    if (data)
+      std::memcpy(result, data, size*sizeof(Ch));
+    return result;
+  }
+
+  /// Returns `str` to the pool.
+  void deallocate(Ch* const str) noexcept
+  {
+    if (!str)
+      return;
+
+    if (const auto c = class_of(detail::string_size(str)); c < class_count) {
+      if (auto& list = free_[c]; list.size() < max_class_size_) {
+        try {
+          list.push_back(str);
+          ++size_;
+          return;
+        } catch (...) {}
+      }
+    }
+    source_.deallocate(str);
+  }
+
+  /// @returns The number of pooled strings.
+  std::size_t size() const noexcept
+  {
+    return size_;
+  }
+
+  /// Releases the pooled strings.
+  void clear() noexcept
+  {
+    for (auto& list : free_) {
+      for (const auto str : list)
+        source_.deallocate(str);
+      list.clear();
+    }
+    size_ = 0;
+  }
+
+private:
+  Source source_;
+  std::size_t max_class_size_{};
+  std::size_t size_{};
+  std::array<std::vector<Ch*>, class_count> free_;
+
+  /// @returns The size class of strings of `size` characters.
+  static std::size_t class_of(const std::size_t size) noexcept
+  {
+    return size <= min_capacity ? 0 :
+      std::bit_width(size - 1) - std::bit_width(min_capacity - 1);
+  }
+};
+
+/**
+ * @brief The allocator which allocates strings from the blocks of memory
+ * released all at once.
+ *
+ * @details deallocate() is a no-op: the memory is released by clear() or on
+ * destruction. This suits short-lived outbound arrays of strings which are
+ * built, passed to the callee and destroyed.
+ *
+ * @warning The strings must not be passed to `SysFreeString()`, so they must
+ * not be handed over to the code which takes ownership of them.
+ */
+template<typename Ch>
+class Basic_string_arena final : private Noncopymove {
+public:
+  /// The constructor.
+  explicit Basic_string_arena(const std::size_t block_size = 64*1024)
+    : block_size_{block_size}
+  {}
+
+  /// @returns The string of `size` characters copied from `data`.
+  Ch* allocate(const Ch* const data, const std::size_t size)
+  {
+    // The prefix is 8-aligned, so the characters are 4-aligned.
+    constexpr std::size_t prefix_size{sizeof(std::uint32_t)};
+    constexpr std::size_t alignment{8};
+    if (size > std::numeric_limits<std::uint32_t>::max() / sizeof(Ch) - 1)
+      throw std::bad_alloc{};
+    const std::size_t entry_size{(prefix_size + (size + 1)*sizeof(Ch) +
+      alignment - 1) / alignment * alignment};
+
+    std::byte* entry{};
+    if (entry_size > block_size_) {
+      large_blocks_.push_back(
+        std::make_unique_for_overwrite<std::byte[]>(entry_size));
+      entry = large_blocks_.back().get();
+    } else {
+      if (blocks_.empty() || block_size_ - offset_ < entry_size) {
+        blocks_.push_back(std::make_unique_for_overwrite<std::byte[]>(
+          block_size_));
+        offset_ = 0;
+      }
+      entry = blocks_.back().get() + offset_;
+      offset_ += entry_size;
+    }
+
+    auto* const result = reinterpret_cast<Ch*>(entry + prefix_size);
+    detail::set_string_size(result, size);
+    if (data)
+      std::memcpy(result, data, size*sizeof(Ch));
+    return result;
+  }
+
+  /// Does nothing.
+  void deallocate(Ch*) noexcept
+  {}
+
+  /// @returns The number of allocated blocks.
+  std::size_t block_count() const noexcept
+  {
+    return blocks_.size() + large_blocks_.size();
+  }
+
+  /**
+   * @brief Releases all the memory.
+   *
+   * @par Effects
+   * All the strings allocated by this instance are invalidated.
+   */
+  void clear() noexcept
+  {
+    blocks_.clear();
+    large_blocks_.clear();
+    offset_ = 0;
+  }
+
+private:
+  std::size_t block_size_{};
+  std::size_t offset_{};
+  std::vector<std::unique_ptr<std::byte[]>> blocks_;
+  std::vector<std::unique_ptr<std::byte[]>> large_blocks_;
+};
+
+} // namespace dmitigr::winbase::com
@@ -0,0 +1,369 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK.
+
+#pragma once
+
+#include "../base/traits.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace dmitigr::winbase::com {
+
+namespace detail {
+/// Writes `value` as `N` decimal digits to `out`.
+template<std::size_t N>
+constexpr char* write_digits(char* const out, std::uint32_t value) noexcept
+{
+  for (std::size_t i{N}; i--;) {
+    out[i] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  }
+  return out + N;
+}
+} // namespace detail
+
+/// The value of VARIANT of type `VT_EMPTY`.
+struct Empty final {};
+
+/// The OLE Automation date. (Mirrors `DATE`.)
+struct Date final {
+  double value{};
+};
+
+/**
+ * @brief A value of one of the types of VARIANT which doesn't involve COM.
+ *
+ * @details The types are the ones of `detail::Variant_type_traits`. Strings
+ * are UTF-8 and are stored inline if they are not longer than
+ * `inline_capacity`, so the instances of this class can be passed around
+ * without any allocations in most cases. The conversion to and from
+ * Basic_variant is performed only on demand (see `to_variant()` and
+ * `to_native_variant()` of combase.hpp).
+ */
+class Native_variant final {
+public:
+  /// A value type. (Mirrors `VT_*` constants.)
+  enum class Type : std::uint16_t {
+    empty = 0,
+    int16 = 2,
+    int32 = 3,
+    real32 = 4,
+    real64 = 5,
+    date = 7,
+    string = 8,
+    boolean = 11,
+    int8 = 16,
+    uint8 = 17,
+    uint16 = 18,
+    uint32 = 19,
+    int64 = 20,
+    uint64 = 21
+  };
+
+  /// The maximum size of string which is stored inline.
+  static constexpr std::size_t inline_capacity{24};
+
+  /// The destructor.
+  ~Native_variant()
+  {
+    reset();
+  }
+
+  /// Constructs the empty instance.
+  Native_variant() noexcept = default;
+
+  /// @overload
+  Native_variant(Empty) noexcept
+  {}
+
+  /**
+   * @brief Constructs the instance of scalar value.
+   *
+   * @tparam T An arithmetic type or `Date`.
+   */
+  template<typename T,
+    typename = std::enable_if_t<std::is_arithmetic_v<T> ||
+      std::is_same_v<T, Date>>>
+  Native_variant(const T value) noexcept
+    : type_{type_of<T>()}
+  {
+    std::memcpy(storage_.bytes, &value, sizeof(T));
+  }
+
+  /// Constructs the instance of string value.
+  Native_variant(const std::string_view value)
+    : type_{Type::string}
+  {
+    assign(value);
+  }
+
+  /// @overload
+  Native_variant(const char* const value)
+    : Native_variant{std::string_view{value}}
+  {}
+
+  /// @overload
+  Native_variant(const std::string& value)
+    : Native_variant{std::string_view{value}}
+  {}
+
+  /// Copy-constructible.
+  Native_variant(const Native_variant& rhs)
+    : type_{rhs.type_}
+  {
+    if (rhs.is_heap_)
+      assign(rhs.string_view());
+    else {
+      storage_ = rhs.storage_;
+      inline_size_ = rhs.inline_size_;
+    }
+  }
+
+  /// Copy-assignable.
+  Native_variant& operator=(const Native_variant& rhs)
+  {
+    if (this != &rhs) {
+      Native_variant tmp{rhs};
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  /// Move-constructible.
+  Native_variant(Native_variant&& rhs) noexcept
+    : storage_{rhs.storage_}
+    , type_{rhs.type_}
+    , inline_size_{rhs.inline_size_}
+    , is_heap_{rhs.is_heap_}
+  {
+    rhs.type_ = Type::empty;
+    rhs.is_heap_ = false;
+  }
+
+  /// Move-assignable.
+  Native_variant& operator=(Native_variant&& rhs) noexcept
+  {
+    Native_variant tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  /// Swaps this instance with `rhs`.
+  void swap(Native_variant& rhs) noexcept
+  {
+    using std::swap;
+    swap(storage_, rhs.storage_);
+    swap(type_, rhs.type_);
+    swap(inline_size_, rhs.inline_size_);
+    swap(is_heap_, rhs.is_heap_);
+  }
+
+  /// @returns The type of the value.
+  Type type() const noexcept
+  {
+    return type_;
+  }
+
+  /// @returns `type() == Type::empty`.
+  bool is_empty() const noexcept
+  {
+    return type_ == Type::empty;
+  }
+
+  /// @returns `true` if the value is of type `T`.
+  template<typename T>
+  bool is() const noexcept
+  {
+    return type_ == type_of<T>();
+  }
+
+  /**
+   * @tparam T Any type accepted by the constructor, or `std::string_view`.
+   *
+   * @returns The value.
+   *
+   * @throws `std::logic_error` if the value is not of type `T`.
+   */
+  template<typename T>
+  T get() const
+  {
+    if (!is<T>())
+      throw std::logic_error{"cannot get Native_variant value of"
+        " requested type"};
+
+    if constexpr (std::is_same_v<T, std::string_view>)
+      return string_view();
+    else {
+      T result;
+      std::memcpy(&result, storage_.bytes, sizeof(T));
+      return result;
+    }
+  }
+
+  /// @returns `true` if `lhs` and `rhs` have the same type and value.
+  friend bool operator==(const Native_variant& lhs,
+    const Native_variant& rhs) noexcept
+  {
+    if (lhs.type_ != rhs.type_)
+      return false;
+    else if (lhs.type_ == Type::string)
+      return lhs.string_view() == rhs.string_view();
+    else
+      return !std::memcmp(lhs.storage_.bytes, rhs.storage_.bytes,
+        size_of(lhs.type_));
+  }
+
+private:
+  union Storage {
+    char bytes[inline_capacity];
+    struct {
+      char* data;
+      std::size_t size;
+    } heap;
+  };
+
+  Storage storage_{};
+  Type type_{Type::empty};
+  std::uint8_t inline_size_{};
+  bool is_heap_{};
+
+  /// @returns The type of values of type `T`.
+  template<typename T>
+  static constexpr Type type_of() noexcept
+  {
+    using D = std::remove_cv_t<T>;
+    using std::is_same_v;
+    if constexpr (is_same_v<D, Empty>)
+      return Type::empty;
+    else if constexpr (is_same_v<D, bool>)
+      return Type::boolean;
+    else if constexpr (is_same_v<D, float>)
+      return Type::real32;
+    else if constexpr (is_same_v<D, double>)
+      return Type::real64;
+    else if constexpr (is_same_v<D, Date>)
+      return Type::date;
+    else if constexpr (is_same_v<D, std::string_view>)
+      return Type::string;
+    else if constexpr (std::is_integral_v<D>) {
+      constexpr bool is_signed{std::is_signed_v<D>};
+      if constexpr (sizeof(D) == 1)
+        return is_signed ? Type::int8 : Type::uint8;
+      else if constexpr (sizeof(D) == 2)
+        return is_signed ? Type::int16 : Type::uint16;
+      else if constexpr (sizeof(D) == 4)
+        return is_signed ? Type::int32 : Type::uint32;
+      else if constexpr (sizeof(D) == 8)
+        return is_signed ? Type::int64 : Type::uint64;
+      else
+        static_assert(false_value<T>);
+    } else
+      static_assert(false_value<T>);
+  }
+
+  /// @returns The size of scalar value of type `type`.
+  static constexpr std::size_t size_of(const Type type) noexcept
+  {
+    switch (type) {
+    case Type::int8: case Type::uint8: case Type::boolean:
+      return 1;
+    case Type::int16: case Type::uint16:
+      return 2;
+    case Type::int32: case Type::uint32: case Type::real32:
+      return 4;
+    case Type::int64: case Type::uint64: case Type::real64: case Type::date:
+      return 8;
+    default:
+      return 0;
+    }
+  }
+
+  std::string_view string_view() const noexcept
+  {
+    return is_heap_ ? std::string_view{storage_.heap.data, storage_.heap.size} :
+      std::string_view{storage_.bytes, inline_size_};
+  }
+
+  /// Stores `value` as the string.
+  void assign(const std::string_view value)
+  {
+    if (value.size() <= inline_capacity) {
+      std::memcpy(storage_.bytes, value.data(), value.size());
+      inline_size_ = static_cast<std::uint8_t>(value.size());
+    } else {
+      storage_.heap.data = new char[value.size()];
+      std::memcpy(storage_.heap.data, value.data(), value.size());
+      storage_.heap.size = value.size();
+      is_heap_ = true;
+    }
+  }
+
+  void reset() noexcept
+  {
+    if (is_heap_) {
+      delete [] storage_.heap.data;
+      is_heap_ = false;
+    }
+    type_ = Type::empty;
+  }
+};
+
+/**
+ * @brief Invokes `f` with the value of `variant`.
+ *
+ * @details `f` is invoked with `Empty` for the empty value, with
+ * `std::string_view` for strings and with the value of the corresponding type
+ * otherwise (integers are passed as `std::int8_t`, ..., `std::uint64_t`).
+ *
+ * @returns The result of `f`. All the overloads of `f` must return the type
+ * which is returned for `Empty`.
+ */
+template<class F>
+decltype(auto) visit(const Native_variant& variant, F&& f)
+{
+  using Type = Native_variant::Type;
+  using R = std::invoke_result_t<F&, Empty>;
+  switch (variant.type()) {
+  case Type::int8: return static_cast<R>(f(variant.get<std::int8_t>()));
+  case Type::uint8: return static_cast<R>(f(variant.get<std::uint8_t>()));
+  case Type::int16: return static_cast<R>(f(variant.get<std::int16_t>()));
+  case Type::uint16: return static_cast<R>(f(variant.get<std::uint16_t>()));
+  case Type::int32: return static_cast<R>(f(variant.get<std::int32_t>()));
+  case Type::uint32: return static_cast<R>(f(variant.get<std::uint32_t>()));
+  case Type::int64: return static_cast<R>(f(variant.get<std::int64_t>()));
+  case Type::uint64: return static_cast<R>(f(variant.get<std::uint64_t>()));
+  case Type::real32: return static_cast<R>(f(variant.get<float>()));
+  case Type::real64: return static_cast<R>(f(variant.get<double>()));
+  case Type::boolean: return static_cast<R>(f(variant.get<bool>()));
+  case Type::date: return static_cast<R>(f(variant.get<Date>()));
+  case Type::string: return static_cast<R>(f(variant.get<std::string_view>()));
+  case Type::empty: break;
+  }
+  return static_cast<R>(f(Empty{}));
+}
+
+static_assert(sizeof(Native_variant) <= 32);
+
+} // namespace dmitigr::winbase::com
@@ -17,9 +17,11 @@
 #pragma once
 
 #include "../base/noncopymove.hpp"
+#include "memory.hpp"
 #include "windows.hpp"
 
 #include <algorithm>
+#include <cstddef>
 #include <utility>
 
 namespace dmitigr::winbase {
@@ -91,4 +93,46 @@ private:
   HLOCAL handle_{NULL};
 };
 
+/// The memory source of `LocalAlloc()`.
+struct Hlocal_source final {
+  /// The alignment of allocated blocks.
+  static constexpr std::size_t alignment{MEMORY_ALLOCATION_ALIGNMENT};
+
+  /// @returns The block of `size` bytes, or null on failure.
+  void* allocate(const std::size_t size) const noexcept
+  {
+    return LocalAlloc(LMEM_FIXED, size);
+  }
+
+  /// @returns The `block` resized to `size` bytes, or null on failure.
+  void* reallocate(void* const block, const std::size_t size) const noexcept
+  {
+    return LocalReAlloc(block, size, LMEM_MOVEABLE);
+  }
+
+  /// Releases the `block`.
+  void deallocate(void* const block) const noexcept
+  {
+    LocalFree(block);
+  }
+};
+
+/// The memory resource of `LocalAlloc()`.
+using Hlocal_resource = Basic_memory_resource<Hlocal_source>;
+
+/**
+ * @brief The buffer to be handed over to the code which calls `LocalFree()`.
+ *
+ * @details The result of `release()` can be owned by `Hlocal_guard`.
+ */
+template<typename T>
+using Hlocal_buffer = Basic_outbound_buffer<T, Hlocal_source>;
+
+/// @returns The memory resource of `LocalAlloc()`.
+inline Hlocal_resource* hlocal_resource() noexcept
+{
+  static Hlocal_resource result;
+  return &result;
+}
+
 } // namespace dmitigr::winbase
@@ -0,0 +1,347 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK.
+
+#pragma once
+
+#include "../base/noncopymove.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace dmitigr::winbase {
+
+// -----------------------------------------------------------------------------
+// Memory sources
+// -----------------------------------------------------------------------------
+
+/*
+ * The memory sources wrap the allocation functions whose memory can be handed
+ * over to the foreign code (e.g. `CoTaskMemAlloc()` or `LocalAlloc()`). They
+ * have the following interface:
+ *
+ *   - `static constexpr std::size_t alignment` is the alignment of allocated
+ *   blocks;
+ *   - `void* allocate(std::size_t size) noexcept` returns the block of `size`
+ *   bytes, or null on failure;
+ *   - `void* reallocate(void* block, std::size_t size) noexcept` returns the
+ *   `block` resized to `size` bytes (possibly moved), or null on failure (the
+ *   `block` is left intact in this case);
+ *   - `void deallocate(void* block) noexcept` releases the `block` (ignores
+ *   null).
+ */
+
+/// The memory source of `std::malloc()`.
+struct Malloc_source final {
+  /// The alignment of allocated blocks.
+  static constexpr std::size_t alignment{alignof(std::max_align_t)};
+
+  /// @returns The block of `size` bytes, or null on failure.
+  void* allocate(const std::size_t size) const noexcept
+  {
+    return std::malloc(size ? size : 1);
+  }
+
+  /// @returns The `block` resized to `size` bytes, or null on failure.
+  void* reallocate(void* const block, const std::size_t size) const noexcept
+  {
+    return std::realloc(block, size ? size : 1);
+  }
+
+  /// Releases the `block`.
+  void deallocate(void* const block) const noexcept
+  {
+    std::free(block);
+  }
+};
+
+/**
+ * @brief The memory resource which allocates every block from `Source`.
+ *
+ * @details Since the blocks are not sub-allocated, each of them can be handed
+ * over to the foreign code which releases it by the function of `Source`.
+ * This resource can also be used as the upstream of
+ * `std::pmr::unsynchronized_pool_resource` or
+ * `std::pmr::monotonic_buffer_resource` for the memory which is not handed
+ * over. (Only the blocks aligned to at most `Source::alignment` can be handed
+ * over.)
+ *
+ * @remarks The instances over the same stateless `Source` are interchangeable.
+ */
+template<class Source>
+class Basic_memory_resource final : public std::pmr::memory_resource,
+  private Noncopymove {
+public:
+  /// The constructor.
+  explicit Basic_memory_resource(Source source = {})
+    : source_{std::move(source)}
+  {}
+
+  /// @returns The source.
+  const Source& source() const noexcept
+  {
+    return source_;
+  }
+
+private:
+  Source source_;
+
+  /*
+   * The blocks of alignment greater than the source's one are over-allocated
+   * and the pointer to the underlying block is stored right before them.
+   * (Such blocks cannot be handed over.)
+   */
+
+  void* do_allocate(const std::size_t bytes,
+    const std::size_t alignment) override
+  {
+    if (alignment <= Source::alignment) {
+      if (void* const result = source_.allocate(bytes))
+        return result;
+      throw std::bad_alloc{};
+    }
+
+    if (bytes > std::numeric_limits<std::size_t>::max() - alignment -
+      sizeof(void*))
+      throw std::bad_alloc{};
+    void* const block{source_.allocate(bytes + alignment + sizeof(void*))};
+    if (!block)
+      throw std::bad_alloc{};
+    const auto address = reinterpret_cast<std::uintptr_t>(block) +
+      sizeof(void*);
+    auto* const result = reinterpret_cast<std::byte*>(
+      (address + alignment - 1) & ~(alignment - 1));
+    std::memcpy(result - sizeof(void*), &block, sizeof(void*));
+    return result;
+  }
+
+  void do_deallocate(void* const block, std::size_t,
+    const std::size_t alignment) override
+  {
+    if (alignment <= Source::alignment)
+      source_.deallocate(block);
+    else {
+      void* underlying{};
+      std::memcpy(&underlying, static_cast<std::byte*>(block) - sizeof(void*),
+        sizeof(void*));
+      source_.deallocate(underlying);
+    }
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& rhs) const noexcept override
+  {
+    if constexpr (std::is_empty_v<Source>)
+      return dynamic_cast<const Basic_memory_resource*>(&rhs);
+    else
+      return this == &rhs;
+  }
+};
+
+/**
+ * @brief The growable buffer of `T` allocated from `Source` as a single block,
+ * which can be released to the foreign code without copying.
+ *
+ * @details The buffer grows by `Source::reallocate()`, so the block is not
+ * copied when it can be resized in place.
+ */
+template<typename T, class Source>
+class Basic_outbound_buffer final : private Noncopy {
+public:
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert(alignof(T) <= Source::alignment);
+
+  /// The destructor.
+  ~Basic_outbound_buffer()
+  {
+    source_.deallocate(data_);
+  }
+
+  /// The constructor.
+  explicit Basic_outbound_buffer(Source source = {})
+    : source_{std::move(source)}
+  {}
+
+  /// The move constructor.
+  Basic_outbound_buffer(Basic_outbound_buffer&& rhs) noexcept
+    : source_{std::move(rhs.source_)}
+    , data_{std::exchange(rhs.data_, nullptr)}
+    , size_{std::exchange(rhs.size_, 0)}
+    , capacity_{std::exchange(rhs.capacity_, 0)}
+  {}
+
+  /// The move assignment operator.
+  Basic_outbound_buffer& operator=(Basic_outbound_buffer&& rhs) noexcept
+  {
+    if (this != &rhs) {
+      Basic_outbound_buffer tmp{std::move(rhs)};
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  /// The swap operation.
+  void swap(Basic_outbound_buffer& other) noexcept
+  {
+    using std::swap;
+    swap(source_, other.source_);
+    swap(data_, other.data_);
+    swap(size_, other.size_);
+    swap(capacity_, other.capacity_);
+  }
+
+  /// @returns The elements.
+  T* data() noexcept
+  {
+    return data_;
+  }
+
+  /// @overload
+  const T* data() const noexcept
+  {
+    return data_;
+  }
+
+  /// @returns The number of elements.
+  std::size_t size() const noexcept
+  {
+    return size_;
+  }
+
+  /// @returns The number of elements which fit without reallocation.
+  std::size_t capacity() const noexcept
+  {
+    return capacity_;
+  }
+
+  /// @returns The view of elements.
+  std::span<T> span() noexcept
+  {
+    return {data_, size_};
+  }
+
+  /// @overload
+  std::span<const T> span() const noexcept
+  {
+    return {data_, size_};
+  }
+
+  /// Ensures the capacity of at least `capacity` elements.
+  void reserve(const std::size_t capacity)
+  {
+    if (capacity > capacity_)
+      reallocate(capacity);
+  }
+
+  /// Resizes the buffer. (The new elements are value-initialized.)
+  void resize(const std::size_t size)
+  {
+    if (size > capacity_)
+      reallocate(std::max(size, grown_capacity()));
+    if (size > size_)
+      std::uninitialized_value_construct(data_ + size_, data_ + size);
+    size_ = size;
+  }
+
+  /// Appends `value`. (Which may refer to the element of this buffer.)
+  void push_back(const T& value)
+  {
+    const T copy{value}; // value is invalidated by reallocation
+    if (size_ == capacity_)
+      reallocate(grown_capacity());
+    data_[size_++] = copy;
+  }
+
+  /// Appends `values`. (Which may refer to the elements of this buffer.)
+  void append(std::span<const T> values)
+  {
+    if (values.size() > capacity_ - size_) {
+      if (values.size() > max_size() - size_)
+        throw std::bad_alloc{};
+      // The elements of this buffer are invalidated by reallocation.
+      const bool is_own{!values.empty() && data_ &&
+        std::less_equal<>{}(data_, values.data()) &&
+        std::less<>{}(values.data(), data_ + size_)};
+      const auto offset = is_own ? values.data() - data_ : 0;
+      reallocate(std::max(size_ + values.size(), grown_capacity()));
+      if (is_own)
+        values = {data_ + offset, values.size()};
+    }
+    if (!values.empty())
+      std::memcpy(data_ + size_, values.data(), values.size()*sizeof(T));
+    size_ += values.size();
+  }
+
+  /// Reduces the capacity to the size (unless the buffer is empty).
+  void shrink_to_fit()
+  {
+    if (size_ && size_ < capacity_)
+      reallocate(size_);
+  }
+
+  /**
+   * @returns The block of elements. The buffer is left empty.
+   *
+   * @remarks The caller is responsible to release the result by the function
+   * of `Source` (e.g. by the code the result is handed over to).
+   */
+  T* release() noexcept
+  {
+    size_ = capacity_ = 0;
+    return std::exchange(data_, nullptr);
+  }
+
+private:
+  Source source_;
+  T* data_{};
+  std::size_t size_{};
+  std::size_t capacity_{};
+
+  static constexpr std::size_t max_size() noexcept
+  {
+    return std::numeric_limits<std::size_t>::max() / sizeof(T);
+  }
+
+  std::size_t grown_capacity() const noexcept
+  {
+    return capacity_ ? std::min(capacity_ * 2, max_size()) : 8;
+  }
+
+  void reallocate(const std::size_t capacity)
+  {
+    if (capacity > max_size())
+      throw std::bad_alloc{};
+    void* const block{data_ ? source_.reallocate(data_, capacity*sizeof(T)) :
+      source_.allocate(capacity*sizeof(T))};
+    if (!block)
+      throw std::bad_alloc{};
+    data_ = static_cast<T*>(block);
+    capacity_ = capacity;
+  }
+};
+
+} // namespace dmitigr::winbase
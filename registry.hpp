@@ -16,16 +16,30 @@
 
 #pragma once
 #pragma comment(lib, "advapi32")
+#pragma comment(lib, "ktmw32")
 
 #include "../base/assert.hpp"
 #include "../base/noncopymove.hpp"
 #include "../base/traits.hpp"
 #include "exceptions.hpp"
+#include "hguard.hpp"
+#include "registry_backend.hpp"
+#include "registry_batch.hpp"
+#include "registry_image.hpp"
+#include "registry_snapshot.hpp"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <optional>
+#include <span>
 #include <stdexcept>
 #include <type_traits>
 #include <utility>
+#include <vector>
+
+#include <ktmw32.h>
 
 namespace dmitigr::winbase::registry {
 
@@ -106,6 +120,21 @@ inline Hkey_guard open_key(const HKEY key, LPCWSTR const subkey, const REGSAM ma
   return Hkey_guard{result};
 }
 
+/**
+ * @returns The predefined `key` of the registry of the remote `host`.
+ *
+ * @remarks The returned key can be used with System_backend, for example, to
+ * run operations on remote hosts by Async_executor.
+ */
+inline Hkey_guard connect(LPCWSTR const host, const HKEY key)
+{
+  HKEY result{};
+  const auto err = RegConnectRegistryW(host, key, &result);
+  if (err != ERROR_SUCCESS)
+    throw Sys_exception{static_cast<DWORD>(err), "cannot connect to registry"};
+  return Hkey_guard{result};
+}
+
 /// @returns A pair with created/opened key and disposition information.
 inline std::pair<Hkey_guard, DWORD>
 create_key(const HKEY key, LPCWSTR const subkey,
@@ -144,18 +173,40 @@ inline void set_value(const HKEY key, LPCWSTR const name, const DWORD type,
     throw Sys_exception{static_cast<DWORD>(err), "cannot set value of registry key"};
 }
 
+/**
+ * @tparam T The value type. Can be `DWORD` (REG_DWORD), `std::uint64_t`
+ * (REG_QWORD), `LPCWSTR` or `std::wstring` (REG_SZ), `Expand_sz`
+ * (REG_EXPAND_SZ), `Multi_sz` (REG_MULTI_SZ), or any type convertible to
+ * `std::span<const std::byte>` (REG_BINARY).
+ */
 template<typename T>
 void set_value(const HKEY key, LPCWSTR const name, const T& value)
 {
-  if constexpr (std::is_same_v<T, DWORD>) {
-    set_value(key, name, REG_DWORD, reinterpret_cast<const BYTE*>(&value), sizeof(T));
+  const auto set_wstring = [key, name](const DWORD type, const std::wstring& str)
+  {
+    const auto* const bytes = reinterpret_cast<const BYTE*>(str.c_str());
+    set_value(key, name, type, bytes,
+      static_cast<DWORD>(sizeof(std::wstring::value_type)*(str.size() + 1)));
+  };
+
+  if constexpr (std::is_same_v<T, DWORD> || std::is_same_v<T, std::uint64_t>) {
+    set_value(key, name, sizeof(T) == 4 ? REG_DWORD : REG_QWORD,
+      reinterpret_cast<const BYTE*>(&value), sizeof(T));
   } else if constexpr (std::is_same_v<T, LPCWSTR>) {
     const auto* const bytes = reinterpret_cast<const BYTE*>(value);
     set_value(key, name, REG_SZ, bytes, sizeof(*value)*(lstrlenW(value) + 1));
   } else if constexpr (std::is_same_v<T, std::wstring>) {
-    const auto* const bytes = reinterpret_cast<const BYTE*>(value.c_str());
-    set_value(key, name, REG_SZ, bytes,
-      sizeof(std::wstring::value_type)*(value.size() + 1));
+    set_wstring(REG_SZ, value);
+  } else if constexpr (std::is_same_v<T, Expand_sz>) {
+    set_wstring(REG_EXPAND_SZ, value.value);
+  } else if constexpr (std::is_same_v<T, Multi_sz>) {
+    const auto& buf = value.buffer();
+    set_value(key, name, REG_MULTI_SZ, reinterpret_cast<const BYTE*>(buf.data()),
+      static_cast<DWORD>(sizeof(std::wstring::value_type)*buf.size()));
+  } else if constexpr (std::is_convertible_v<const T&, std::span<const std::byte>>) {
+    const std::span<const std::byte> bytes{value};
+    set_value(key, name, REG_BINARY, reinterpret_cast<const BYTE*>(bytes.data()),
+      static_cast<DWORD>(bytes.size()));
   } else
     static_assert(false_value<T>, "unsupported type specified");
 }
@@ -220,13 +271,84 @@ inline DWORD required_buffer_size(const HKEY key,
   return result;
 }
 
+namespace detail {
+
+/**
+ * @brief Reads the value into `result`.
+ *
+ * @details The value is read into an on-stack buffer first. The heap is only
+ * used if the value doesn't fit into that buffer, in which case the value is
+ * re-read until `ERROR_MORE_DATA` is no longer reported (the value may grow
+ * between calls).
+ *
+ * @tparam R A contiguous container of trivial elements.
+ *
+ * @returns The error code.
+ */
+template<class R>
+LSTATUS get_value(const HKEY key, LPCWSTR const subkey, LPCWSTR const name,
+  const DWORD flags, R& result)
+{
+  using Char = typename R::value_type;
+  constexpr const auto char_size = sizeof(Char);
+  static_assert(char_size <= sizeof(wchar_t));
+  static const auto check_size = [](const DWORD size)
+  {
+    if (size % char_size)
+      throw std::runtime_error{"cannot get value from registry:"
+        " incompatible destination type"};
+  };
+
+  // Fast path: one call and no heap allocations until the result is made.
+  wchar_t stack_buf[256];
+  DWORD buf_size{sizeof(stack_buf)};
+  auto err = RegGetValueW(key, subkey, name, flags, NULL, stack_buf, &buf_size);
+  if (err == ERROR_SUCCESS) {
+    check_size(buf_size);
+    const auto* const chars = reinterpret_cast<const Char*>(stack_buf);
+    result.assign(chars, chars + buf_size/char_size);
+    return err;
+  }
+
+  // Slow path: the value doesn't fit into the stack buffer.
+  while (err == ERROR_MORE_DATA) {
+    result.resize(buf_size/char_size + bool(buf_size % char_size));
+    buf_size = static_cast<DWORD>(result.size()*char_size);
+    err = RegGetValueW(key, subkey, name, flags, NULL, result.data(), &buf_size);
+  }
+  if (err == ERROR_SUCCESS) {
+    check_size(buf_size);
+    DMITIGR_ASSERT(buf_size <= result.size()*char_size);
+    result.resize(buf_size/char_size);
+  }
+  return err;
+}
+
+/// Removes the terminating null of the string read by get_value().
+template<class S>
+void trim_null(S& str)
+{
+  constexpr auto null_size = sizeof(wchar_t)/sizeof(typename S::value_type);
+  if (str.size() >= null_size && std::all_of(str.end() - null_size, str.end(),
+      [](const auto ch){return !ch;}))
+    str.resize(str.size() - null_size);
+}
+
+} // namespace detail
+
 /**
- * @tparam T The result type.
+ * @tparam T The result type. Can be `DWORD` (REG_DWORD), `std::uint64_t`
+ * (REG_QWORD), `std::string` or `std::wstring` (REG_SZ), `Expand_sz`
+ * (REG_EXPAND_SZ, unexpanded), `Multi_sz` (REG_MULTI_SZ) or
+ * `std::vector<std::byte>` (REG_BINARY).
  *
- * @returns The string stored in the registry.
+ * @details Strings and binaries are read through an on-stack buffer first,
+ * so short values take one system call. (See detail::get_value().)
  *
- * @throws `std::runtime_error` if `T` is `std::wstring` and
- * `required_buffer_size(key, subkey, name) % sizeof(T::value_type) != 0`.
+ * @returns The value stored in the registry.
+ *
+ * @throws `std::runtime_error` if `T` is `std::wstring` and the size of the
+ * stored string in bytes is not a multiple of `sizeof(T::value_type)`.
  */
 template<typename T>
 std::optional<T> value(const HKEY key, LPCWSTR const subkey, LPCWSTR const name)
@@ -245,36 +367,35 @@ std::optional<T> value(const HKEY key, LPCWSTR const subkey, LPCWSTR const name)
 
   using Type = std::decay_t<T>;
   using std::is_same_v;
-  if constexpr (is_same_v<Type, DWORD>) {
-    DWORD result{};
+  if constexpr (is_same_v<Type, DWORD> || is_same_v<Type, std::uint64_t>) {
+    Type result{};
     DWORD result_size{sizeof(result)};
     const auto err = RegGetValueW(key,
       subkey,
       name,
-      RRF_RT_REG_DWORD,
+      sizeof(Type) == 4 ? RRF_RT_REG_DWORD : RRF_RT_REG_QWORD,
       NULL, // FIXME: support REG_DWORD_BIG_ENDIAN
       &result,
       &result_size);
     return result_or_throw(std::move(result), err);
   } else if constexpr (is_same_v<Type, std::string> || is_same_v<Type, std::wstring>) {
-    constexpr const auto char_size = sizeof(typename Type::value_type);
-    static_assert(char_size <= sizeof(wchar_t));
-    auto buf_size = required_buffer_size(key, subkey, name);
-    if (!buf_size)
-      return std::nullopt;
-    else if (buf_size % char_size)
-      throw std::runtime_error{"cannot get string (REG_SZ) from registry:"
-        " incompatible destination string type"};
-    Type result(buf_size/char_size - sizeof(wchar_t)/char_size, 0);
-    const auto err = RegGetValueW(key,
-      subkey,
-      name,
-      RRF_RT_REG_SZ,
-      NULL,
-      result.data(),
-      &buf_size);
-    DMITIGR_ASSERT(buf_size == result.size()*char_size ||
-      buf_size == (result.size() + 1)*char_size);
+    Type result;
+    const auto err = detail::get_value(key, subkey, name, RRF_RT_REG_SZ, result);
+    detail::trim_null(result);
+    return result_or_throw(std::move(result), err);
+  } else if constexpr (is_same_v<Type, Expand_sz>) {
+    Expand_sz result;
+    const auto err = detail::get_value(key, subkey, name,
+      RRF_RT_REG_EXPAND_SZ | RRF_NOEXPAND, result.value);
+    detail::trim_null(result.value);
+    return result_or_throw(std::move(result), err);
+  } else if constexpr (is_same_v<Type, Multi_sz>) {
+    std::wstring buf;
+    const auto err = detail::get_value(key, subkey, name, RRF_RT_REG_MULTI_SZ, buf);
+    return result_or_throw(Multi_sz(std::move(buf)), err);
+  } else if constexpr (is_same_v<Type, std::vector<std::byte>>) {
+    Type result;
+    const auto err = detail::get_value(key, subkey, name, RRF_RT_REG_BINARY, result);
     return result_or_throw(std::move(result), err);
   } else
     static_assert(false_value<T>, "unsupported type specified");
@@ -288,4 +409,286 @@ std::optional<T> value(const HKEY key, const std::wstring& subkey,
   return value<T>(key, subkey.c_str(), name.c_str());
 }
 
+/**
+ * @returns The snapshot of all the values of `key`.
+ *
+ * @details The whole snapshot is retaken if the key is modified concurrently.
+ *
+ * @see snapshot(Backend&, Key_handle).
+ */
+inline Key_snapshot snapshot(HKEY key);
+
+/**
+ * @returns The snapshot of all the values of `subkey` of `key`, or
+ * `std::nullopt` if no such a subkey.
+ */
+inline std::optional<Key_snapshot> snapshot(const HKEY key, LPCWSTR const subkey)
+{
+  const auto subkey_guard = open_key(key, subkey, KEY_QUERY_VALUE);
+  if (!subkey_guard)
+    return std::nullopt;
+  return snapshot(subkey_guard);
+}
+
+/// @overload
+inline std::optional<Key_snapshot> snapshot(const HKEY key,
+  const std::wstring& subkey)
+{
+  return snapshot(key, subkey.c_str());
+}
+
+/// @returns The names of subkeys of `key`.
+inline std::vector<std::wstring> subkey_names(const HKEY key)
+{
+  DWORD count{};
+  if (const auto err = RegQueryInfoKeyW(key, NULL, NULL, NULL, &count, NULL,
+      NULL, NULL, NULL, NULL, NULL, NULL); err != ERROR_SUCCESS)
+    throw Sys_exception{static_cast<DWORD>(err),
+      "cannot query info of registry key"};
+
+  std::vector<std::wstring> result;
+  result.reserve(count);
+  wchar_t name[256]; // the maximum key name length is 255 characters
+  for (DWORD i{};; ++i) {
+    DWORD name_size{sizeof(name)/sizeof(*name)};
+    const auto err = RegEnumKeyExW(key, i, name, &name_size, NULL, NULL, NULL, NULL);
+    if (err == ERROR_NO_MORE_ITEMS)
+      break;
+    else if (err != ERROR_SUCCESS)
+      throw Sys_exception{static_cast<DWORD>(err),
+        "cannot enumerate subkeys of registry key"};
+    result.emplace_back(name, name_size);
+  }
+  return result;
+}
+
+/**
+ * @brief Adds the subtree of `key` to `writer`.
+ *
+ * @param path The path of `key` in the image.
+ */
+inline void add_subtree(Image_writer& writer, const HKEY key,
+  const std::wstring& path = {})
+{
+  writer.add_key(path, snapshot(key));
+  for (const auto& name : subkey_names(key)) {
+    if (const auto subkey = open_key(key, name.c_str(), KEY_READ))
+      add_subtree(writer, subkey, path.empty() ? name : path + L'\\' + name);
+  }
+}
+
+/**
+ * @brief Writes the image of the subtree of `subkey` of `key` to the file.
+ *
+ * @returns `false` if no such a subkey.
+ *
+ * @see Image.
+ */
+inline bool write_image(const std::filesystem::path& path,
+  const HKEY key, LPCWSTR const subkey)
+{
+  const auto root = open_key(key, subkey, KEY_READ);
+  if (!root)
+    return false;
+  Image_writer writer;
+  add_subtree(writer, root);
+  writer.write(path);
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// System_backend
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief The backend of the system registry.
+ *
+ * @details If the backend is bound to a kernel transaction, all the operations
+ * are performed as part of that transaction.
+ */
+class System_backend final : public Backend {
+public:
+  /**
+   * @brief The constructor.
+   *
+   * @param transaction The kernel transaction handle, or `NULL`.
+   */
+  explicit System_backend(const HANDLE transaction = NULL) noexcept
+    : transaction_{transaction}
+  {}
+
+  Key_handle root(const Root root) const noexcept override
+  {
+    switch (root) {
+    case Root::classes_root: return HKEY_CLASSES_ROOT;
+    case Root::current_user: return HKEY_CURRENT_USER;
+    case Root::local_machine: return HKEY_LOCAL_MACHINE;
+    case Root::users: return HKEY_USERS;
+    case Root::current_config: return HKEY_CURRENT_CONFIG;
+    }
+    return {};
+  }
+
+  Status open_key(const Key_handle key, const wchar_t* const subkey,
+    const Access access, Key_handle& result) override
+  {
+    HKEY res{};
+    const auto err = transaction_ ?
+      RegOpenKeyTransactedW(hkey(key), subkey, 0, static_cast<REGSAM>(access),
+        &res, transaction_, NULL) :
+      RegOpenKeyExW(hkey(key), subkey, 0, static_cast<REGSAM>(access), &res);
+    result = res;
+    return status(err);
+  }
+
+  Status create_key(const Key_handle key, const wchar_t* const subkey,
+    const Access access, Key_handle& result, bool& is_created) override
+  {
+    HKEY res{};
+    DWORD disp{};
+    const auto err = transaction_ ?
+      RegCreateKeyTransactedW(hkey(key), subkey, 0, NULL,
+        REG_OPTION_NON_VOLATILE, static_cast<REGSAM>(access), NULL, &res, &disp,
+        transaction_, NULL) :
+      RegCreateKeyExW(hkey(key), subkey, 0, NULL,
+        REG_OPTION_NON_VOLATILE, static_cast<REGSAM>(access), NULL, &res, &disp);
+    result = res;
+    is_created = disp == REG_CREATED_NEW_KEY;
+    return status(err);
+  }
+
+  Status close_key(const Key_handle key) noexcept override
+  {
+    return status(RegCloseKey(hkey(key)));
+  }
+
+  Status query_info(const Key_handle key, Key_info& result) override
+  {
+    DWORD subkey_count{};
+    DWORD max_subkey_name_size{};
+    DWORD value_count{};
+    DWORD max_value_name_size{};
+    DWORD max_value_data_size{};
+    const auto err = RegQueryInfoKeyW(hkey(key), NULL, NULL, NULL,
+      &subkey_count, &max_subkey_name_size, NULL, &value_count,
+      &max_value_name_size, &max_value_data_size, NULL, NULL);
+    result.subkey_count = subkey_count;
+    result.max_subkey_name_size = max_subkey_name_size;
+    result.value_count = value_count;
+    result.max_value_name_size = max_value_name_size;
+    result.max_value_data_size = max_value_data_size;
+    return status(err);
+  }
+
+  Status enum_key(const Key_handle key, const std::uint32_t index,
+    wchar_t* const name, std::uint32_t& name_size) override
+  {
+    DWORD nsz{name_size};
+    const auto err = RegEnumKeyExW(hkey(key), index, name, &nsz,
+      NULL, NULL, NULL, NULL);
+    name_size = nsz;
+    return status(err);
+  }
+
+  Status enum_value(const Key_handle key, const std::uint32_t index,
+    wchar_t* const name, std::uint32_t& name_size, Value_type& type,
+    std::byte* const data, std::uint32_t& data_size) override
+  {
+    DWORD nsz{name_size};
+    DWORD tp{};
+    DWORD dsz{data_size};
+    const auto err = RegEnumValueW(hkey(key), index, name, &nsz, NULL, &tp,
+      reinterpret_cast<LPBYTE>(data), &dsz);
+    name_size = nsz;
+    type = static_cast<Value_type>(tp);
+    data_size = dsz;
+    return status(err);
+  }
+
+  Status get_value(const Key_handle key, const wchar_t* const subkey,
+    const wchar_t* const name, Value_type& type, std::byte* const data,
+    std::uint32_t& data_size) override
+  {
+    Hkey_guard sub;
+    if (transaction_ && subkey) {
+      Key_handle res{};
+      if (const auto err = open_key(key, subkey, Access::read, res); !is_ok(err))
+        return err;
+      sub = Hkey_guard{hkey(res)};
+    }
+    DWORD tp{};
+    DWORD dsz{data_size};
+    const auto err = RegGetValueW(sub ? sub : hkey(key), sub ? NULL : subkey,
+      name, RRF_RT_ANY | RRF_NOEXPAND, &tp, data, &dsz);
+    type = static_cast<Value_type>(tp);
+    data_size = dsz;
+    return status(err);
+  }
+
+  Status set_value(const Key_handle key, const wchar_t* const name,
+    const Value_type type, const std::byte* const data,
+    const std::uint32_t data_size) override
+  {
+    return status(RegSetValueExW(hkey(key), name, 0, static_cast<DWORD>(type),
+      reinterpret_cast<const BYTE*>(data), data_size));
+  }
+
+  Status remove_value(const Key_handle key, const wchar_t* const subkey,
+    const wchar_t* const name) override
+  {
+    if (!transaction_)
+      return status(RegDeleteKeyValueW(hkey(key), subkey, name));
+
+    Hkey_guard sub;
+    if (subkey) {
+      Key_handle res{};
+      if (const auto err = open_key(key, subkey, Access::write, res); !is_ok(err))
+        return err;
+      sub = Hkey_guard{hkey(res)};
+    }
+    return status(RegDeleteValueW(sub ? sub : hkey(key), name));
+  }
+
+  Status remove_key(const Key_handle key, const wchar_t* const subkey) override
+  {
+    return status(transaction_ ?
+      RegDeleteKeyTransactedW(hkey(key), subkey, 0, 0, transaction_, NULL) :
+      RegDeleteKeyW(hkey(key), subkey));
+  }
+
+private:
+  HANDLE transaction_{};
+
+  static HKEY hkey(const Key_handle key) noexcept
+  {
+    return static_cast<HKEY>(key);
+  }
+
+  static Status status(const LSTATUS err) noexcept
+  {
+    return static_cast<Status>(err);
+  }
+};
+
+inline Key_snapshot snapshot(const HKEY key)
+{
+  System_backend backend;
+  return snapshot(backend, key);
+}
+
+/**
+ * @brief Applies `batch` to `root` atomically by using a kernel transaction.
+ *
+ * @details If a kernel transaction cannot be created (for example, it's not
+ * supported), the batch is applied without it.
+ */
+inline void apply(const Batch& batch, const HKEY root)
+{
+  const Handle_guard transaction{CreateTransaction(NULL, NULL, 0, 0, 0, 0, NULL)};
+  System_backend backend{transaction ? transaction.handle() : NULL};
+  batch.apply(backend, root);
+  if (transaction && !CommitTransaction(transaction))
+    throw Sys_exception{"cannot commit registry batch"};
+}
+
 } // namespace dmitigr::winbase::registry
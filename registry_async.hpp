@@ -0,0 +1,305 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK.
+
+#pragma once
+
+#include "../base/noncopymove.hpp"
+#include "registry_backend.hpp"
+#include "registry_value.hpp"
+
+#include <any>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::winbase::registry {
+
+/**
+ * @brief An executor of registry operations on the pool of worker threads.
+ *
+ * @details Each operation is tagged by the host the key belongs to (the empty
+ * host denotes the local machine), and at most `host_limit` operations per
+ * host are executed concurrently. Hosts with pending operations are served in
+ * round-robin order, so a slow host can't starve the others.
+ *
+ * Identical reads (of the same host, key, subkey, name and result type) which
+ * are in flight are coalesced: the callers share the single future.
+ *
+ * @par Lifetime
+ * The keys passed to operations must remain opened until the operations are
+ * completed. The operations which are pending on destruction of the executor
+ * are abandoned (their futures throw `std::future_error`).
+ */
+class Async_executor final : private Noncopy {
+public:
+  /// Stops the workers.
+  ~Async_executor()
+  {
+    {
+      const std::lock_guard lock{mutex_};
+      is_stopped_ = true;
+    }
+    cond_.notify_all();
+    for (auto& worker : workers_)
+      worker.join();
+  }
+
+  /**
+   * @brief The constructor.
+   *
+   * @par Requires
+   * `thread_count > 0 && host_limit > 0`.
+   */
+  explicit Async_executor(Backend& backend, const std::size_t thread_count = 8,
+    const std::size_t host_limit = 2)
+    : backend_{backend}
+    , host_limit_{host_limit}
+  {
+    if (!thread_count || !host_limit)
+      throw std::invalid_argument{"cannot create registry executor:"
+        " invalid limits"};
+
+    workers_.reserve(thread_count);
+    for (std::size_t i{}; i < thread_count; ++i)
+      workers_.emplace_back([this]{work();});
+  }
+
+  /// @returns The future of registry::open_key().
+  std::future<Key_guard> open_key(std::wstring host, const Key_handle key,
+    std::wstring subkey, const Access access = Access::read)
+  {
+    return run<Key_guard>(std::move(host),
+      [this, key, subkey = std::move(subkey), access]
+      {
+        return registry::open_key(backend_, key, c_str(subkey), access);
+      });
+  }
+
+  /// @returns The future of registry::value().
+  template<typename T>
+  std::shared_future<std::optional<T>> value(std::wstring host,
+    const Key_handle key, std::wstring subkey, std::wstring name)
+  {
+    Read_id id{Read_kind::value, std::move(host), key, std::move(subkey),
+      std::move(name), typeid(T)};
+    return read<std::optional<T>>(std::move(id), [this](const Read_id& id)
+    {
+      return registry::value<T>(backend_, id.key, c_str(id.subkey),
+        id.name.c_str());
+    });
+  }
+
+  /// @returns The future of registry::set_value().
+  template<typename T>
+  std::future<void> set_value(std::wstring host, const Key_handle key,
+    std::wstring name, T value)
+  {
+    return run<void>(std::move(host),
+      [this, key, name = std::move(name), value = std::move(value)]
+      {
+        registry::set_value(backend_, key, name.c_str(), value);
+      });
+  }
+
+  /**
+   * @returns The future of registry::snapshot() of `subkey` of `key`, or of
+   * `key` itself if `subkey` is empty.
+   *
+   * @throws `std::system_error` with `Status::file_not_found` via the future
+   * if no such a subkey.
+   */
+  std::shared_future<Key_snapshot> snapshot(std::wstring host,
+    const Key_handle key, std::wstring subkey = {})
+  {
+    Read_id id{Read_kind::snapshot, std::move(host), key, std::move(subkey),
+      {}, typeid(Key_snapshot)};
+    return read<Key_snapshot>(std::move(id), [this](const Read_id& id)
+    {
+      if (id.subkey.empty())
+        return registry::snapshot(backend_, id.key);
+
+      const auto sub = registry::open_key(backend_, id.key, id.subkey.c_str());
+      if (!sub)
+        throw_error(Status::file_not_found, "cannot open registry key");
+      return registry::snapshot(backend_, sub);
+    });
+  }
+
+private:
+  enum class Read_kind { value, snapshot };
+
+  struct Read_id final {
+    Read_kind kind{};
+    std::wstring host;
+    Key_handle key{};
+    std::wstring subkey;
+    std::wstring name;
+    std::type_index type{typeid(void)};
+
+    bool operator<(const Read_id& rhs) const noexcept
+    {
+      const auto cmp = [](const std::wstring& lhs, const std::wstring& rhs)
+      {
+        return compare_names(lhs, rhs);
+      };
+      return std::tuple{kind, cmp(host, rhs.host), key, cmp(subkey, rhs.subkey),
+        cmp(name, rhs.name), type} < std::tuple{rhs.kind, 0, rhs.key, 0, 0,
+        rhs.type};
+    }
+  };
+
+  struct Host final {
+    std::deque<std::function<void()>> tasks;
+    std::size_t running_count{};
+    bool is_queued{};
+  };
+
+  Backend& backend_;
+  std::size_t host_limit_{};
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool is_stopped_{};
+  std::map<std::wstring, Host, Name_less> hosts_;
+  std::deque<std::map<std::wstring, Host, Name_less>::iterator> queue_;
+  std::map<Read_id, std::any> reads_;
+  std::vector<std::thread> workers_;
+
+  static const wchar_t* c_str(const std::wstring& str) noexcept
+  {
+    return str.empty() ? nullptr : str.c_str();
+  }
+
+  /// @returns The future of `f()`.
+  template<typename R, typename F>
+  std::future<R> run(std::wstring host, F&& f)
+  {
+    auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+    auto result = task->get_future();
+    const std::lock_guard lock{mutex_};
+    submit(std::move(host), [task]{(*task)();});
+    return result;
+  }
+
+  /// @returns The future of `f(id)` shared with the identical reads in flight.
+  template<typename R, typename F>
+  std::shared_future<R> read(Read_id id, F&& f)
+  {
+    const std::lock_guard lock{mutex_};
+    if (const auto i = reads_.find(id); i != reads_.end())
+      return std::any_cast<std::shared_future<R>>(i->second);
+
+    auto promise = std::make_shared<std::promise<R>>();
+    std::shared_future<R> result = promise->get_future().share();
+    const auto i = reads_.emplace(std::move(id), result).first;
+    submit(i->first.host, [this, i, promise, f = std::forward<F>(f)]
+    {
+      try {
+        auto value = f(i->first);
+        forget(i);
+        promise->set_value(std::move(value));
+      } catch (...) {
+        forget(i);
+        promise->set_exception(std::current_exception());
+      }
+    });
+    return result;
+  }
+
+  /// Removes the read from the set of reads in flight.
+  void forget(const std::map<Read_id, std::any>::iterator i)
+  {
+    const std::lock_guard lock{mutex_};
+    reads_.erase(i);
+  }
+
+  /**
+   * @brief Enqueues the `task` of `host`.
+   *
+   * @par Requires
+   * `mutex_` must be locked.
+   */
+  void submit(std::wstring host, std::function<void()> task)
+  {
+    const auto h = hosts_.try_emplace(std::move(host)).first;
+    h->second.tasks.push_back(std::move(task));
+    schedule(h);
+  }
+
+  /**
+   * @brief Enqueues `h` if it has pending tasks and is below the limit.
+   *
+   * @par Requires
+   * `mutex_` must be locked.
+   */
+  void schedule(const std::map<std::wstring, Host, Name_less>::iterator h)
+  {
+    auto& host = h->second;
+    if (!host.is_queued && !host.tasks.empty() &&
+      host.running_count < host_limit_) {
+      host.is_queued = true;
+      queue_.push_back(h);
+      cond_.notify_one();
+    }
+  }
+
+  void work()
+  {
+    std::unique_lock lock{mutex_};
+    while (true) {
+      cond_.wait(lock, [this]{return is_stopped_ || !queue_.empty();});
+      if (is_stopped_)
+        return;
+
+      const auto h = queue_.front();
+      queue_.pop_front();
+      auto& host = h->second;
+      host.is_queued = false;
+      auto task = std::move(host.tasks.front());
+      host.tasks.pop_front();
+      ++host.running_count;
+      schedule(h);
+
+      lock.unlock();
+      task();
+      lock.lock();
+
+      --host.running_count;
+      if (!host.running_count && host.tasks.empty())
+        hosts_.erase(h);
+      else
+        schedule(h);
+    }
+  }
+};
+
+} // namespace dmitigr::winbase::registry
@@ -0,0 +1,505 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK.
+
+#pragma once
+
+#include "../base/noncopymove.hpp"
+#include "registry_snapshot.hpp"
+#include "registry_value.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::winbase::registry {
+
+/// A status of backend operation. (Mirrors Win32 error codes.)
+enum class Status : long {
+  success = 0,
+  file_not_found = 2,
+  access_denied = 5,
+  invalid_handle = 6,
+  invalid_parameter = 87,
+  more_data = 234,
+  no_more_items = 259,
+  key_deleted = 1018,
+  unsupported_type = 1630
+};
+
+/// A predefined key.
+enum class Root {
+  classes_root,
+  current_user,
+  local_machine,
+  users,
+  current_config
+};
+
+/// An access rights. (Mirrors `KEY_*` constants.)
+enum class Access : std::uint32_t {
+  read = 0x20019,
+  write = 0x20006,
+  read_write = 0x2001F,
+  all = 0xF003F
+};
+
+/// A key handle.
+using Key_handle = void*;
+
+/// An information about a key.
+struct Key_info final {
+  std::uint32_t subkey_count{};
+  std::uint32_t max_subkey_name_size{};
+  std::uint32_t value_count{};
+  std::uint32_t max_value_name_size{};
+  std::uint32_t max_value_data_size{};
+};
+
+/**
+ * @brief A registry backend.
+ *
+ * @details The operations mirror the corresponding Win32 functions including
+ * the returned error codes. Sizes of names are in characters, sizes of data
+ * are in bytes. A null `subkey` or `name` denotes the key itself or the
+ * default value respectively.
+ */
+class Backend {
+public:
+  /// The destructor.
+  virtual ~Backend() = default;
+
+  /// @returns The handle of the predefined key.
+  virtual Key_handle root(Root root) const noexcept = 0;
+
+  /// Mirrors `RegOpenKeyExW`.
+  virtual Status open_key(Key_handle key, const wchar_t* subkey, Access access,
+    Key_handle& result) = 0;
+
+  /// Mirrors `RegCreateKeyExW`.
+  virtual Status create_key(Key_handle key, const wchar_t* subkey, Access access,
+    Key_handle& result, bool& is_created) = 0;
+
+  /// Mirrors `RegCloseKey`.
+  virtual Status close_key(Key_handle key) noexcept = 0;
+
+  /// Mirrors `RegQueryInfoKeyW`.
+  virtual Status query_info(Key_handle key, Key_info& result) = 0;
+
+  /**
+   * @brief Mirrors `RegEnumKeyExW`.
+   *
+   * @param name_size On input - the capacity of `name` including the
+   * terminating null, on output - the length of the name.
+   */
+  virtual Status enum_key(Key_handle key, std::uint32_t index, wchar_t* name,
+    std::uint32_t& name_size) = 0;
+
+  /**
+   * @brief Mirrors `RegEnumValueW`.
+   *
+   * @param name_size On input - the capacity of `name` including the
+   * terminating null, on output - the length of the name.
+   * @param data_size On input - the capacity of `data`, on output - the size
+   * of the data.
+   */
+  virtual Status enum_value(Key_handle key, std::uint32_t index, wchar_t* name,
+    std::uint32_t& name_size, Value_type& type, std::byte* data,
+    std::uint32_t& data_size) = 0;
+
+  /**
+   * @brief Mirrors `RegGetValueW` with `RRF_RT_ANY | RRF_NOEXPAND`.
+   *
+   * @param data_size On input - the capacity of `data`, on output - the size
+   * of the data (or the required capacity if `Status::more_data` returned).
+   */
+  virtual Status get_value(Key_handle key, const wchar_t* subkey,
+    const wchar_t* name, Value_type& type, std::byte* data,
+    std::uint32_t& data_size) = 0;
+
+  /// Mirrors `RegSetValueExW`.
+  virtual Status set_value(Key_handle key, const wchar_t* name, Value_type type,
+    const std::byte* data, std::uint32_t data_size) = 0;
+
+  /// Mirrors `RegDeleteKeyValueW`.
+  virtual Status remove_value(Key_handle key, const wchar_t* subkey,
+    const wchar_t* name) = 0;
+
+  /// Mirrors `RegDeleteKeyW`.
+  virtual Status remove_key(Key_handle key, const wchar_t* subkey) = 0;
+};
+
+/// @returns `true` if `status` is Status::success.
+constexpr bool is_ok(const Status status) noexcept
+{
+  return status == Status::success;
+}
+
+// -----------------------------------------------------------------------------
+// Errors
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief The category of errors denoted by Status.
+ *
+ * @details Since the backends aren't necessarily backed by the Windows
+ * registry, the statuses have a category of their own rather than the system
+ * one, which is not the category of Win32 error codes on other platforms.
+ */
+class Error_category final : public std::error_category {
+public:
+  /// @returns The literal `dmitigr_winbase_registry_error`.
+  const char* name() const noexcept override
+  {
+    return "dmitigr_winbase_registry_error";
+  }
+
+  /// @returns The description of the status `ev`.
+  std::string message(const int ev) const override
+  {
+    switch (static_cast<Status>(ev)) {
+    case Status::success: return "success";
+    case Status::file_not_found: return "no such key or value";
+    case Status::access_denied: return "access denied";
+    case Status::invalid_handle: return "invalid key handle";
+    case Status::invalid_parameter: return "invalid parameter";
+    case Status::more_data: return "more data is available";
+    case Status::no_more_items: return "no more items";
+    case Status::key_deleted: return "key is marked for deletion";
+    case Status::unsupported_type: return "unsupported value type";
+    }
+    return "unknown registry error " + std::to_string(ev);
+  }
+
+  /// @returns The portable error condition of the status `ev`.
+  std::error_condition default_error_condition(
+    const int ev) const noexcept override
+  {
+    switch (static_cast<Status>(ev)) {
+    case Status::file_not_found: return std::errc::no_such_file_or_directory;
+    case Status::access_denied: return std::errc::permission_denied;
+    case Status::invalid_handle: return std::errc::bad_file_descriptor;
+    case Status::invalid_parameter: return std::errc::invalid_argument;
+    case Status::unsupported_type: return std::errc::not_supported;
+    default: return {ev, *this};
+    }
+  }
+};
+
+/// @returns The instance of Error_category.
+inline const Error_category& error_category() noexcept
+{
+  static const Error_category result;
+  return result;
+}
+
+/// @returns The error code of `status`.
+inline std::error_code make_error_code(const Status status) noexcept
+{
+  return {static_cast<int>(status), error_category()};
+}
+
+/// @throws `std::system_error` with the `status` code.
+[[noreturn]] inline void throw_error(const Status status, const char* const what)
+{
+  throw std::system_error{make_error_code(status), what};
+}
+
+// -----------------------------------------------------------------------------
+// Key_guard
+// -----------------------------------------------------------------------------
+
+/// A very thin wrapper around the Key_handle.
+class Key_guard final : private Noncopy {
+public:
+  /// The destructor.
+  ~Key_guard()
+  {
+    close();
+  }
+
+  /// The constructor.
+  Key_guard() noexcept = default;
+
+  /// The constructor.
+  Key_guard(Backend& backend, const Key_handle handle) noexcept
+    : backend_{&backend}
+    , handle_{handle}
+  {}
+
+  /// The move constructor.
+  Key_guard(Key_guard&& rhs) noexcept
+    : backend_{rhs.backend_}
+    , handle_{rhs.handle_}
+  {
+    rhs.handle_ = {};
+  }
+
+  /// The move assignment operator.
+  Key_guard& operator=(Key_guard&& rhs) noexcept
+  {
+    if (this != &rhs) {
+      Key_guard tmp{std::move(rhs)};
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  /// The swap operation.
+  void swap(Key_guard& other) noexcept
+  {
+    using std::swap;
+    swap(backend_, other.backend_);
+    swap(handle_, other.handle_);
+  }
+
+  /// @returns The guarded handle.
+  Key_handle handle() const noexcept
+  {
+    return handle_;
+  }
+
+  /// @returns The guarded handle.
+  operator Key_handle() const noexcept
+  {
+    return handle();
+  }
+
+  /// @returns `true` if the handle is not null.
+  explicit operator bool() const noexcept
+  {
+    return static_cast<bool>(handle_);
+  }
+
+  /// @returns The status of closing.
+  Status close() noexcept
+  {
+    Status result{Status::success};
+    if (handle_) {
+      if (is_ok(result = backend_->close_key(handle_)))
+        handle_ = {};
+    }
+    return result;
+  }
+
+private:
+  Backend* backend_{};
+  Key_handle handle_{};
+};
+
+// -----------------------------------------------------------------------------
+// Operations
+// -----------------------------------------------------------------------------
+
+/// @returns The opened key, or invalid instance if no such a key.
+inline Key_guard open_key(Backend& backend, const Key_handle key,
+  const wchar_t* const subkey, const Access access = Access::read)
+{
+  Key_handle result{};
+  const auto err = backend.open_key(key, subkey, access, result);
+  if (err == Status::file_not_found)
+    return Key_guard{};
+  else if (!is_ok(err))
+    throw_error(err, "cannot open registry key");
+  return Key_guard{backend, result};
+}
+
+/// @returns A pair with created/opened key and `true` if the key is created.
+inline std::pair<Key_guard, bool> create_key(Backend& backend,
+  const Key_handle key, const wchar_t* const subkey,
+  const Access access = Access::read_write)
+{
+  Key_handle result{};
+  bool is_created{};
+  const auto err = backend.create_key(key, subkey, access, result, is_created);
+  if (!is_ok(err))
+    throw_error(err, "cannot create registry key");
+  return std::make_pair(Key_guard{backend, result}, is_created);
+}
+
+/// Sets the value of the specified `type`.
+inline void set_value(Backend& backend, const Key_handle key,
+  const wchar_t* const name, const Value_type type,
+  const std::span<const std::byte> data)
+{
+  const auto err = backend.set_value(key, name, type, data.data(),
+    static_cast<std::uint32_t>(data.size()));
+  if (!is_ok(err))
+    throw_error(err, "cannot set value of registry key");
+}
+
+/**
+ * @brief Sets the value.
+ *
+ * @see registry::encode().
+ */
+template<typename T>
+void set_value(Backend& backend, const Key_handle key,
+  const wchar_t* const name, const T& value)
+{
+  std::vector<std::byte> data;
+  const auto type = encode(value, data);
+  set_value(backend, key, name, type, data);
+}
+
+/**
+ * @returns The value, or `std::nullopt` if no such a key or value.
+ *
+ * @details The value is read into an on-stack buffer first.
+ *
+ * @throws `std::system_error` with `Status::unsupported_type` if the value
+ * can't be converted to `T`.
+ *
+ * @see registry::to().
+ */
+template<typename T>
+std::optional<T> value(Backend& backend, const Key_handle key,
+  const wchar_t* const subkey, const wchar_t* const name)
+{
+  std::byte stack_buf[512];
+  std::vector<std::byte> heap_buf;
+  std::byte* buf{stack_buf};
+  Value_type type{};
+  std::uint32_t size{sizeof(stack_buf)};
+  auto err = backend.get_value(key, subkey, name, type, buf, size);
+  while (err == Status::more_data) {
+    heap_buf.resize(size);
+    buf = heap_buf.data();
+    err = backend.get_value(key, subkey, name, type, buf, size);
+  }
+  if (err == Status::file_not_found)
+    return std::nullopt;
+  else if (!is_ok(err))
+    throw_error(err, "cannot get value of registry key");
+  else if (!detail::is_convertible<T>(type))
+    throw_error(Status::unsupported_type, "cannot get value of registry key");
+  return to<T>(Value_view{{}, type, {buf, size}});
+}
+
+/// Removes the value. Does nothing if no such a key or value.
+inline void remove_value(Backend& backend, const Key_handle key,
+  const wchar_t* const subkey = {}, const wchar_t* const name = {})
+{
+  const auto err = backend.remove_value(key, subkey, name);
+  if (err != Status::file_not_found && !is_ok(err))
+    throw_error(err, "cannot remove value of registry key");
+}
+
+/// Removes the key which must not have subkeys.
+inline void remove_key(Backend& backend, const Key_handle key,
+  const wchar_t* const subkey)
+{
+  if (const auto err = backend.remove_key(key, subkey); !is_ok(err))
+    throw_error(err, "cannot remove registry key");
+}
+
+/// @returns The information about the key.
+inline Key_info info(Backend& backend, const Key_handle key)
+{
+  Key_info result;
+  if (const auto err = backend.query_info(key, result); !is_ok(err))
+    throw_error(err, "cannot query info of registry key");
+  return result;
+}
+
+/// @returns The names of subkeys of `key`.
+inline std::vector<std::wstring> subkey_names(Backend& backend,
+  const Key_handle key)
+{
+  const auto inf = info(backend, key);
+  std::vector<std::wstring> result;
+  result.reserve(inf.subkey_count);
+  std::wstring name(inf.max_subkey_name_size + 1, L'\0');
+  for (std::uint32_t i{};;) {
+    auto name_size = static_cast<std::uint32_t>(name.size());
+    const auto err = backend.enum_key(key, i, name.data(), name_size);
+    if (err == Status::no_more_items)
+      break;
+    else if (err == Status::more_data) {
+      name.resize(2*name.size());
+      continue;
+    } else if (!is_ok(err))
+      throw_error(err, "cannot enumerate subkeys of registry key");
+    result.emplace_back(name.data(), name_size);
+    ++i;
+  }
+  return result;
+}
+
+/**
+ * @brief Removes the key with all its subkeys. Does nothing if no such a key.
+ *
+ * @par Requires
+ * `subkey` must not be empty.
+ */
+inline void remove_tree(Backend& backend, const Key_handle key,
+  const wchar_t* const subkey)
+{
+  {
+    const auto sub = open_key(backend, key, subkey, Access::all);
+    if (!sub)
+      return;
+    for (const auto& name : subkey_names(backend, sub))
+      remove_tree(backend, sub, name.c_str());
+  }
+  const auto err = backend.remove_key(key, subkey);
+  if (err != Status::file_not_found && !is_ok(err))
+    throw_error(err, "cannot remove registry key");
+}
+
+/**
+ * @returns The snapshot of all the values of `key`.
+ *
+ * @details The whole snapshot is retaken if the key is modified concurrently.
+ */
+inline Key_snapshot snapshot(Backend& backend, const Key_handle key)
+{
+  while (true) {
+    auto inf = info(backend, key);
+    const auto max_name_size = inf.max_value_name_size + 1;
+    Key_snapshot::Builder builder{inf.value_count, max_name_size,
+      inf.max_value_data_size};
+    Status err{Status::success};
+    for (std::uint32_t i{}; is_ok(err); ++i) {
+      const auto slot = builder.prepare(max_name_size, inf.max_value_data_size);
+      auto name_size = max_name_size;
+      Value_type type{};
+      auto data_size = inf.max_value_data_size;
+      err = backend.enum_value(key, i, slot.name, name_size, type, slot.data,
+        data_size);
+      if (is_ok(err))
+        builder.commit(name_size, type, data_size);
+    }
+    if (err == Status::no_more_items)
+      return std::move(builder).finish();
+    else if (err != Status::more_data)
+      throw_error(err, "cannot enumerate values of registry key");
+  }
+}
+
+} // namespace dmitigr::winbase::registry
+
+/// Makes Status implicitly convertible to `std::error_code`.
+template<>
+struct std::is_error_code_enum<dmitigr::winbase::registry::Status>
+  : std::true_type {};
@@ -0,0 +1,201 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK.
+
+#pragma once
+
+#include "registry_backend.hpp"
+#include "registry_value.hpp"
+
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dmitigr::winbase::registry {
+
+/**
+ * @brief A batch of registry modifications.
+ *
+ * @details Modifications are collected in memory and coalesced: the last
+ * modification of a value wins, and removal of a key discards all the pending
+ * modifications of its subtree. The batch is applied in one pass: removals of
+ * keys first, then creations of keys and modifications of values in the order
+ * of paths (so parents precede children), by using the single handle per key.
+ *
+ * Paths are relative to the key passed to apply() and are compared
+ * case-insensitively.
+ */
+class Batch final {
+public:
+  /// Schedules the creation of the key.
+  Batch& create_key(const std::wstring_view path)
+  {
+    ops(path).is_created = true;
+    return *this;
+  }
+
+  /// Schedules the removal of the key with all its subkeys.
+  Batch& remove_key(const std::wstring_view path)
+  {
+    auto p = normalized(path);
+    if (p.empty())
+      throw std::invalid_argument{"cannot remove root key by registry batch"};
+
+    std::erase_if(keys_, [&p](const auto& e)
+    {
+      return is_subpath(e.first, p);
+    });
+    keys_[std::move(p)].is_removed = true;
+    return *this;
+  }
+
+  /// Schedules the setting of the value.
+  Batch& set_value(const std::wstring_view path, const std::wstring_view name,
+    const Value_type type, const std::span<const std::byte> data)
+  {
+    auto& o = ops(path);
+    o.is_created = true;
+    o.values.insert_or_assign(std::wstring{name},
+      Value{type, {data.begin(), data.end()}});
+    return *this;
+  }
+
+  /**
+   * @brief Schedules the setting of the value.
+   *
+   * @see registry::encode().
+   */
+  template<typename T>
+  Batch& set_value(const std::wstring_view path, const std::wstring_view name,
+    const T& value)
+  {
+    Value v;
+    v.type = encode(value, v.data);
+    auto& o = ops(path);
+    o.is_created = true;
+    o.values.insert_or_assign(std::wstring{name}, std::move(v));
+    return *this;
+  }
+
+  /// Schedules the removal of the value.
+  Batch& remove_value(const std::wstring_view path, const std::wstring_view name)
+  {
+    ops(path).values.insert_or_assign(std::wstring{name}, std::nullopt);
+    return *this;
+  }
+
+  /// @returns The number of coalesced operations.
+  std::size_t size() const noexcept
+  {
+    std::size_t result{};
+    for (const auto& [path, o] : keys_)
+      result += o.is_removed + o.is_created + o.values.size();
+    return result;
+  }
+
+  /// @returns `size() == 0`.
+  bool is_empty() const noexcept
+  {
+    return keys_.empty();
+  }
+
+  /// Clears the batch.
+  void clear() noexcept
+  {
+    keys_.clear();
+  }
+
+  /**
+   * @brief Applies the batch to `root`.
+   *
+   * @remarks The application is atomic only if `backend` is transactional.
+   */
+  void apply(Backend& backend, const Key_handle root) const
+  {
+    for (const auto& [path, o] : keys_) {
+      if (o.is_removed)
+        remove_tree(backend, root, path.c_str());
+    }
+
+    for (const auto& [path, o] : keys_) {
+      if (!o.is_created && o.values.empty())
+        continue;
+
+      const auto key = o.is_created ?
+        registry::create_key(backend, root, path.c_str()).first :
+        open_key(backend, root, path.c_str(), Access::read_write);
+      if (!key)
+        continue;
+
+      for (const auto& [name, value] : o.values) {
+        if (value)
+          registry::set_value(backend, key, name.c_str(), value->type, value->data);
+        else
+          registry::remove_value(backend, key, nullptr, name.c_str());
+      }
+    }
+  }
+
+private:
+  struct Value final {
+    Value_type type{};
+    std::vector<std::byte> data;
+  };
+
+  struct Key_ops final {
+    bool is_removed{};
+    bool is_created{};
+    std::map<std::wstring, std::optional<Value>, Name_less> values;
+  };
+
+  std::map<std::wstring, Key_ops, Name_less> keys_;
+
+  Key_ops& ops(const std::wstring_view path)
+  {
+    return keys_[normalized(path)];
+  }
+
+  /// @returns The path without empty components.
+  static std::wstring normalized(const std::wstring_view path)
+  {
+    std::wstring result;
+    result.reserve(path.size());
+    for (const auto ch : path) {
+      if (ch != L'\\' || (!result.empty() && result.back() != L'\\'))
+        result.push_back(ch);
+    }
+    if (!result.empty() && result.back() == L'\\')
+      result.pop_back();
+    return result;
+  }
+
+  /// @returns `true` if `path` is `parent` or its descendant.
+  static bool is_subpath(const std::wstring_view path,
+    const std::wstring_view parent) noexcept
+  {
+    return path.size() >= parent.size() &&
+      !compare_names(path.substr(0, parent.size()), parent) &&
+      (path.size() == parent.size() || path[parent.size()] == L'\\');
+  }
+};
+
+} // namespace dmitigr::winbase::registry
@@ -0,0 +1,521 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK (except for file mapping).
+
+#pragma once
+
+#include "../base/noncopymove.hpp"
+#include "registry_image.hpp"
+#include "registry_value.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dmitigr::winbase::registry {
+
+/*
+ * The regf hive layout (all the fields are little-endian):
+ *
+ *   - base block (4096 bytes) with the offset of the root key cell;
+ *   - hive bins ("hbin", multiples of 4096 bytes) split into cells.
+ *
+ * Each cell starts with the 32-bit size which is negative for allocated cells.
+ * Cell offsets are relative to the start of the first hive bin. The cells of
+ * interest are:
+ *
+ *   - "nk": key node;
+ *   - "vk": value key (the data is either inline, in a cell or in a "db" cell);
+ *   - "lf", "lh", "li": leaf subkey lists, "ri": list of leaf subkey lists;
+ *   - "db": big data (the list of data segments);
+ *   - value list (the array of offsets to "vk" cells).
+ */
+
+namespace detail {
+
+inline constexpr std::size_t hive_base_block_size{4096};
+inline constexpr std::size_t hive_big_data_segment_size{16344};
+
+/// @returns The hash of key `name` as stored in "lh" subkey lists.
+constexpr std::uint32_t hive_name_hash(const std::wstring_view name) noexcept
+{
+  std::uint32_t result{};
+  for (const auto ch : name)
+    result = 37*result + static_cast<std::uint32_t>(upcase(ch));
+  return result;
+}
+
+} // namespace detail
+
+/**
+ * @brief A read-only regf hive.
+ *
+ * @details The hive is either memory-mapped from file or viewed in memory.
+ * Cells are accessed in place and their bounds are checked lazily. The index
+ * of subkeys of each key is built by the first lookup of its subkey and is
+ * shared by all the lookups made afterwards.
+ *
+ * @remarks Transaction logs are not applied: the hive is read as is.
+ */
+class Hive final : private Noncopy {
+public:
+  /// A value of the hive.
+  class Value final {
+  public:
+    /// @returns The name.
+    std::wstring name() const
+    {
+      return hive_->name(cell_, 20, u16(cell_, 2), u16(cell_, 16) & 0x0001);
+    }
+
+    /// @returns The type.
+    Value_type type() const
+    {
+      return static_cast<Value_type>(u32(cell_, 12));
+    }
+
+    /// @returns The size of data.
+    std::uint32_t size() const
+    {
+      return u32(cell_, 4) & 0x7fffffff;
+    }
+
+    /**
+     * @returns The data. If the data is split into segments (big data), it's
+     * assembled in `buffer`, otherwise it's viewed in place.
+     */
+    std::span<const std::byte> data(std::vector<std::byte>& buffer) const
+    {
+      const auto sz = size();
+      if (u32(cell_, 4) & 0x80000000) {
+        if (sz > 4)
+          throw_corrupted();
+        return cell_.subspan(8, sz);
+      } else if (!sz)
+        return {};
+
+      const auto data = hive_->cell(u32(cell_, 8));
+      if (sz > detail::hive_big_data_segment_size && hive_->minor_version_ > 3
+        && is_signature(data, "db")) {
+        const auto count = u16(data, 2);
+        const auto segments = hive_->cell(u32(data, 4));
+        if (sz > hive_->bins_.size())
+          throw_corrupted();
+        buffer.clear();
+        buffer.reserve(sz);
+        for (std::uint16_t i{}; i < count && buffer.size() < sz; ++i) {
+          const auto segment = hive_->cell(u32(segments, 4*i));
+          const auto n = std::min({segment.size(),
+            detail::hive_big_data_segment_size, sz - buffer.size()});
+          buffer.insert(buffer.end(), segment.begin(), segment.begin() + n);
+        }
+        if (buffer.size() != sz)
+          throw_corrupted();
+        return buffer;
+      } else if (sz > data.size())
+        throw_corrupted();
+      return data.first(sz);
+    }
+
+  private:
+    friend Hive;
+
+    const Hive* hive_{};
+    std::span<const std::byte> cell_;
+
+    Value(const Hive& hive, const std::span<const std::byte> cell)
+      : hive_{&hive}
+      , cell_{cell}
+    {
+      if (!is_signature(cell_, "vk") || cell_.size() < 20)
+        throw_corrupted();
+    }
+  };
+
+  /// A key of the hive.
+  class Key final {
+  public:
+    /// @returns The name.
+    std::wstring name() const
+    {
+      return hive_->name(cell_, 76, u16(cell_, 72), u16(cell_, 2) & 0x0020);
+    }
+
+    /// @returns The number of subkeys.
+    std::uint32_t subkey_count() const
+    {
+      return u32(cell_, 20);
+    }
+
+    /// @returns The subkeys.
+    std::vector<Key> subkeys() const
+    {
+      std::vector<Key> result;
+      result.reserve(hive_->reservable_subkey_count(*this));
+      hive_->for_each_subkey(*this, [this, &result](const std::uint32_t offset)
+      {
+        result.push_back(hive_->key(offset));
+      });
+      return result;
+    }
+
+    /// @returns The subkey of the specified `name` if any.
+    std::optional<Key> subkey(const std::wstring_view name) const
+    {
+      if (!subkey_count())
+        return std::nullopt;
+
+      const auto& index = hive_->index(*this);
+      const auto hash = detail::hive_name_hash(name);
+      auto i = std::lower_bound(index.begin(), index.end(), hash,
+        [](const Index_entry& e, const std::uint32_t h)
+        {
+          return e.hash < h;
+        });
+      for (; i != index.end() && i->hash == hash; ++i) {
+        const auto k = hive_->key(i->offset);
+        if (k.is_name_equal(name))
+          return k;
+      }
+      return std::nullopt;
+    }
+
+    /// @returns The number of values.
+    std::size_t size() const
+    {
+      return u32(cell_, 36);
+    }
+
+    /// @returns The value at the specified `index`.
+    Value operator[](const std::size_t index) const
+    {
+      if (!(index < size()))
+        throw std::out_of_range{"registry hive value index out of range"};
+      const auto list = hive_->cell(u32(cell_, 40));
+      return Value{*hive_, hive_->cell(u32(list, 4*index))};
+    }
+
+    /// @returns The value of the specified `name` if any.
+    std::optional<Value> find(const std::wstring_view name) const
+    {
+      const auto count = size();
+      if (!count)
+        return std::nullopt;
+
+      const auto list = hive_->cell(u32(cell_, 40));
+      for (std::size_t i{}; i < count; ++i) {
+        const Value v{*hive_, hive_->cell(u32(list, 4*i))};
+        if (hive_->is_name_equal(v.cell_, 20, u16(v.cell_, 2),
+            u16(v.cell_, 16) & 0x0001, name))
+          return v;
+      }
+      return std::nullopt;
+    }
+
+    /**
+     * @returns The value of the specified `name` converted to `T`, or
+     * `std::nullopt` if no such a value.
+     *
+     * @see registry::to().
+     */
+    template<typename T>
+    std::optional<T> value(const std::wstring_view name) const
+    {
+      if (const auto v = find(name)) {
+        std::vector<std::byte> buffer;
+        return to<T>(Value_view{name, v->type(), v->data(buffer)});
+      }
+      return std::nullopt;
+    }
+
+  private:
+    friend Hive;
+
+    const Hive* hive_{};
+    std::uint32_t offset_{};
+    std::span<const std::byte> cell_;
+
+    Key(const Hive& hive, const std::uint32_t offset,
+      const std::span<const std::byte> cell)
+      : hive_{&hive}
+      , offset_{offset}
+      , cell_{cell}
+    {
+      if (!is_signature(cell_, "nk") || cell_.size() < 76)
+        throw_corrupted();
+    }
+
+    bool is_name_equal(const std::wstring_view name) const
+    {
+      return hive_->is_name_equal(cell_, 76, u16(cell_, 72),
+        u16(cell_, 2) & 0x0020, name);
+    }
+  };
+
+  /// Constructs an empty hive.
+  Hive() = default;
+
+  /// Maps the hive file at `path`.
+  explicit Hive(const std::filesystem::path& path)
+    : mapping_{path}
+  {
+    init(mapping_.bytes());
+  }
+
+  /**
+   * @brief Views the hive in memory.
+   *
+   * @par Lifetime
+   * The `bytes` must outlive the instance.
+   */
+  explicit Hive(const std::span<const std::byte> bytes)
+  {
+    init(bytes);
+  }
+
+  /// @returns The minor version of the format.
+  std::uint32_t minor_version() const noexcept
+  {
+    return minor_version_;
+  }
+
+  /// @returns `true` if the hive was not written completely.
+  bool is_dirty() const noexcept
+  {
+    return is_dirty_;
+  }
+
+  /// @returns The root key.
+  Key root() const
+  {
+    return key(root_offset_);
+  }
+
+  /// @returns The key of the specified `path` relative to the root if any.
+  std::optional<Key> find(std::wstring_view path) const
+  {
+    std::optional<Key> result{root()};
+    while (result && !path.empty()) {
+      const auto pos = path.find(L'\\');
+      const auto name = path.substr(0, pos);
+      path.remove_prefix(pos == std::wstring_view::npos ? path.size() : pos + 1);
+      if (!name.empty())
+        result = result->subkey(name);
+    }
+    return result;
+  }
+
+  /**
+   * @returns The value of the specified `name` of the key at `path` converted
+   * to `T`, or `std::nullopt` if no such a key or value.
+   */
+  template<typename T>
+  std::optional<T> value(const std::wstring_view path,
+    const std::wstring_view name) const
+  {
+    if (const auto k = find(path))
+      return k->template value<T>(name);
+    return std::nullopt;
+  }
+
+private:
+  struct Index_entry final {
+    std::uint32_t hash{};
+    std::uint32_t offset{};
+  };
+
+  detail::File_mapping mapping_;
+  std::span<const std::byte> bins_;
+  std::uint32_t root_offset_{};
+  std::uint32_t minor_version_{};
+  bool is_dirty_{};
+  mutable std::shared_mutex index_mutex_;
+  mutable std::unordered_map<std::uint32_t, std::vector<Index_entry>> indexes_;
+
+  [[noreturn]] static void throw_corrupted()
+  {
+    throw std::runtime_error{"cannot use registry hive: hive is corrupted"};
+  }
+
+  static std::uint16_t u16(const std::span<const std::byte> bytes,
+    const std::size_t offset)
+  {
+    if (offset > bytes.size() || bytes.size() - offset < 2)
+      throw_corrupted();
+    return static_cast<std::uint16_t>(std::to_integer<unsigned>(bytes[offset]) |
+      std::to_integer<unsigned>(bytes[offset + 1]) << 8);
+  }
+
+  static std::uint32_t u32(const std::span<const std::byte> bytes,
+    const std::size_t offset)
+  {
+    return u16(bytes, offset) | static_cast<std::uint32_t>(u16(bytes, offset + 2)) << 16;
+  }
+
+  static bool is_signature(const std::span<const std::byte> bytes,
+    const char (&signature)[3]) noexcept
+  {
+    return bytes.size() >= 2 && !std::memcmp(bytes.data(), signature, 2);
+  }
+
+  void init(const std::span<const std::byte> bytes)
+  {
+    if (bytes.size() < detail::hive_base_block_size)
+      throw_corrupted();
+    else if (std::memcmp(bytes.data(), "regf", 4))
+      throw std::runtime_error{"cannot use registry hive: invalid signature"};
+    else if (u32(bytes, 20) != 1 || u32(bytes, 28) != 0 || u32(bytes, 32) != 1)
+      throw std::runtime_error{"cannot use registry hive: unsupported format"};
+
+    is_dirty_ = u32(bytes, 4) != u32(bytes, 8);
+    minor_version_ = u32(bytes, 24);
+    root_offset_ = u32(bytes, 36);
+    const std::size_t bins_size = u32(bytes, 40);
+    if (bins_size > bytes.size() - detail::hive_base_block_size)
+      throw_corrupted();
+    bins_ = bytes.subspan(detail::hive_base_block_size, bins_size);
+    if (bins_.size() < 32 || std::memcmp(bins_.data(), "hbin", 4))
+      throw_corrupted();
+  }
+
+  /// @returns The data of the allocated cell at `offset`.
+  std::span<const std::byte> cell(const std::uint32_t offset) const
+  {
+    const auto size = static_cast<std::int32_t>(u32(bins_, offset));
+    if (size >= 0)
+      throw_corrupted();
+    const auto sz = static_cast<std::size_t>(-static_cast<std::int64_t>(size));
+    if (sz < 4 || sz > bins_.size() - offset)
+      throw_corrupted();
+    return bins_.subspan(offset + 4, sz - 4);
+  }
+
+  /**
+   * @returns The number of subkeys of `key` limited by the number of "nk"
+   * cells the hive can hold, since the former is read from the hive as is.
+   */
+  std::size_t reservable_subkey_count(const Key& key) const
+  {
+    constexpr std::size_t min_key_cell_size{4 + 76};
+    return std::min<std::size_t>(key.subkey_count(),
+      bins_.size() / min_key_cell_size);
+  }
+
+  Key key(const std::uint32_t offset) const
+  {
+    return Key{*this, offset, cell(offset)};
+  }
+
+  /// @returns The name of `size` bytes at `offset` of `cell`.
+  std::wstring name(const std::span<const std::byte> cell,
+    const std::size_t offset, const std::size_t size, const bool is_ascii) const
+  {
+    if (offset > cell.size() || size > cell.size() - offset || (!is_ascii && size % 2))
+      throw_corrupted();
+    std::wstring result(is_ascii ? size : size/2, L'\0');
+    for (std::size_t i{}; i < result.size(); ++i)
+      result[i] = is_ascii ? static_cast<wchar_t>(std::to_integer<unsigned>(
+          cell[offset + i])) : static_cast<wchar_t>(u16(cell, offset + 2*i));
+    return result;
+  }
+
+  /**
+   * @returns `true` if the name of `size` bytes at `offset` of `cell` equals
+   * to `name` case-insensitively.
+   */
+  bool is_name_equal(const std::span<const std::byte> cell,
+    const std::size_t offset, const std::size_t size, const bool is_ascii,
+    const std::wstring_view name) const
+  {
+    if (offset > cell.size() || size > cell.size() - offset || (!is_ascii && size % 2))
+      throw_corrupted();
+    else if ((is_ascii ? size : size/2) != name.size())
+      return false;
+    for (std::size_t i{}; i < name.size(); ++i) {
+      const auto ch = is_ascii ? static_cast<wchar_t>(std::to_integer<unsigned>(
+          cell[offset + i])) : static_cast<wchar_t>(u16(cell, offset + 2*i));
+      if (upcase(ch) != upcase(name[i]))
+        return false;
+    }
+    return true;
+  }
+
+  /// Calls `callback` with the offset of each subkey of `key`.
+  template<typename F>
+  void for_each_subkey(const Key& key, F&& callback) const
+  {
+    if (key.subkey_count())
+      for_each_list_entry(u32(key.cell_, 28), callback, true);
+  }
+
+  template<typename F>
+  void for_each_list_entry(const std::uint32_t offset, F& callback,
+    const bool is_index_root_allowed) const
+  {
+    const auto list = cell(offset);
+    const auto count = u16(list, 2);
+    if (is_signature(list, "lf") || is_signature(list, "lh")) {
+      for (std::size_t i{}; i < count; ++i)
+        callback(u32(list, 4 + 8*i));
+    } else if (is_signature(list, "li")) {
+      for (std::size_t i{}; i < count; ++i)
+        callback(u32(list, 4 + 4*i));
+    } else if (is_signature(list, "ri") && is_index_root_allowed) {
+      for (std::size_t i{}; i < count; ++i)
+        for_each_list_entry(u32(list, 4 + 4*i), callback, false);
+    } else
+      throw_corrupted();
+  }
+
+  /// @returns The index of subkeys of `parent` sorted by name hashes.
+  const std::vector<Index_entry>& index(const Key& parent) const
+  {
+    {
+      const std::shared_lock lock{index_mutex_};
+      if (const auto i = indexes_.find(parent.offset_); i != indexes_.end())
+        return i->second;
+    }
+
+    std::vector<Index_entry> result;
+    result.reserve(reservable_subkey_count(parent));
+    for_each_subkey(parent, [this, &result](const std::uint32_t offset)
+    {
+      result.push_back({detail::hive_name_hash(key(offset).name()), offset});
+    });
+    std::sort(result.begin(), result.end(),
+      [](const Index_entry& lhs, const Index_entry& rhs)
+      {
+        return lhs.hash < rhs.hash;
+      });
+
+    const std::unique_lock lock{index_mutex_};
+    return indexes_.try_emplace(parent.offset_, std::move(result)).first->second;
+  }
+};
+
+} // namespace dmitigr::winbase::registry
@@ -0,0 +1,637 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK (except for file mapping).
+
+#pragma once
+
+#include "../base/noncopymove.hpp"
+#include "registry_snapshot.hpp"
+#include "registry_value.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include "windows.hpp"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dmitigr::winbase::registry {
+
+/*
+ * The image layout (all the fields are in the host byte order, all the
+ * sections are aligned to 8 bytes):
+ *
+ *   - header (Image_header);
+ *   - key table (Image_key[key_count]) sorted by paths case-insensitively;
+ *   - value table (Image_value[value_count]) grouped by keys and sorted by
+ *     names case-insensitively within each group;
+ *   - string pool (wchar_t[]) of paths and names;
+ *   - data pool of raw value data.
+ */
+
+namespace detail {
+
+/// The header of the image.
+struct Image_header final {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint32_t char_size;
+  std::uint32_t key_count;
+  std::uint32_t value_count;
+  std::uint32_t reserved;
+  std::uint64_t keys_offset;
+  std::uint64_t values_offset;
+  std::uint64_t strings_offset;
+  std::uint64_t strings_size;
+  std::uint64_t data_offset;
+  std::uint64_t data_size;
+};
+static_assert(sizeof(Image_header) == 80);
+
+/// The key record of the image.
+struct Image_key final {
+  std::uint32_t path_offset; // in characters
+  std::uint32_t path_size; // in characters
+  std::uint32_t first_value;
+  std::uint32_t value_count;
+};
+static_assert(sizeof(Image_key) == 16);
+
+/// The value record of the image.
+struct Image_value final {
+  std::uint32_t name_offset; // in characters
+  std::uint32_t name_size; // in characters
+  std::uint32_t type;
+  std::uint32_t data_size;
+  std::uint64_t data_offset;
+};
+static_assert(sizeof(Image_value) == 24);
+
+inline constexpr char image_magic[8]{'D', 'M', 'R', 'E', 'G', 'I', 'M', 'G'};
+inline constexpr std::uint32_t image_version{1};
+inline constexpr std::uint32_t image_byte_order{0x01020304};
+
+constexpr std::uint64_t align8(const std::uint64_t offset) noexcept
+{
+  return (offset + 7) / 8 * 8;
+}
+
+/// A read-only mapping of the whole file into memory.
+class File_mapping final : private Noncopy {
+public:
+  ~File_mapping()
+  {
+    close();
+  }
+
+  File_mapping() = default;
+
+  explicit File_mapping(const std::filesystem::path& path)
+  {
+    const auto throw_error = [](const char* const what)
+    {
+      throw std::system_error{system_error_code(), std::system_category(),
+        std::string{"cannot map registry image: "}.append(what)};
+    };
+#ifdef _WIN32
+    const HANDLE file{CreateFileW(path.c_str(), GENERIC_READ,
+      FILE_SHARE_READ | FILE_SHARE_DELETE,
+      NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL)};
+    if (file == INVALID_HANDLE_VALUE)
+      throw_error("cannot open file");
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size)) {
+      const auto err = system_error_code();
+      CloseHandle(file);
+      SetLastError(err);
+      throw_error("cannot get file size");
+    }
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    if (size_) {
+      const HANDLE mapping{CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL)};
+      CloseHandle(file);
+      if (!mapping)
+        throw_error("cannot create file mapping");
+      data_ = static_cast<const std::byte*>(MapViewOfFile(mapping,
+        FILE_MAP_READ, 0, 0, 0));
+      CloseHandle(mapping);
+      if (!data_)
+        throw_error("cannot map view of file");
+    } else
+      CloseHandle(file);
+#else
+    const int fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fd < 0)
+      throw_error("cannot open file");
+    struct stat st{};
+    if (::fstat(fd, &st)) {
+      const auto err = errno;
+      ::close(fd);
+      errno = err;
+      throw_error("cannot get file size");
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_) {
+      void* const data{::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0)};
+      ::close(fd);
+      if (data == MAP_FAILED)
+        throw_error("cannot map file");
+      data_ = static_cast<const std::byte*>(data);
+    } else
+      ::close(fd);
+#endif
+  }
+
+  File_mapping(File_mapping&& rhs) noexcept
+    : data_{std::exchange(rhs.data_, nullptr)}
+    , size_{std::exchange(rhs.size_, 0)}
+  {}
+
+  File_mapping& operator=(File_mapping&& rhs) noexcept
+  {
+    if (this != &rhs) {
+      File_mapping tmp{std::move(rhs)};
+      std::swap(data_, tmp.data_);
+      std::swap(size_, tmp.size_);
+    }
+    return *this;
+  }
+
+  std::span<const std::byte> bytes() const noexcept
+  {
+    return {data_, size_};
+  }
+
+private:
+  const std::byte* data_{};
+  std::size_t size_{};
+
+  static int system_error_code() noexcept
+  {
+#ifdef _WIN32
+    return static_cast<int>(GetLastError());
+#else
+    return errno;
+#endif
+  }
+
+  void close() noexcept
+  {
+    if (data_) {
+#ifdef _WIN32
+      UnmapViewOfFile(data_);
+#else
+      ::munmap(const_cast<std::byte*>(data_), size_);
+#endif
+      data_ = nullptr;
+      size_ = 0;
+    }
+  }
+};
+
+/**
+ * @brief Replaces the file at `path` with the file at `new_path`.
+ *
+ * @details On Windows, the rename with POSIX semantics (Windows 10 1709+) is
+ * tried first, since it replaces the file even while it's mapped by Image.
+ * Otherwise `MoveFileExW()` is used, which fails while the file is mapped.
+ *
+ * @throws `std::system_error` on failure.
+ */
+inline void replace_file(const std::filesystem::path& new_path,
+  const std::filesystem::path& path)
+{
+#ifdef _WIN32
+#ifdef FILE_RENAME_FLAG_POSIX_SEMANTICS
+  const HANDLE file{CreateFileW(new_path.c_str(), DELETE | SYNCHRONIZE,
+    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+    NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL)};
+  if (file != INVALID_HANDLE_VALUE) {
+    const std::wstring& name{path.native()};
+    const auto name_size = name.size()*sizeof(wchar_t);
+    std::vector<std::uint64_t> buf((sizeof(FILE_RENAME_INFO) + name_size +
+        sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+    auto* const info = reinterpret_cast<FILE_RENAME_INFO*>(buf.data());
+    info->Flags = FILE_RENAME_FLAG_REPLACE_IF_EXISTS |
+      FILE_RENAME_FLAG_POSIX_SEMANTICS;
+    info->FileNameLength = static_cast<DWORD>(name_size);
+    std::memcpy(info->FileName, name.data(), name_size);
+    const BOOL is_renamed{SetFileInformationByHandle(file, FileRenameInfoEx,
+      info, static_cast<DWORD>(buf.size()*sizeof(std::uint64_t)))};
+    CloseHandle(file);
+    if (is_renamed)
+      return;
+  }
+#endif
+  if (!MoveFileExW(new_path.c_str(), path.c_str(),
+      MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    throw std::system_error{static_cast<int>(GetLastError()),
+      std::system_category(), "cannot replace registry image"};
+#else
+  std::filesystem::rename(new_path, path);
+#endif
+}
+
+} // namespace detail
+
+/**
+ * @brief A writer of a registry image: the compact binary snapshot of the
+ * subtree of registry keys.
+ *
+ * @see Image.
+ */
+class Image_writer final {
+public:
+  /**
+   * @brief Adds the key with the values.
+   *
+   * @param path The path of the key relative to the subtree root (an empty
+   * path denotes the root itself).
+   */
+  void add_key(const std::wstring_view path, const Key_snapshot& values)
+  {
+    keys_.push_back(detail::Image_key{add_string(path),
+      static_cast<std::uint32_t>(path.size()),
+      static_cast<std::uint32_t>(values_.size()),
+      static_cast<std::uint32_t>(values.size())});
+    for (const auto& value : values) {
+      const auto data_offset = data_.size();
+      data_.insert(data_.end(), value.data.begin(), value.data.end());
+      values_.push_back(detail::Image_value{add_string(value.name),
+        static_cast<std::uint32_t>(value.name.size()),
+        static_cast<std::uint32_t>(value.type),
+        static_cast<std::uint32_t>(value.data.size()),
+        static_cast<std::uint64_t>(data_offset)});
+    }
+  }
+
+  /// @returns The image bytes.
+  std::vector<std::byte> to_bytes() const
+  {
+    std::vector<std::byte> result;
+    write([&result](const void* const data, const std::size_t size)
+    {
+      const auto* const bytes = static_cast<const std::byte*>(data);
+      result.insert(result.end(), bytes, bytes + size);
+    });
+    return result;
+  }
+
+  /**
+   * @brief Writes the image to the file at `path`.
+   *
+   * @details The image is written to the temporary file which then replaces
+   * the file at `path`, so readers never see a partially written image. The
+   * file is never modified in place, so the instances of Image which mapped
+   * the previous file keep seeing the previous image until they're reopened.
+   *
+   * @remarks On Windows prior to 10 1709, the file can't be replaced while
+   * it's mapped by any Image. In that case the temporary file is removed and
+   * `std::system_error` is thrown.
+   */
+  void write(const std::filesystem::path& path) const
+  {
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    {
+      std::ofstream out{tmp_path, std::ios::binary | std::ios::trunc};
+      if (!out)
+        throw std::runtime_error{"cannot open file to write registry image"};
+      write([&out](const void* const data, const std::size_t size)
+      {
+        out.write(static_cast<const char*>(data),
+          static_cast<std::streamsize>(size));
+      });
+      out.close();
+      if (!out)
+        throw std::runtime_error{"cannot write registry image"};
+    }
+    try {
+      detail::replace_file(tmp_path, path);
+    } catch (...) {
+      std::error_code err;
+      std::filesystem::remove(tmp_path, err);
+      throw;
+    }
+  }
+
+private:
+  std::vector<detail::Image_key> keys_;
+  std::vector<detail::Image_value> values_;
+  std::wstring strings_;
+  std::vector<std::byte> data_;
+
+  std::uint32_t add_string(const std::wstring_view str)
+  {
+    const auto result = strings_.size();
+    strings_.append(str);
+    return static_cast<std::uint32_t>(result);
+  }
+
+  template<typename F>
+  void write(F&& sink) const
+  {
+    const auto path = [this](const detail::Image_key& k)
+    {
+      return std::wstring_view{strings_.data() + k.path_offset, k.path_size};
+    };
+    auto keys = keys_;
+    std::sort(keys.begin(), keys.end(),
+      [&path](const auto& lhs, const auto& rhs)
+      {
+        return compare_names(path(lhs), path(rhs)) < 0;
+      });
+    for (auto i = keys.begin(); i != keys.end(); ++i) {
+      if (i != keys.begin() && !compare_names(path(*(i - 1)), path(*i)))
+        throw std::logic_error{"cannot write registry image: duplicate key"};
+    }
+
+    using detail::align8;
+    detail::Image_header h{};
+    std::memcpy(h.magic, detail::image_magic, sizeof(h.magic));
+    h.version = detail::image_version;
+    h.byte_order = detail::image_byte_order;
+    h.char_size = sizeof(wchar_t);
+    h.key_count = static_cast<std::uint32_t>(keys.size());
+    h.value_count = static_cast<std::uint32_t>(values_.size());
+    h.keys_offset = align8(sizeof(h));
+    h.values_offset = align8(h.keys_offset + keys.size()*sizeof(detail::Image_key));
+    h.strings_offset = align8(h.values_offset +
+      values_.size()*sizeof(detail::Image_value));
+    h.strings_size = strings_.size()*sizeof(wchar_t);
+    h.data_offset = align8(h.strings_offset + h.strings_size);
+    h.data_size = data_.size();
+
+    std::uint64_t offset{};
+    const auto put = [&sink, &offset](const std::uint64_t at,
+      const void* const data, const std::size_t size)
+    {
+      static const char zeros[8]{};
+      if (at > offset)
+        sink(zeros, static_cast<std::size_t>(at - offset));
+      if (size)
+        sink(data, size);
+      offset = at + size;
+    };
+    put(0, &h, sizeof(h));
+    put(h.keys_offset, keys.data(), keys.size()*sizeof(detail::Image_key));
+    put(h.values_offset, values_.data(), values_.size()*sizeof(detail::Image_value));
+    put(h.strings_offset, strings_.data(), static_cast<std::size_t>(h.strings_size));
+    put(h.data_offset, data_.data(), data_.size());
+  }
+};
+
+/**
+ * @brief A read-only registry image.
+ *
+ * @details The image is either memory-mapped from file or viewed in memory.
+ * Lookups are answered directly from the image bytes without any parsing or
+ * allocations.
+ *
+ * @see Image_writer.
+ */
+class Image final : private Noncopy {
+public:
+  /// A key of the image.
+  class Key final {
+  public:
+    /// @returns The path of the key relative to the subtree root.
+    std::wstring_view path() const
+    {
+      return image_->string(record_->path_offset, record_->path_size);
+    }
+
+    /// @returns The number of values.
+    std::size_t size() const noexcept
+    {
+      return record_->value_count;
+    }
+
+    /**
+     * @returns The value at the specified `index`.
+     *
+     * @throws `std::out_of_range` if `index >= size()`.
+     */
+    Value_view operator[](const std::size_t index) const
+    {
+      if (!(index < size()))
+        throw std::out_of_range{"registry image value index out of range"};
+      return value_at(index);
+    }
+
+    /// @returns The value of the specified `name` if any.
+    std::optional<Value_view> find(const std::wstring_view name) const
+    {
+      std::size_t lo{}, hi{size()};
+      while (lo < hi) {
+        const auto mid = lo + (hi - lo) / 2;
+        const auto v = value_at(mid);
+        const auto cmp = compare_names(v.name, name);
+        if (!cmp)
+          return v;
+        else if (cmp < 0)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      return std::nullopt;
+    }
+
+    /**
+     * @returns The value of the specified `name` converted to `T`, or
+     * `std::nullopt` if no such a value.
+     *
+     * @see registry::to().
+     */
+    template<typename T>
+    std::optional<T> value(const std::wstring_view name) const
+    {
+      if (const auto v = find(name))
+        return to<T>(*v);
+      return std::nullopt;
+    }
+
+  private:
+    friend Image;
+
+    const Image* image_{};
+    const detail::Image_key* record_{};
+
+    Key(const Image& image, const detail::Image_key& record) noexcept
+      : image_{&image}
+      , record_{&record}
+    {}
+
+    /// @returns The value at the specified `index` without bounds checking.
+    Value_view value_at(const std::size_t index) const
+    {
+      return image_->value(record_->first_value + index);
+    }
+  };
+
+  /// Constructs an empty image.
+  Image() = default;
+
+  /// Maps the image file at `path`.
+  explicit Image(const std::filesystem::path& path)
+    : mapping_{path}
+  {
+    init(mapping_.bytes());
+  }
+
+  /**
+   * @brief Views the image in memory.
+   *
+   * @par Lifetime
+   * The `bytes` must outlive the instance. The `bytes` must be aligned to 8.
+   */
+  explicit Image(const std::span<const std::byte> bytes)
+  {
+    init(bytes);
+  }
+
+  /// @returns The number of keys.
+  std::size_t key_count() const noexcept
+  {
+    return keys_.size();
+  }
+
+  /// @returns The key at the specified `index` (keys are sorted by paths).
+  Key key(const std::size_t index) const
+  {
+    if (!(index < keys_.size()))
+      throw std::out_of_range{"registry image key index out of range"};
+    return Key{*this, keys_[index]};
+  }
+
+  /// @returns The key of the specified `path` if any.
+  std::optional<Key> find(const std::wstring_view path) const
+  {
+    const auto i = std::lower_bound(keys_.begin(), keys_.end(), path,
+      [this](const detail::Image_key& k, const std::wstring_view p)
+      {
+        return compare_names(string(k.path_offset, k.path_size), p) < 0;
+      });
+    if (i != keys_.end() && !compare_names(string(i->path_offset, i->path_size), path))
+      return Key{*this, *i};
+    return std::nullopt;
+  }
+
+  /**
+   * @returns The value of the specified `name` of the key at `path` converted
+   * to `T`, or `std::nullopt` if no such a key or value.
+   */
+  template<typename T>
+  std::optional<T> value(const std::wstring_view path,
+    const std::wstring_view name) const
+  {
+    if (const auto k = find(path))
+      return k->template value<T>(name);
+    return std::nullopt;
+  }
+
+private:
+  detail::File_mapping mapping_;
+  std::span<const detail::Image_key> keys_;
+  std::span<const detail::Image_value> values_;
+  std::wstring_view strings_;
+  std::span<const std::byte> data_;
+
+  [[noreturn]] static void throw_corrupted()
+  {
+    throw std::runtime_error{"cannot use registry image: image is corrupted"};
+  }
+
+  void init(const std::span<const std::byte> bytes)
+  {
+    if (bytes.size() < sizeof(detail::Image_header))
+      throw_corrupted();
+    else if (reinterpret_cast<std::uintptr_t>(bytes.data()) % 8)
+      throw std::invalid_argument{"cannot use registry image: misaligned data"};
+
+    const auto& h = *reinterpret_cast<const detail::Image_header*>(bytes.data());
+    if (std::memcmp(h.magic, detail::image_magic, sizeof(h.magic)))
+      throw std::runtime_error{"cannot use registry image: invalid magic"};
+    else if (h.version != detail::image_version)
+      throw std::runtime_error{"cannot use registry image: unsupported version"};
+    else if (h.byte_order != detail::image_byte_order ||
+      h.char_size != sizeof(wchar_t))
+      throw std::runtime_error{"cannot use registry image: image of"
+        " incompatible platform"};
+
+    const auto section = [&bytes](const std::uint64_t offset,
+      const std::uint64_t size)
+    {
+      if (offset % 8 || offset > bytes.size() || size > bytes.size() - offset)
+        throw_corrupted();
+      return bytes.data() + offset;
+    };
+    keys_ = {reinterpret_cast<const detail::Image_key*>(section(h.keys_offset,
+      std::uint64_t{h.key_count}*sizeof(detail::Image_key))), h.key_count};
+    values_ = {reinterpret_cast<const detail::Image_value*>(section(h.values_offset,
+      std::uint64_t{h.value_count}*sizeof(detail::Image_value))), h.value_count};
+    if (h.strings_size % sizeof(wchar_t))
+      throw_corrupted();
+    strings_ = {reinterpret_cast<const wchar_t*>(section(h.strings_offset,
+      h.strings_size)), static_cast<std::size_t>(h.strings_size/sizeof(wchar_t))};
+    data_ = {section(h.data_offset, h.data_size),
+      static_cast<std::size_t>(h.data_size)};
+    for (const auto& k : keys_) {
+      if (k.first_value > values_.size() ||
+        k.value_count > values_.size() - k.first_value)
+        throw_corrupted();
+    }
+  }
+
+  std::wstring_view string(const std::uint32_t offset,
+    const std::uint32_t size) const
+  {
+    if (offset > strings_.size() || size > strings_.size() - offset)
+      throw_corrupted();
+    return strings_.substr(offset, size);
+  }
+
+  Value_view value(const std::size_t index) const
+  {
+    const auto& v = values_[index];
+    if (v.data_offset > data_.size() || v.data_size > data_.size() - v.data_offset)
+      throw_corrupted();
+    return Value_view{string(v.name_offset, v.name_size),
+      static_cast<Value_type>(v.type),
+      data_.subspan(static_cast<std::size_t>(v.data_offset), v.data_size)};
+  }
+};
+
+} // namespace dmitigr::winbase::registry
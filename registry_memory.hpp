@@ -0,0 +1,345 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK.
+
+#pragma once
+
+#include "registry_backend.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dmitigr::winbase::registry {
+
+/**
+ * @brief An in-memory registry.
+ *
+ * @details Keys form the trie of path components. Both subkeys and values of
+ * each key are stored in vectors sorted by names case-insensitively. Readers
+ * are executed concurrently, writers are executed exclusively.
+ *
+ * Opened keys remain valid after removal: operations on them return
+ * Status::key_deleted.
+ */
+class Memory_backend final : public Backend {
+public:
+  /// Constructs the registry with empty predefined keys.
+  Memory_backend()
+  {
+    for (auto& r : roots_)
+      r.node = std::make_shared<Node>();
+  }
+
+  Key_handle root(const Root root) const noexcept override
+  {
+    return const_cast<Handle*>(&roots_[static_cast<int>(root)]);
+  }
+
+  Status open_key(const Key_handle key, const wchar_t* const subkey,
+    const Access, Key_handle& result) override
+  {
+    const std::shared_lock lock{mutex_};
+    std::shared_ptr<Node> node;
+    if (const auto err = find(key, subkey, node); !is_ok(err))
+      return err;
+    result = new Handle{std::move(node)};
+    return Status::success;
+  }
+
+  Status create_key(const Key_handle key, const wchar_t* const subkey,
+    const Access, Key_handle& result, bool& is_created) override
+  {
+    const std::unique_lock lock{mutex_};
+    auto node = handle(key)->node;
+    if (node->is_deleted)
+      return Status::key_deleted;
+    is_created = false;
+    for (auto path = to_view(subkey);;) {
+      const auto name = next_component(path);
+      if (name.empty())
+        break;
+      auto& children = node->children;
+      auto i = lower_bound(children, name);
+      if (i == children.end() || compare_names((*i)->name, name)) {
+        auto child = std::make_shared<Node>();
+        child->name = name;
+        child->parent = node.get();
+        i = children.insert(i, std::move(child));
+        is_created = true;
+      }
+      node = *i;
+    }
+    result = new Handle{std::move(node)};
+    return Status::success;
+  }
+
+  Status close_key(const Key_handle key) noexcept override
+  {
+    if (!is_root(key))
+      delete handle(key);
+    return Status::success;
+  }
+
+  Status query_info(const Key_handle key, Key_info& result) override
+  {
+    const std::shared_lock lock{mutex_};
+    const auto& node = *handle(key)->node;
+    if (node.is_deleted)
+      return Status::key_deleted;
+    result = {};
+    result.subkey_count = static_cast<std::uint32_t>(node.children.size());
+    for (const auto& c : node.children)
+      result.max_subkey_name_size = std::max(result.max_subkey_name_size,
+        static_cast<std::uint32_t>(c->name.size()));
+    result.value_count = static_cast<std::uint32_t>(node.values.size());
+    for (const auto& v : node.values) {
+      result.max_value_name_size = std::max(result.max_value_name_size,
+        static_cast<std::uint32_t>(v.name.size()));
+      result.max_value_data_size = std::max(result.max_value_data_size,
+        static_cast<std::uint32_t>(v.data.size()));
+    }
+    return Status::success;
+  }
+
+  Status enum_key(const Key_handle key, const std::uint32_t index,
+    wchar_t* const name, std::uint32_t& name_size) override
+  {
+    const std::shared_lock lock{mutex_};
+    const auto& node = *handle(key)->node;
+    if (node.is_deleted)
+      return Status::key_deleted;
+    else if (!(index < node.children.size()))
+      return Status::no_more_items;
+    return copy_name(node.children[index]->name, name, name_size);
+  }
+
+  Status enum_value(const Key_handle key, const std::uint32_t index,
+    wchar_t* const name, std::uint32_t& name_size, Value_type& type,
+    std::byte* const data, std::uint32_t& data_size) override
+  {
+    const std::shared_lock lock{mutex_};
+    const auto& node = *handle(key)->node;
+    if (node.is_deleted)
+      return Status::key_deleted;
+    else if (!(index < node.values.size()))
+      return Status::no_more_items;
+    const auto& value = node.values[index];
+    if (const auto err = copy_name(value.name, name, name_size); !is_ok(err))
+      return err;
+    type = value.type;
+    return copy_data(value.data, data, data_size);
+  }
+
+  Status get_value(const Key_handle key, const wchar_t* const subkey,
+    const wchar_t* const name, Value_type& type, std::byte* const data,
+    std::uint32_t& data_size) override
+  {
+    const std::shared_lock lock{mutex_};
+    std::shared_ptr<Node> node;
+    if (const auto err = find(key, subkey, node); !is_ok(err))
+      return err;
+    const auto& values = node->values;
+    const auto nm = to_view(name);
+    const auto i = lower_bound(values, nm);
+    if (i == values.end() || compare_names(i->name, nm))
+      return Status::file_not_found;
+    type = i->type;
+    return copy_data(i->data, data, data_size);
+  }
+
+  Status set_value(const Key_handle key, const wchar_t* const name,
+    const Value_type type, const std::byte* const data,
+    const std::uint32_t data_size) override
+  {
+    const std::unique_lock lock{mutex_};
+    auto& node = *handle(key)->node;
+    if (node.is_deleted)
+      return Status::key_deleted;
+    const auto nm = to_view(name);
+    auto& values = node.values;
+    auto i = lower_bound(values, nm);
+    if (i == values.end() || compare_names(i->name, nm))
+      i = values.insert(i, Value{std::wstring{nm}, type, {}});
+    i->type = type;
+    i->data.assign(data, data + data_size);
+    return Status::success;
+  }
+
+  Status remove_value(const Key_handle key, const wchar_t* const subkey,
+    const wchar_t* const name) override
+  {
+    const std::unique_lock lock{mutex_};
+    std::shared_ptr<Node> node;
+    if (const auto err = find(key, subkey, node); !is_ok(err))
+      return err;
+    const auto nm = to_view(name);
+    auto& values = node->values;
+    const auto i = lower_bound(values, nm);
+    if (i == values.end() || compare_names(i->name, nm))
+      return Status::file_not_found;
+    values.erase(i);
+    return Status::success;
+  }
+
+  Status remove_key(const Key_handle key, const wchar_t* const subkey) override
+  {
+    if (!subkey || !*subkey)
+      return Status::invalid_parameter;
+
+    const std::unique_lock lock{mutex_};
+    std::shared_ptr<Node> node;
+    if (const auto err = find(key, subkey, node); !is_ok(err))
+      return err;
+    else if (!node->children.empty() || !node->parent)
+      return Status::access_denied;
+    auto& siblings = node->parent->children;
+    siblings.erase(lower_bound(siblings, node->name));
+    node->is_deleted = true;
+    node->parent = nullptr;
+    node->values.clear();
+    return Status::success;
+  }
+
+private:
+  struct Value final {
+    std::wstring name;
+    Value_type type{};
+    std::vector<std::byte> data;
+  };
+
+  struct Node final {
+    std::wstring name;
+    Node* parent{};
+    bool is_deleted{};
+    std::vector<std::shared_ptr<Node>> children;
+    std::vector<Value> values;
+  };
+
+  struct Handle final {
+    std::shared_ptr<Node> node;
+  };
+
+  mutable std::shared_mutex mutex_;
+  Handle roots_[5];
+
+  static const std::wstring& name_of(const std::shared_ptr<Node>& node) noexcept
+  {
+    return node->name;
+  }
+
+  static const std::wstring& name_of(const Value& value) noexcept
+  {
+    return value.name;
+  }
+
+  template<class Container>
+  static auto lower_bound(Container& container, const std::wstring_view name)
+    -> decltype(container.begin())
+  {
+    return std::lower_bound(container.begin(), container.end(), name,
+      [](const auto& e, const std::wstring_view n)
+      {
+        return compare_names(name_of(e), n) < 0;
+      });
+  }
+
+  static std::wstring_view to_view(const wchar_t* const str) noexcept
+  {
+    return str ? std::wstring_view{str} : std::wstring_view{};
+  }
+
+  /**
+   * @returns The next non-empty component of `path`, or empty view if there
+   * are no more components.
+   */
+  static std::wstring_view next_component(std::wstring_view& path) noexcept
+  {
+    while (!path.empty()) {
+      const auto pos = path.find(L'\\');
+      const auto result = path.substr(0, pos);
+      path.remove_prefix(pos == std::wstring_view::npos ? path.size() : pos + 1);
+      if (!result.empty())
+        return result;
+    }
+    return {};
+  }
+
+  static Handle* handle(const Key_handle key) noexcept
+  {
+    return static_cast<Handle*>(key);
+  }
+
+  bool is_root(const Key_handle key) const noexcept
+  {
+    const auto* const h = handle(key);
+    return roots_ <= h && h < roots_ + std::size(roots_);
+  }
+
+  Status find(const Key_handle key, const wchar_t* const subkey,
+    std::shared_ptr<Node>& result) const
+  {
+    const auto* node = &handle(key)->node;
+    if ((*node)->is_deleted)
+      return Status::key_deleted;
+    for (auto path = to_view(subkey);;) {
+      const auto name = next_component(path);
+      if (name.empty())
+        break;
+      const auto& children = (*node)->children;
+      const auto i = lower_bound(children, name);
+      if (i == children.end() || compare_names((*i)->name, name))
+        return Status::file_not_found;
+      node = &*i;
+    }
+    result = *node;
+    return Status::success;
+  }
+
+  static Status copy_name(const std::wstring& name, wchar_t* const result,
+    std::uint32_t& result_size) noexcept
+  {
+    if (!(name.size() < result_size))
+      return Status::more_data;
+    std::copy(name.begin(), name.end(), result);
+    result[name.size()] = L'\0';
+    result_size = static_cast<std::uint32_t>(name.size());
+    return Status::success;
+  }
+
+  static Status copy_data(const std::vector<std::byte>& data,
+    std::byte* const result, std::uint32_t& result_size) noexcept
+  {
+    const auto capacity = result_size;
+    result_size = static_cast<std::uint32_t>(data.size());
+    if (!result)
+      return Status::success;
+    else if (capacity < data.size())
+      return Status::more_data;
+    if (!data.empty())
+      std::memcpy(result, data.data(), data.size());
+    return Status::success;
+  }
+};
+
+} // namespace dmitigr::winbase::registry
@@ -0,0 +1,269 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK.
+
+#pragma once
+
+#include "../base/noncopymove.hpp"
+#include "registry_value.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::winbase::registry {
+
+/**
+ * @brief An immutable snapshot of all values of a registry key.
+ *
+ * @details Names and data of all the values are stored in the one contiguous
+ * arena. The values are sorted by names case-insensitively.
+ */
+class Key_snapshot final : private Noncopy {
+public:
+  class Builder;
+
+  /// The iterator type.
+  using Iterator = std::vector<Value_view>::const_iterator;
+
+  /// Constructs an empty instance.
+  Key_snapshot() = default;
+
+  /// @returns The number of values.
+  std::size_t size() const noexcept
+  {
+    return values_.size();
+  }
+
+  /// @returns `size() == 0`.
+  bool is_empty() const noexcept
+  {
+    return values_.empty();
+  }
+
+  /// @returns The value at the specified `index`.
+  const Value_view& operator[](const std::size_t index) const
+  {
+    return values_[index];
+  }
+
+  /// @returns The value of the specified `name`, or `nullptr` if no such a value.
+  const Value_view* find(const std::wstring_view name) const noexcept
+  {
+    const auto i = std::lower_bound(values_.begin(), values_.end(), name,
+      [](const Value_view& v, const std::wstring_view n)
+      {
+        return compare_names(v.name, n) < 0;
+      });
+    return i != values_.end() && !compare_names(i->name, name) ? &*i : nullptr;
+  }
+
+  /**
+   * @returns The value of the specified `name` converted to `T`, or
+   * `std::nullopt` if no such a value.
+   *
+   * @see registry::to().
+   */
+  template<typename T>
+  std::optional<T> value(const std::wstring_view name) const
+  {
+    if (const auto* const v = find(name))
+      return to<T>(*v);
+    return std::nullopt;
+  }
+
+  /// @returns The iterator to the first value.
+  Iterator begin() const noexcept
+  {
+    return values_.begin();
+  }
+
+  /// @returns The iterator past the last value.
+  Iterator end() const noexcept
+  {
+    return values_.end();
+  }
+
+  /// @returns The size of the arena in bytes.
+  std::size_t arena_size() const noexcept
+  {
+    return arena_size_;
+  }
+
+private:
+  std::unique_ptr<std::byte[]> arena_;
+  std::size_t arena_size_{};
+  std::vector<Value_view> values_;
+};
+
+/**
+ * @brief A builder of Key_snapshot.
+ *
+ * @details The values are written directly to the arena either by append(),
+ * or by the pair of prepare() and commit() which allows a system call to fill
+ * the arena in place.
+ */
+class Key_snapshot::Builder final : private Noncopy {
+public:
+  /// A place to write the next value to.
+  struct Slot final {
+    wchar_t* name{};
+    std::byte* data{};
+  };
+
+  /// Constructs an empty builder.
+  Builder() = default;
+
+  /**
+   * @brief Constructs the builder with the preallocated arena.
+   *
+   * @details The arena is preallocated for `value_count` names and the only
+   * data of the maximum size, since the sizes of data usually vary greatly.
+   * It grows on demand.
+   *
+   * @param value_count The expected number of values.
+   * @param max_name_size The expected maximum length of names (in characters).
+   * @param max_data_size The expected maximum size of data (in bytes).
+   */
+  Builder(const std::size_t value_count, const std::size_t max_name_size,
+    const std::size_t max_data_size)
+  {
+    entries_.reserve(value_count);
+    reserve(value_count*aligned(max_name_size*sizeof(wchar_t)) + max_data_size);
+  }
+
+  /**
+   * @returns The slot which can hold up to `max_name_size` characters of name
+   * and `max_data_size` bytes of data.
+   *
+   * @par Effects
+   * Invalidates the slot returned by the previous call.
+   */
+  Slot prepare(const std::size_t max_name_size, const std::size_t max_data_size)
+  {
+    const auto name_offset = aligned(size_);
+    const auto name_bytes = max_name_size*sizeof(wchar_t);
+    reserve(name_offset + name_bytes + max_data_size);
+    prepared_name_size_ = max_name_size;
+    prepared_data_size_ = max_data_size;
+    return Slot{reinterpret_cast<wchar_t*>(arena_.get() + name_offset),
+      arena_.get() + name_offset + name_bytes};
+  }
+
+  /**
+   * @brief Commits the value written to the slot returned by prepare().
+   *
+   * @param name_size The actual length of the name (in characters).
+   * @param type The value type.
+   * @param data_size The actual size of the data (in bytes).
+   *
+   * @par Requires
+   * `name_size` and `data_size` must not exceed the sizes passed to prepare().
+   */
+  void commit(const std::size_t name_size, const Value_type type,
+    const std::size_t data_size)
+  {
+    if (name_size > prepared_name_size_ || data_size > prepared_data_size_)
+      throw std::logic_error{"cannot commit value to Key_snapshot::Builder:"
+        " slot overflow"};
+
+    const auto name_offset = aligned(size_);
+    const auto data_offset = name_offset + prepared_name_size_*sizeof(wchar_t);
+    const auto name_end = name_offset + name_size*sizeof(wchar_t);
+    if (name_end != data_offset && data_size)
+      std::memmove(arena_.get() + name_end, arena_.get() + data_offset, data_size);
+    entries_.push_back(Entry{name_offset, name_size, type, name_end, data_size});
+    size_ = name_end + data_size;
+    prepared_name_size_ = prepared_data_size_ = 0;
+  }
+
+  /// Appends the value.
+  void append(const std::wstring_view name, const Value_type type,
+    const std::span<const std::byte> data)
+  {
+    const auto slot = prepare(name.size(), data.size());
+    std::copy(name.begin(), name.end(), slot.name);
+    if (!data.empty())
+      std::memcpy(slot.data, data.data(), data.size());
+    commit(name.size(), type, data.size());
+  }
+
+  /// @returns The built snapshot.
+  Key_snapshot finish() &&
+  {
+    Key_snapshot result;
+    result.values_.reserve(entries_.size());
+    for (const auto& e : entries_)
+      result.values_.push_back(Value_view{
+        {reinterpret_cast<const wchar_t*>(arena_.get() + e.name_offset), e.name_size},
+        e.type,
+        {arena_.get() + e.data_offset, e.data_size}});
+    std::sort(result.values_.begin(), result.values_.end(),
+      [](const Value_view& lhs, const Value_view& rhs)
+      {
+        return compare_names(lhs.name, rhs.name) < 0;
+      });
+    result.arena_ = std::move(arena_);
+    result.arena_size_ = size_;
+    entries_.clear();
+    capacity_ = size_ = 0;
+    return result;
+  }
+
+private:
+  struct Entry final {
+    std::size_t name_offset{};
+    std::size_t name_size{};
+    Value_type type{};
+    std::size_t data_offset{};
+    std::size_t data_size{};
+  };
+
+  std::unique_ptr<std::byte[]> arena_;
+  std::size_t capacity_{};
+  std::size_t size_{};
+  std::size_t prepared_name_size_{};
+  std::size_t prepared_data_size_{};
+  std::vector<Entry> entries_;
+
+  static constexpr std::size_t aligned(const std::size_t offset) noexcept
+  {
+    constexpr std::size_t a{alignof(wchar_t)};
+    return (offset + a - 1) / a * a;
+  }
+
+  void reserve(const std::size_t capacity)
+  {
+    if (capacity <= capacity_)
+      return;
+
+    const auto new_capacity = std::max(capacity, capacity_*2);
+    std::unique_ptr<std::byte[]> new_arena{new std::byte[new_capacity]};
+    if (size_)
+      std::memcpy(new_arena.get(), arena_.get(), size_);
+    arena_ = std::move(new_arena);
+    capacity_ = new_capacity;
+  }
+};
+
+} // namespace dmitigr::winbase::registry
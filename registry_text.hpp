@@ -0,0 +1,659 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK.
+
+#pragma once
+
+#include "registry_backend.hpp"
+#include "registry_value.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::winbase::registry {
+
+/// An entry of the .reg file.
+struct Text_entry final {
+  /// An entry kind.
+  enum class Kind {
+    /// `[path]`.
+    key,
+    /// `[-path]`.
+    key_removal,
+    /// `"name"=data`.
+    value,
+    /// `"name"=-`.
+    value_removal
+  };
+
+  /// The kind.
+  Kind kind{};
+
+  /// The full path of the key, starting with the name of predefined key.
+  std::wstring_view path;
+
+  /// The value. (Only the name is meaningful for `Kind::value_removal`.)
+  Value_view value;
+};
+
+/**
+ * @brief A streaming reader of the .reg files.
+ *
+ * @details Both the "Windows Registry Editor Version 5.00" (UTF-16LE with BOM)
+ * and the "REGEDIT4" (8-bit, read as Latin-1) formats are supported. The input
+ * is read by fixed-size chunks and the entries are parsed into the reusable
+ * buffers, so the memory consumption is bounded by the longest entry rather
+ * than by the size of input.
+ */
+class Text_reader final : private Noncopy {
+public:
+  /**
+   * @brief Reads the header from `input`.
+   *
+   * @par Requires
+   * `input` must be opened in binary mode.
+   */
+  explicit Text_reader(std::istream& input)
+    : input_{input}
+    , chunk_(65536)
+  {
+    if (fill() && size_ >= 2 && chunk_[0] == '\xff' && chunk_[1] == '\xfe') {
+      is_unicode_ = true;
+      pos_ = 2;
+    }
+
+    if (!read_line(line_))
+      throw std::runtime_error{"cannot read .reg file: no header"};
+    if (trimmed(line_) != (is_unicode_ ?
+        L"Windows Registry Editor Version 5.00" : L"REGEDIT4"))
+      fail("invalid header");
+  }
+
+  /**
+   * @returns The next entry, or `nullptr` at the end of input.
+   *
+   * @remarks The returned entry is valid until the next call.
+   */
+  const Text_entry* next()
+  {
+    while (read_logical_line()) {
+      auto str = trimmed(line_);
+      if (str.empty() || str.front() == L';')
+        continue;
+      else if (str.front() == L'[')
+        parse_key(str);
+      else if (str.front() == L'"' || str.front() == L'@')
+        parse_value(str);
+      else
+        fail("unexpected line");
+      return &entry_;
+    }
+    return nullptr;
+  }
+
+  /// @returns `true` if the input is UTF-16LE.
+  bool is_unicode() const noexcept
+  {
+    return is_unicode_;
+  }
+
+  /// @returns The number of the last read line.
+  std::size_t line_number() const noexcept
+  {
+    return line_number_;
+  }
+
+private:
+  std::istream& input_;
+  std::vector<char> chunk_;
+  std::size_t pos_{};
+  std::size_t size_{};
+  bool is_unicode_{};
+  std::size_t line_number_{};
+  std::wstring line_;
+  std::wstring path_;
+  std::wstring name_;
+  std::wstring text_;
+  std::vector<std::byte> data_;
+  Text_entry entry_;
+
+  [[noreturn]] void fail(const char* const what) const
+  {
+    throw std::runtime_error{"invalid .reg file at line "
+      + std::to_string(line_number_) + ": " + what};
+  }
+
+  bool fill()
+  {
+    input_.read(chunk_.data(), static_cast<std::streamsize>(chunk_.size()));
+    size_ = static_cast<std::size_t>(input_.gcount());
+    pos_ = 0;
+    return size_ > 0;
+  }
+
+  /// @returns The next code unit, or `-1` at the end of input.
+  long get()
+  {
+    if (pos_ == size_ && !fill())
+      return -1;
+    const long lo = static_cast<unsigned char>(chunk_[pos_++]);
+    if (!is_unicode_)
+      return lo;
+    else if (pos_ == size_ && !fill())
+      fail("truncated UTF-16 code unit");
+    const long hi = static_cast<unsigned char>(chunk_[pos_++]);
+    return lo | hi << 8;
+  }
+
+  /// Appends the next physical line without line terminator to `result`.
+  bool read_line(std::wstring& result)
+  {
+    long ch{get()};
+    if (ch < 0)
+      return false;
+    for (; ch >= 0 && ch != L'\n'; ch = get())
+      result.push_back(static_cast<wchar_t>(ch));
+    if (!result.empty() && result.back() == L'\r')
+      result.pop_back();
+    ++line_number_;
+    return true;
+  }
+
+  /// Reads the next line joining the lines ended with backslash.
+  bool read_logical_line()
+  {
+    line_.clear();
+    if (!read_line(line_))
+      return false;
+    while (true) {
+      while (!line_.empty() && is_space(line_.back()))
+        line_.pop_back();
+      if (line_.empty() || line_.back() != L'\\')
+        break;
+      line_.pop_back();
+      const auto offset = line_.size();
+      if (!read_line(line_))
+        break;
+      const auto first = line_.find_first_not_of(L" \t", offset);
+      line_.erase(offset, first == std::wstring::npos ? first : first - offset);
+    }
+    return true;
+  }
+
+  void parse_key(std::wstring_view str)
+  {
+    const auto close = str.rfind(L']');
+    if (close == std::wstring_view::npos)
+      fail("unterminated key path");
+    str = str.substr(1, close - 1);
+    const bool is_removal = !str.empty() && str.front() == L'-';
+    if (is_removal)
+      str.remove_prefix(1);
+    if (str.empty())
+      fail("empty key path");
+    path_.assign(str);
+    entry_ = {};
+    entry_.kind = is_removal ? Text_entry::Kind::key_removal :
+      Text_entry::Kind::key;
+    entry_.path = path_;
+  }
+
+  void parse_value(std::wstring_view str)
+  {
+    if (path_.empty())
+      fail("value outside of key");
+
+    if (str.front() == L'@') {
+      name_.clear();
+      str.remove_prefix(1);
+    } else
+      parse_string(str, name_);
+    str = trimmed(str);
+    if (str.empty() || str.front() != L'=')
+      fail("expected =");
+    str = trimmed(str.substr(1));
+
+    entry_ = {};
+    entry_.path = path_;
+    entry_.kind = Text_entry::Kind::value;
+    data_.clear();
+    if (str == L"-") {
+      entry_.kind = Text_entry::Kind::value_removal;
+      entry_.value.type = Value_type::none;
+    } else if (!str.empty() && str.front() == L'"') {
+      parse_string(str, text_);
+      if (!trimmed(str).empty())
+        fail("unexpected characters after string");
+      detail::append_utf16(text_, data_);
+      data_.resize(data_.size() + 2);
+      entry_.value.type = Value_type::sz;
+    } else if (str.starts_with(L"dword:")) {
+      str.remove_prefix(6);
+      const auto dw = parse_hex(str, 8);
+      if (!trimmed(str).empty())
+        fail("invalid dword");
+      for (int i{}; i < 4; ++i)
+        data_.push_back(static_cast<std::byte>(dw >> 8*i & 0xff));
+      entry_.value.type = Value_type::dword;
+    } else if (str.starts_with(L"hex")) {
+      str.remove_prefix(3);
+      entry_.value.type = Value_type::binary;
+      if (!str.empty() && str.front() == L'(') {
+        str.remove_prefix(1);
+        entry_.value.type = static_cast<Value_type>(parse_hex(str, 8));
+        if (str.empty() || str.front() != L')')
+          fail("expected )");
+        str.remove_prefix(1);
+      }
+      if (str.empty() || str.front() != L':')
+        fail("expected :");
+      str.remove_prefix(1);
+      parse_bytes(str);
+    } else
+      fail("unknown value format");
+    entry_.value.name = name_;
+    entry_.value.data = data_;
+  }
+
+  /// Parses the quoted string from `str` to `result`.
+  void parse_string(std::wstring_view& str, std::wstring& result)
+  {
+    result.clear();
+    for (std::size_t i{1}; i < str.size(); ++i) {
+      const auto ch = str[i];
+      if (ch == L'"') {
+        str.remove_prefix(i + 1);
+        return;
+      } else if (ch == L'\\' && i + 1 < str.size())
+        ++i;
+      result.push_back(str[i]);
+    }
+    fail("unterminated string");
+  }
+
+  /// Parses the comma-separated hex bytes from `str` to `data_`.
+  void parse_bytes(std::wstring_view str)
+  {
+    while (!(str = trimmed(str)).empty()) {
+      data_.push_back(static_cast<std::byte>(parse_hex(str, 2)));
+      str = trimmed(str);
+      if (!str.empty()) {
+        if (str.front() != L',')
+          fail("expected ,");
+        str.remove_prefix(1);
+      }
+    }
+  }
+
+  /// Parses up to `max_digits` hex digits from `str`.
+  std::uint32_t parse_hex(std::wstring_view& str, const std::size_t max_digits)
+  {
+    std::uint32_t result{};
+    std::size_t i{};
+    for (; i < str.size() && i < max_digits; ++i) {
+      const auto ch = str[i];
+      unsigned digit{};
+      if (L'0' <= ch && ch <= L'9')
+        digit = ch - L'0';
+      else if (L'a' <= ch && ch <= L'f')
+        digit = ch - L'a' + 10;
+      else if (L'A' <= ch && ch <= L'F')
+        digit = ch - L'A' + 10;
+      else
+        break;
+      result = result << 4 | digit;
+    }
+    if (!i)
+      fail("expected hex digit");
+    str.remove_prefix(i);
+    return result;
+  }
+
+  static bool is_space(const wchar_t ch) noexcept
+  {
+    return ch == L' ' || ch == L'\t';
+  }
+
+  static std::wstring_view trimmed(std::wstring_view str) noexcept
+  {
+    while (!str.empty() && is_space(str.front()))
+      str.remove_prefix(1);
+    while (!str.empty() && is_space(str.back()))
+      str.remove_suffix(1);
+    return str;
+  }
+};
+
+/**
+ * @brief A streaming writer of the .reg files.
+ *
+ * @details The output is encoded in UTF-16LE in the "Windows Registry Editor
+ * Version 5.00" format and written by fixed-size chunks. Binary data is
+ * wrapped by continuation lines like the Registry Editor does.
+ */
+class Text_writer final : private Noncopy {
+public:
+  /// Flushes the output.
+  ~Text_writer()
+  {
+    flush();
+  }
+
+  /**
+   * @brief Writes the header to `output`.
+   *
+   * @par Requires
+   * `output` must be opened in binary mode.
+   */
+  explicit Text_writer(std::ostream& output)
+    : output_{output}
+  {
+    buffer_.reserve(chunk_size + 1024);
+    buffer_.push_back('\xff');
+    buffer_.push_back('\xfe');
+    put(L"Windows Registry Editor Version 5.00\r\n");
+  }
+
+  /// Writes the key `path`.
+  void key(const std::wstring_view path)
+  {
+    put(L"\r\n[");
+    put(path);
+    put(L"]\r\n");
+  }
+
+  /// Writes the removal of the key `path`.
+  void remove_key(const std::wstring_view path)
+  {
+    put(L"\r\n[-");
+    put(path);
+    put(L"]\r\n");
+  }
+
+  /// Writes the value of the last written key.
+  void value(const Value_view& value)
+  {
+    put_name(value.name);
+    const auto data = value.data;
+    if (value.type == Value_type::sz && is_printable(data)) {
+      put(L'"');
+      for (std::size_t i{}; i + 2 < data.size(); i += 2) {
+        const auto ch = unit(data, i);
+        if (ch == L'"' || ch == L'\\')
+          put(L'\\');
+        put(ch);
+      }
+      put(L'"');
+    } else if (value.type == Value_type::dword && data.size() == 4) {
+      put(L"dword:");
+      for (int i{3}; i >= 0; --i)
+        put_hex(std::to_integer<unsigned>(data[i]));
+    } else {
+      if (value.type == Value_type::binary)
+        put(L"hex:");
+      else {
+        put(L"hex(");
+        const auto type = static_cast<std::uint32_t>(value.type);
+        bool is_leading{true};
+        for (int shift{28}; shift >= 0; shift -= 4) {
+          const auto digit = type >> shift & 0xf;
+          if (digit || !is_leading || !shift) {
+            put(hex_digit(digit));
+            is_leading = false;
+          }
+        }
+        put(L"):");
+      }
+      for (std::size_t i{}; i < data.size(); ++i) {
+        put_hex(std::to_integer<unsigned>(data[i]));
+        if (i + 1 < data.size()) {
+          put(L',');
+          if (column_ > 76)
+            put(L"\\\r\n  ");
+        }
+      }
+    }
+    put(L"\r\n");
+  }
+
+  /// Writes the removal of the value of the last written key.
+  void remove_value(const std::wstring_view name)
+  {
+    put_name(name);
+    put(L"-\r\n");
+  }
+
+  /// Writes `entry`.
+  void write(const Text_entry& entry)
+  {
+    using Kind = Text_entry::Kind;
+    switch (entry.kind) {
+    case Kind::key: key(entry.path); break;
+    case Kind::key_removal: remove_key(entry.path); break;
+    case Kind::value: value(entry.value); break;
+    case Kind::value_removal: remove_value(entry.value.name); break;
+    }
+  }
+
+  /// Writes the buffered output.
+  void flush()
+  {
+    if (!buffer_.empty()) {
+      output_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+      buffer_.clear();
+    }
+  }
+
+private:
+  static constexpr std::size_t chunk_size{65536};
+  std::ostream& output_;
+  std::vector<char> buffer_;
+  std::size_t column_{};
+
+  void put(const wchar_t ch)
+  {
+    buffer_.push_back(static_cast<char>(ch & 0xff));
+    buffer_.push_back(static_cast<char>(ch >> 8 & 0xff));
+    column_ = ch == L'\n' ? 0 : column_ + 1;
+    if (buffer_.size() >= chunk_size)
+      flush();
+  }
+
+  void put(const std::wstring_view str)
+  {
+    for (const auto ch : str)
+      put(ch);
+  }
+
+  void put_hex(const unsigned byte)
+  {
+    put(hex_digit(byte >> 4));
+    put(hex_digit(byte & 0xf));
+  }
+
+  void put_name(const std::wstring_view name)
+  {
+    if (name.empty()) {
+      put(L"@=");
+      return;
+    }
+    put(L'"');
+    for (const auto ch : name) {
+      if (ch == L'"' || ch == L'\\')
+        put(L'\\');
+      put(ch);
+    }
+    put(L"\"=");
+  }
+
+  static wchar_t hex_digit(const unsigned digit) noexcept
+  {
+    return L"0123456789abcdef"[digit & 0xf];
+  }
+
+  static wchar_t unit(const std::span<const std::byte> data,
+    const std::size_t offset) noexcept
+  {
+    return static_cast<wchar_t>(std::to_integer<unsigned>(data[offset]) |
+      std::to_integer<unsigned>(data[offset + 1]) << 8);
+  }
+
+  /**
+   * @returns `true` if `data` is the null-terminated UTF-16LE string without
+   * embedded nulls and line breaks, i.e. can be written as quoted string.
+   */
+  static bool is_printable(const std::span<const std::byte> data) noexcept
+  {
+    if (data.size() < 2 || data.size() % 2 || unit(data, data.size() - 2))
+      return false;
+    for (std::size_t i{}; i + 2 < data.size(); i += 2) {
+      const auto ch = unit(data, i);
+      if (!ch || ch == L'\r' || ch == L'\n')
+        return false;
+    }
+    return true;
+  }
+};
+
+namespace detail {
+
+/// @returns The name of `root` as used in the .reg files.
+inline std::wstring_view root_name(const Root root) noexcept
+{
+  switch (root) {
+  case Root::classes_root: return L"HKEY_CLASSES_ROOT";
+  case Root::current_user: return L"HKEY_CURRENT_USER";
+  case Root::local_machine: return L"HKEY_LOCAL_MACHINE";
+  case Root::users: return L"HKEY_USERS";
+  case Root::current_config: return L"HKEY_CURRENT_CONFIG";
+  }
+  return {};
+}
+
+/**
+ * @returns The predefined key and the subkey path of the full `path`.
+ *
+ * @remarks The subkey is a suffix of `path`.
+ */
+inline std::pair<Root, std::wstring_view> split_path(const std::wstring_view path)
+{
+  const auto pos = path.find(L'\\');
+  const auto name = path.substr(0, pos);
+  const auto subkey = pos == std::wstring_view::npos ?
+    path.substr(path.size()) : path.substr(pos + 1);
+  for (const auto& [root, abbr] : {
+      std::pair{Root::classes_root, L"HKCR"},
+      std::pair{Root::current_user, L"HKCU"},
+      std::pair{Root::local_machine, L"HKLM"},
+      std::pair{Root::users, L"HKU"},
+      std::pair{Root::current_config, L"HKCC"}}) {
+    if (!compare_names(name, root_name(root)) || !compare_names(name, abbr))
+      return {root, subkey};
+  }
+  throw std::runtime_error{"unknown predefined registry key in .reg file"};
+}
+
+inline void export_key(Text_writer& writer, Backend& backend,
+  const Key_handle key, std::wstring& path)
+{
+  writer.key(path);
+  for (const auto& value : snapshot(backend, key))
+    writer.value(value);
+  for (const auto& name : subkey_names(backend, key)) {
+    const auto sub = open_key(backend, key, name.c_str(), Access::read);
+    if (!sub)
+      continue; // removed concurrently
+    const auto size = path.size();
+    path.append(L"\\").append(name);
+    export_key(writer, backend, sub, path);
+    path.resize(size);
+  }
+}
+
+} // namespace detail
+
+/**
+ * @brief Imports the .reg file from `input` to `backend`.
+ *
+ * @details Values following the removal of key are ignored like the Registry
+ * Editor does.
+ *
+ * @returns The number of imported entries.
+ */
+inline std::size_t import_text(std::istream& input, Backend& backend)
+{
+  using Kind = Text_entry::Kind;
+  Text_reader reader{input};
+  Key_guard key;
+  std::size_t result{};
+  while (const auto* const entry = reader.next()) {
+    switch (entry->kind) {
+    case Kind::key: {
+      const auto [root, subkey] = detail::split_path(entry->path);
+      key = create_key(backend, backend.root(root), subkey.data()).first;
+      break;
+    }
+    case Kind::key_removal: {
+      key = Key_guard{};
+      const auto [root, subkey] = detail::split_path(entry->path);
+      if (subkey.empty())
+        throw std::runtime_error{"cannot remove predefined registry key"};
+      remove_tree(backend, backend.root(root), subkey.data());
+      break;
+    }
+    case Kind::value:
+      if (!key)
+        continue;
+      set_value(backend, key, entry->value.name.data(), entry->value.type,
+        entry->value.data);
+      break;
+    case Kind::value_removal:
+      if (!key)
+        continue;
+      remove_value(backend, key, nullptr, entry->value.name.data());
+      break;
+    }
+    ++result;
+  }
+  return result;
+}
+
+/// Exports the `subkey` of `root` with all its subkeys to `output`.
+inline void export_text(std::ostream& output, Backend& backend,
+  const Root root, const std::wstring_view subkey = {})
+{
+  std::wstring path{detail::root_name(root)};
+  if (!subkey.empty())
+    path.append(L"\\").append(subkey);
+  const auto key = open_key(backend, backend.root(root),
+    path.c_str() + path.size() - subkey.size(), Access::read);
+  if (!key)
+    throw_error(Status::file_not_found, "cannot open registry key");
+  Text_writer writer{output};
+  detail::export_key(writer, backend, key, path);
+  writer.flush();
+}
+
+} // namespace dmitigr::winbase::registry
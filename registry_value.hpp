@@ -0,0 +1,427 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header doesn't depend on the Windows SDK.
+
+#pragma once
+
+#include "../base/traits.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace dmitigr::winbase::registry {
+
+/// A registry value type. (Mirrors `REG_*` constants.)
+enum class Value_type : std::uint32_t {
+  none = 0,
+  sz = 1,
+  expand_sz = 2,
+  binary = 3,
+  dword = 4,
+  dword_big_endian = 5,
+  link = 6,
+  multi_sz = 7,
+  resource_list = 8,
+  full_resource_descriptor = 9,
+  resource_requirements_list = 10,
+  qword = 11
+};
+
+/**
+ * @returns The uppercase `ch`.
+ *
+ * @remarks This is an approximation of the ordinal case folding used by the
+ * registry which covers ASCII, Latin-1, Greek and Cyrillic letters and doesn't
+ * depend on the system tables (and thus is the same on every platform).
+ */
+constexpr wchar_t upcase(const wchar_t ch) noexcept
+{
+  if (ch < 0x80)
+    return L'a' <= ch && ch <= L'z' ? ch - 0x20 : ch;
+  else if ((0xE0 <= ch && ch <= 0xFE && ch != 0xF7) ||
+    (0x3B1 <= ch && ch <= 0x3CB && ch != 0x3C2) ||
+    (0x430 <= ch && ch <= 0x44F))
+    return ch - 0x20;
+  else if (0x450 <= ch && ch <= 0x45F)
+    return ch - 0x50;
+  return ch;
+}
+
+/**
+ * @returns Negative value if `lhs` is less than `rhs`, positive value if
+ * `lhs` is greater than `rhs`, or zero if names are equal ignoring the case.
+ */
+constexpr int compare_names(const std::wstring_view lhs,
+  const std::wstring_view rhs) noexcept
+{
+  const auto sz = lhs.size() < rhs.size() ? lhs.size() : rhs.size();
+  for (std::size_t i{}; i < sz; ++i) {
+    const auto l = upcase(lhs[i]);
+    const auto r = upcase(rhs[i]);
+    if (l != r)
+      return l < r ? -1 : 1;
+  }
+  return lhs.size() < rhs.size() ? -1 : lhs.size() > rhs.size();
+}
+
+/// Case-insensitive "less" of names.
+struct Name_less final {
+  using is_transparent = void;
+
+  constexpr bool operator()(const std::wstring_view lhs,
+    const std::wstring_view rhs) const noexcept
+  {
+    return compare_names(lhs, rhs) < 0;
+  }
+};
+
+/// A non-owning view of a registry value.
+struct Value_view final {
+  /// The value name.
+  std::wstring_view name;
+
+  /// The value type.
+  Value_type type{};
+
+  /// The raw value data.
+  std::span<const std::byte> data;
+};
+
+// -----------------------------------------------------------------------------
+// Typed values
+// -----------------------------------------------------------------------------
+
+/// A REG_EXPAND_SZ value (unexpanded).
+struct Expand_sz final {
+  std::wstring value;
+};
+
+/**
+ * @brief A REG_MULTI_SZ value.
+ *
+ * @details All the strings are stored in the single buffer in the registry
+ * format and are accessed as a range of `std::wstring_view`.
+ */
+class Multi_sz final {
+public:
+  /// The forward iterator over strings.
+  class Iterator final {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::wstring_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::wstring_view*;
+    using reference = std::wstring_view;
+
+    /// Constructs the past-the-end iterator.
+    Iterator() = default;
+
+    /// @returns The current string.
+    std::wstring_view operator*() const noexcept
+    {
+      return current_;
+    }
+
+    /// Advances the iterator.
+    Iterator& operator++() noexcept
+    {
+      next(current_.data() + current_.size() + 1);
+      return *this;
+    }
+
+    /// @overload
+    Iterator operator++(int) noexcept
+    {
+      auto result = *this;
+      ++*this;
+      return result;
+    }
+
+    /// @returns `true` if iterators points to the same string.
+    bool operator==(const Iterator& rhs) const noexcept
+    {
+      return current_.data() == rhs.current_.data();
+    }
+
+  private:
+    friend Multi_sz;
+
+    std::wstring_view current_;
+    const wchar_t* end_{};
+
+    Iterator(const wchar_t* const begin, const wchar_t* const end) noexcept
+      : end_{end}
+    {
+      next(begin);
+    }
+
+    void next(const wchar_t* const pos) noexcept
+    {
+      // The first empty string terminates the list.
+      if (pos < end_ && *pos) {
+        const auto e = std::find(pos, end_, L'\0');
+        current_ = {pos, static_cast<std::size_t>(e - pos)};
+      } else
+        current_ = {};
+    }
+  };
+
+  /// Constructs an empty instance.
+  Multi_sz()
+    : buffer_(2, L'\0')
+  {}
+
+  /**
+   * @brief Constructs the instance from the buffer of null-terminated strings.
+   *
+   * @details As in `REG_MULTI_SZ`, the first empty string terminates the list,
+   * so the rest of `buffer` is ignored. Trailing nulls of `buffer` are ignored.
+   */
+  explicit Multi_sz(std::wstring buffer)
+    : buffer_{std::move(buffer)}
+  {
+    if (!buffer_.empty() && !buffer_.front())
+      buffer_.clear();
+    else if (const auto pos = buffer_.find(std::wstring_view{L"\0\0", 2});
+      pos != std::wstring::npos)
+      buffer_.resize(pos);
+    while (!buffer_.empty() && !buffer_.back())
+      buffer_.pop_back();
+    buffer_.append(2, L'\0');
+  }
+
+  /// Constructs the instance from the list of strings.
+  Multi_sz(const std::initializer_list<std::wstring_view> strings)
+    : Multi_sz{strings.begin(), strings.end()}
+  {}
+
+  /**
+   * @brief Constructs the instance from the range of strings.
+   *
+   * @throws `std::invalid_argument` if any of the strings is empty or contains
+   * nulls, since it can't be represented in `REG_MULTI_SZ`.
+   */
+  template<typename InputIterator>
+  Multi_sz(InputIterator first, const InputIterator last)
+  {
+    for (; first != last; ++first) {
+      const std::wstring_view str{*first};
+      if (str.empty() || str.find(L'\0') != std::wstring_view::npos)
+        throw std::invalid_argument{"cannot construct Multi_sz:"
+          " invalid string"};
+      buffer_.append(str).push_back(L'\0');
+    }
+    buffer_.push_back(L'\0');
+    if (buffer_.size() == 1)
+      buffer_.push_back(L'\0');
+  }
+
+  /// @returns The iterator to the first string.
+  Iterator begin() const noexcept
+  {
+    return Iterator{buffer_.data(), buffer_.data() + content_size()};
+  }
+
+  /// @returns The iterator past the last string.
+  Iterator end() const noexcept
+  {
+    return Iterator{};
+  }
+
+  /// @returns `true` if there are no strings.
+  bool is_empty() const noexcept
+  {
+    return !content_size();
+  }
+
+  /// @returns The number of strings.
+  std::size_t size() const noexcept
+  {
+    return static_cast<std::size_t>(std::distance(begin(), end()));
+  }
+
+  /// @returns The buffer in the registry format (with two terminating nulls).
+  const std::wstring& buffer() const noexcept
+  {
+    return buffer_;
+  }
+
+private:
+  std::wstring buffer_;
+
+  std::size_t content_size() const noexcept
+  {
+    return buffer_.size() > 2 ? buffer_.size() - 2 : 0;
+  }
+};
+
+namespace detail {
+
+/// @returns The string decoded from UTF-16LE `data` without trailing nulls.
+inline std::wstring to_wstring(const std::span<const std::byte> data)
+{
+  std::wstring result(data.size() / 2, L'\0');
+  if constexpr (sizeof(wchar_t) == 2)
+    std::memcpy(result.data(), data.data(), result.size()*2);
+  else {
+    for (std::size_t i{}; i < result.size(); ++i)
+      result[i] = static_cast<wchar_t>(std::to_integer<unsigned>(data[2*i]) |
+        std::to_integer<unsigned>(data[2*i + 1]) << 8);
+  }
+  while (!result.empty() && !result.back())
+    result.pop_back();
+  return result;
+}
+
+/// @returns The unsigned integer decoded from `data`.
+template<typename T>
+T to_uint(const std::span<const std::byte> data, const bool is_big_endian)
+{
+  if (data.size() < sizeof(T))
+    throw std::runtime_error{"cannot convert registry value: invalid data size"};
+  T result{};
+  for (std::size_t i{}; i < sizeof(T); ++i) {
+    const auto b = data[is_big_endian ? i : sizeof(T) - 1 - i];
+    result = static_cast<T>(result << 8 | std::to_integer<T>(b));
+  }
+  return result;
+}
+
+} // namespace detail
+
+namespace detail {
+
+/// Appends the UTF-16LE representation of `str` to `result`.
+inline void append_utf16(const std::wstring_view str,
+  std::vector<std::byte>& result)
+{
+  const auto offset = result.size();
+  result.resize(offset + 2*str.size());
+  if constexpr (sizeof(wchar_t) == 2)
+    std::memcpy(result.data() + offset, str.data(), 2*str.size());
+  else {
+    auto* b = result.data() + offset;
+    for (const wchar_t ch : str) {
+      *b++ = static_cast<std::byte>(ch & 0xff);
+      *b++ = static_cast<std::byte>(ch >> 8 & 0xff);
+    }
+  }
+}
+
+/// @returns `true` if the value of `type` can be converted to `T`.
+template<typename T>
+constexpr bool is_convertible(const Value_type type) noexcept
+{
+  using std::is_same_v;
+  if constexpr (std::is_unsigned_v<T> && sizeof(T) == 4)
+    return type == Value_type::dword || type == Value_type::dword_big_endian;
+  else if constexpr (std::is_unsigned_v<T> && sizeof(T) == 8)
+    return type == Value_type::qword;
+  else if constexpr (is_same_v<T, std::wstring>)
+    return type == Value_type::sz || type == Value_type::expand_sz;
+  else if constexpr (is_same_v<T, Expand_sz>)
+    return type == Value_type::expand_sz;
+  else if constexpr (is_same_v<T, Multi_sz>)
+    return type == Value_type::multi_sz;
+  else if constexpr (is_same_v<T, std::vector<std::byte>>)
+    return true;
+  else
+    static_assert(false_value<T>, "unsupported type specified");
+}
+
+} // namespace detail
+
+/**
+ * @tparam T The result type. Can be 32-bit unsigned integer (REG_DWORD or
+ * REG_DWORD_BIG_ENDIAN), 64-bit unsigned integer (REG_QWORD), `std::wstring`
+ * (REG_SZ or REG_EXPAND_SZ), `Expand_sz`, `Multi_sz` or `std::vector<std::byte>`
+ * (any type).
+ *
+ * @returns The value of type `T` decoded from `value`.
+ *
+ * @throws `std::runtime_error` if the type of `value` doesn't correspond to `T`.
+ */
+template<typename T>
+T to(const Value_view& value)
+{
+  using D = std::decay_t<T>;
+  using std::is_same_v;
+  if (!detail::is_convertible<D>(value.type))
+    throw std::runtime_error{"cannot convert registry value: type mismatch"};
+
+  if constexpr (std::is_unsigned_v<D> && sizeof(D) == 4)
+    return detail::to_uint<D>(value.data,
+      value.type == Value_type::dword_big_endian);
+  else if constexpr (std::is_unsigned_v<D> && sizeof(D) == 8)
+    return detail::to_uint<D>(value.data, false);
+  else if constexpr (is_same_v<D, std::wstring>)
+    return detail::to_wstring(value.data);
+  else if constexpr (is_same_v<D, Expand_sz>)
+    return Expand_sz{detail::to_wstring(value.data)};
+  else if constexpr (is_same_v<D, Multi_sz>)
+    return Multi_sz(detail::to_wstring(value.data));
+  else if constexpr (is_same_v<D, std::vector<std::byte>>)
+    return D(value.data.begin(), value.data.end());
+}
+
+/**
+ * @brief Appends the registry representation of `value` to `result`.
+ *
+ * @tparam T The value type. Can be 32-bit unsigned integer (REG_DWORD), 64-bit
+ * unsigned integer (REG_QWORD), `std::wstring_view` or `std::wstring` (REG_SZ),
+ * `Expand_sz`, `Multi_sz`, or any type convertible to
+ * `std::span<const std::byte>` (REG_BINARY).
+ *
+ * @returns The value type.
+ */
+template<typename T>
+Value_type encode(const T& value, std::vector<std::byte>& result)
+{
+  using std::is_same_v;
+  if constexpr (std::is_unsigned_v<T> && (sizeof(T) == 4 || sizeof(T) == 8)) {
+    for (std::size_t i{}; i < sizeof(T); ++i)
+      result.push_back(static_cast<std::byte>(value >> 8*i & 0xff));
+    return sizeof(T) == 4 ? Value_type::dword : Value_type::qword;
+  } else if constexpr (std::is_convertible_v<const T&, std::wstring_view>) {
+    detail::append_utf16(value, result);
+    detail::append_utf16(std::wstring_view{L"\0", 1}, result);
+    return Value_type::sz;
+  } else if constexpr (is_same_v<T, Expand_sz>) {
+    encode(value.value, result);
+    return Value_type::expand_sz;
+  } else if constexpr (is_same_v<T, Multi_sz>) {
+    detail::append_utf16(value.buffer(), result);
+    return Value_type::multi_sz;
+  } else if constexpr (std::is_convertible_v<const T&, std::span<const std::byte>>) {
+    const std::span<const std::byte> bytes{value};
+    result.insert(result.end(), bytes.begin(), bytes.end());
+    return Value_type::binary;
+  } else
+    static_assert(false_value<T>, "unsupported type specified");
+}
+
+} // namespace dmitigr::winbase::registry
@@ -15,8 +15,10 @@
 // limitations under the License.
 
 #pragma once
+#ifdef _MSC_VER
 #pragma comment(lib, "kernel32")
 #pragma comment(lib, "user32")
+#endif
 
 #include "windows.hpp"
 
@@ -29,11 +31,11 @@
 namespace dmitigr::winbase {
 
 /// @returns The result of conversion UTF-8 string to UTF-16 wide string.
-inline std::wstring utf8_to_utf16(const std::string_view utf8,
+inline Wstring utf8_to_utf16(const std::string_view utf8,
   const UINT code_page = CP_UTF8)
 {
   if (utf8.empty())
-    return std::wstring{};
+    return Wstring{};
 
   static const auto throw_error = []
   {
@@ -48,7 +50,7 @@ inline std::wstring utf8_to_utf16(const std::string_view utf8,
   if (!result_size)
     throw_error();
 
-  std::wstring result;
+  Wstring result;
   result.resize(result_size);
   const int rs = MultiByteToWideChar(code_page, 0,
     utf8.data(), static_cast<int>(utf8.size()),
@@ -62,7 +64,7 @@ inline std::wstring utf8_to_utf16(const std::string_view utf8,
 }
 
 /// @returns The result of conversion UTF-16 wide-string to UTF-8 string.
-inline std::string utf16_to_utf8(const std::wstring_view utf16,
+inline std::string utf16_to_utf8(const Wstring_view utf16,
   const UINT code_page = CP_UTF8)
 {
   if (utf16.empty())
@@ -95,25 +97,25 @@ inline std::string utf16_to_utf8(const std::wstring_view utf16,
   return result;
 }
 
-inline void upper_first_letter(std::wstring& str)
+inline void upper_first_letter(Wstring& str)
 {
   if (!str.empty())
     CharUpperBuffW(str.data(), 1);
 }
 
-inline void lower_first_letter(std::wstring& str)
+inline void lower_first_letter(Wstring& str)
 {
   if (!str.empty())
     CharLowerBuffW(str.data(), 1);
 }
 
-inline std::wstring&& upper_first_letter(std::wstring&& str)
+inline Wstring&& upper_first_letter(Wstring&& str)
 {
   upper_first_letter(str);
   return std::move(str);
 }
 
-inline std::wstring&& lower_first_letter(std::wstring&& str)
+inline Wstring&& lower_first_letter(Wstring&& str)
 {
   lower_first_letter(str);
   return std::move(str);
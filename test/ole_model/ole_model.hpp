@@ -0,0 +1,1209 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * The portable model of the OLE Automation memory model.
+ *
+ * It provides the subset of the Windows SDK used by combase.hpp, so the latter
+ * can be built, tested and benchmarked on the platforms other than Windows.
+ * BSTR, VARIANT and SAFEARRAY are laid out, allocated, copied and released as
+ * on Windows: BSTR is prefixed with its size in bytes, the VARTYPE of
+ * SAFEARRAY is stored right before the descriptor, the elements are released
+ * according to the features of the array, etc. The differences are:
+ *
+ *   - `WCHAR` and `OLECHAR` are `char16_t` (since `wchar_t` is wider on the
+ *   most platforms), so the strings are UTF-16 as on Windows, but the wide
+ *   functions of the C library can't be used with them;
+ *   - `VariantChangeType()` converts between the numeric types, `bool` and
+ *   `BSTR` only (to `DECIMAL` from the integers only), and ignores the locale;
+ *   - `MultiByteToWideChar()` and `WideCharToMultiByte()` support UTF-8 only;
+ *   - the interfaces are declared to the extent used by combase.hpp.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwctype>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// -----------------------------------------------------------------------------
+// Basic types
+// -----------------------------------------------------------------------------
+
+typedef unsigned char BYTE;
+typedef char CHAR;
+typedef short SHORT;
+typedef unsigned short USHORT;
+typedef unsigned short WORD;
+typedef int INT;
+typedef int BOOL;
+typedef int LONG;
+typedef unsigned int UINT;
+typedef unsigned int ULONG;
+typedef unsigned int DWORD;
+typedef std::int64_t LONGLONG;
+typedef std::uint64_t ULONGLONG;
+typedef float FLOAT;
+typedef double DOUBLE;
+typedef std::size_t SIZE_T;
+typedef void* PVOID;
+typedef void* LPVOID;
+typedef void* HANDLE;
+typedef void* HLOCAL;
+typedef char* LPSTR;
+typedef const char* LPCSTR;
+typedef char16_t WCHAR;
+typedef WCHAR* LPWSTR;
+typedef const WCHAR* LPCWSTR;
+
+typedef LONG HRESULT;
+typedef LONG SCODE;
+typedef LONG DISPID;
+typedef DWORD LCID;
+
+#define TRUE 1
+#define FALSE 0
+#define WINAPI
+#define STDMETHODCALLTYPE
+#define MEMORY_ALLOCATION_ALIGNMENT 16
+
+#define S_OK ((HRESULT)0)
+#define S_FALSE ((HRESULT)1)
+#define E_UNEXPECTED ((HRESULT)0x8000FFFF)
+#define E_NOTIMPL ((HRESULT)0x80004001)
+#define E_NOINTERFACE ((HRESULT)0x80004002)
+#define E_POINTER ((HRESULT)0x80004003)
+#define E_FAIL ((HRESULT)0x80004005)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000E)
+#define E_INVALIDARG ((HRESULT)0x80070057)
+#define DISP_E_MEMBERNOTFOUND ((HRESULT)0x80020003)
+#define DISP_E_TYPEMISMATCH ((HRESULT)0x80020005)
+#define DISP_E_UNKNOWNNAME ((HRESULT)0x80020006)
+#define DISP_E_BADVARTYPE ((HRESULT)0x80020008)
+#define DISP_E_EXCEPTION ((HRESULT)0x80020009)
+#define DISP_E_OVERFLOW ((HRESULT)0x8002000A)
+#define DISP_E_BADINDEX ((HRESULT)0x8002000B)
+#define DISP_E_ARRAYISLOCKED ((HRESULT)0x8002000D)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+#define CP_ACP 0
+#define CP_UTF8 65001
+#define MB_ERR_INVALID_CHARS 0x8
+
+// -----------------------------------------------------------------------------
+// COM types
+// -----------------------------------------------------------------------------
+
+typedef WCHAR OLECHAR;
+typedef OLECHAR* LPOLESTR;
+typedef const OLECHAR* LPCOLESTR;
+typedef OLECHAR* BSTR;
+typedef unsigned short VARTYPE;
+typedef short VARIANT_BOOL;
+typedef double DATE;
+
+#define VARIANT_TRUE ((VARIANT_BOOL)-1)
+#define VARIANT_FALSE ((VARIANT_BOOL)0)
+#define VARIANT_NOVALUEPROP 0x1
+#define VARIANT_ALPHABOOL 0x2
+
+#define LOCALE_USER_DEFAULT 0x400
+#define DISPATCH_METHOD 0x1
+#define DISPATCH_PROPERTYGET 0x2
+#define DISPATCH_PROPERTYPUT 0x4
+#define DISPATCH_PROPERTYPUTREF 0x8
+#define DISPID_UNKNOWN (-1)
+#define DISPID_PROPERTYPUT (-3)
+
+struct GUID final {
+  DWORD Data1;
+  WORD Data2;
+  WORD Data3;
+  BYTE Data4[8];
+};
+typedef GUID CLSID;
+typedef GUID IID;
+typedef const GUID& REFGUID;
+typedef const GUID& REFCLSID;
+typedef const GUID& REFIID;
+
+inline constexpr IID IID_NULL{};
+
+enum VARENUM {
+  VT_EMPTY = 0,
+  VT_NULL = 1,
+  VT_I2 = 2,
+  VT_I4 = 3,
+  VT_R4 = 4,
+  VT_R8 = 5,
+  VT_CY = 6,
+  VT_DATE = 7,
+  VT_BSTR = 8,
+  VT_DISPATCH = 9,
+  VT_ERROR = 10,
+  VT_BOOL = 11,
+  VT_VARIANT = 12,
+  VT_UNKNOWN = 13,
+  VT_DECIMAL = 14,
+  VT_I1 = 16,
+  VT_UI1 = 17,
+  VT_UI2 = 18,
+  VT_UI4 = 19,
+  VT_I8 = 20,
+  VT_UI8 = 21,
+  VT_INT = 22,
+  VT_UINT = 23,
+  VT_RECORD = 36,
+  VT_VECTOR = 0x1000,
+  VT_ARRAY = 0x2000,
+  VT_BYREF = 0x4000,
+  VT_RESERVED = 0x8000,
+  VT_ILLEGAL = 0xffff,
+  VT_ILLEGALMASKED = 0xfff,
+  VT_TYPEMASK = 0xfff
+};
+
+union CY {
+  struct {
+    ULONG Lo;
+    LONG Hi;
+  };
+  LONGLONG int64;
+};
+
+struct DECIMAL final {
+  USHORT wReserved;
+  union {
+    struct {
+      BYTE scale;
+      BYTE sign;
+    };
+    USHORT signscale;
+  };
+  ULONG Hi32;
+  union {
+    struct {
+      ULONG Lo32;
+      ULONG Mid32;
+    };
+    ULONGLONG Lo64;
+  };
+};
+#define DECIMAL_NEG ((BYTE)0x80)
+
+struct SAFEARRAYBOUND final {
+  ULONG cElements;
+  LONG lLbound;
+};
+
+struct SAFEARRAY final {
+  USHORT cDims;
+  USHORT fFeatures;
+  ULONG cbElements;
+  ULONG cLocks;
+  PVOID pvData;
+  SAFEARRAYBOUND rgsabound[1];
+};
+
+#define FADF_AUTO 0x1
+#define FADF_STATIC 0x2
+#define FADF_EMBEDDED 0x4
+#define FADF_FIXEDSIZE 0x10
+#define FADF_RECORD 0x20
+#define FADF_HAVEIID 0x40
+#define FADF_HAVEVARTYPE 0x80
+#define FADF_BSTR 0x100
+#define FADF_UNKNOWN 0x200
+#define FADF_DISPATCH 0x400
+#define FADF_VARIANT 0x800
+
+struct IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void**) = 0;
+  virtual ULONG STDMETHODCALLTYPE AddRef() = 0;
+  virtual ULONG STDMETHODCALLTYPE Release() = 0;
+};
+
+struct TYPEATTR final {
+  GUID guid;
+  LCID lcid;
+  WORD wMajorVerNum;
+  WORD wMinorVerNum;
+};
+
+struct ITypeInfo : IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE GetTypeAttr(TYPEATTR**) = 0;
+  virtual void STDMETHODCALLTYPE ReleaseTypeAttr(TYPEATTR*) = 0;
+};
+struct IRecordInfo : IUnknown {};
+
+struct IDispatch;
+
+struct tagVARIANT final {
+  union {
+    struct {
+      VARTYPE vt;
+      WORD wReserved1;
+      WORD wReserved2;
+      WORD wReserved3;
+      union {
+        LONGLONG llVal;
+        LONG lVal;
+        BYTE bVal;
+        SHORT iVal;
+        FLOAT fltVal;
+        DOUBLE dblVal;
+        VARIANT_BOOL boolVal;
+        SCODE scode;
+        CY cyVal;
+        DATE date;
+        BSTR bstrVal;
+        IUnknown* punkVal;
+        IDispatch* pdispVal;
+        SAFEARRAY* parray;
+        BYTE* pbVal;
+        SHORT* piVal;
+        LONG* plVal;
+        LONGLONG* pllVal;
+        FLOAT* pfltVal;
+        DOUBLE* pdblVal;
+        VARIANT_BOOL* pboolVal;
+        SCODE* pscode;
+        CY* pcyVal;
+        DATE* pdate;
+        BSTR* pbstrVal;
+        IUnknown** ppunkVal;
+        IDispatch** ppdispVal;
+        SAFEARRAY** pparray;
+        tagVARIANT* pvarVal;
+        PVOID byref;
+        CHAR cVal;
+        USHORT uiVal;
+        ULONG ulVal;
+        ULONGLONG ullVal;
+        INT intVal;
+        UINT uintVal;
+        DECIMAL* pdecVal;
+        CHAR* pcVal;
+        USHORT* puiVal;
+        ULONG* pulVal;
+        ULONGLONG* pullVal;
+        INT* pintVal;
+        UINT* puintVal;
+        struct {
+          PVOID pvRecord;
+          IRecordInfo* pRecInfo;
+        };
+      };
+    };
+    DECIMAL decVal;
+  };
+};
+typedef tagVARIANT VARIANT;
+typedef VARIANT VARIANTARG;
+
+struct DISPPARAMS final {
+  VARIANTARG* rgvarg;
+  DISPID* rgdispidNamedArgs;
+  UINT cArgs;
+  UINT cNamedArgs;
+};
+
+struct EXCEPINFO final {
+  WORD wCode;
+  WORD wReserved;
+  BSTR bstrSource;
+  BSTR bstrDescription;
+  BSTR bstrHelpFile;
+  DWORD dwHelpContext;
+  PVOID pvReserved;
+  HRESULT (STDMETHODCALLTYPE* pfnDeferredFillIn)(EXCEPINFO*);
+  SCODE scode;
+};
+
+struct IDispatch : IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE GetTypeInfoCount(UINT*) = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetTypeInfo(UINT, LCID, ITypeInfo**) = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetIDsOfNames(REFIID, LPOLESTR*, UINT,
+    LCID, DISPID*) = 0;
+  virtual HRESULT STDMETHODCALLTYPE Invoke(DISPID, REFIID, LCID, WORD,
+    DISPPARAMS*, VARIANT*, EXCEPINFO*, UINT*) = 0;
+};
+
+// -----------------------------------------------------------------------------
+// Memory
+// -----------------------------------------------------------------------------
+
+inline LPVOID CoTaskMemAlloc(const SIZE_T size)
+{
+  return std::malloc(size ? size : 1);
+}
+
+inline LPVOID CoTaskMemRealloc(const LPVOID block, const SIZE_T size)
+{
+  return std::realloc(block, size ? size : 1);
+}
+
+inline void CoTaskMemFree(const LPVOID block)
+{
+  std::free(block);
+}
+
+inline HRESULT StringFromCLSID(REFCLSID id, LPOLESTR* const result)
+{
+  constexpr std::size_t size{39};
+  *result = static_cast<LPOLESTR>(CoTaskMemAlloc(size*sizeof(OLECHAR)));
+  if (!*result)
+    return E_OUTOFMEMORY;
+  char str[size];
+  std::snprintf(str, size,
+    "{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}",
+    id.Data1, id.Data2, id.Data3, id.Data4[0], id.Data4[1], id.Data4[2],
+    id.Data4[3], id.Data4[4], id.Data4[5], id.Data4[6], id.Data4[7]);
+  std::copy_n(str, size, *result);
+  return S_OK;
+}
+
+// -----------------------------------------------------------------------------
+// BSTR
+// -----------------------------------------------------------------------------
+
+inline BSTR SysAllocStringLen(const OLECHAR* const data, const UINT size)
+{
+  if (size > (std::numeric_limits<UINT>::max() - sizeof(OLECHAR)) /
+    sizeof(OLECHAR))
+    return nullptr;
+
+  const UINT byte_size{static_cast<UINT>(size*sizeof(OLECHAR))};
+  auto* const block = static_cast<BYTE*>(std::malloc(sizeof(UINT) +
+    byte_size + sizeof(OLECHAR)));
+  if (!block)
+    return nullptr;
+
+  std::memcpy(block, &byte_size, sizeof(byte_size));
+  const auto result = reinterpret_cast<BSTR>(block + sizeof(UINT));
+  if (data)
+    std::memcpy(result, data, byte_size);
+  result[size] = 0;
+  return result;
+}
+
+inline BSTR SysAllocString(const OLECHAR* const data)
+{
+  return data ? SysAllocStringLen(data,
+    static_cast<UINT>(std::char_traits<OLECHAR>::length(data))) : nullptr;
+}
+
+inline void SysFreeString(const BSTR bstr)
+{
+  if (bstr)
+    std::free(reinterpret_cast<BYTE*>(bstr) - sizeof(UINT));
+}
+
+inline UINT SysStringByteLen(const BSTR bstr)
+{
+  UINT result{};
+  if (bstr)
+    std::memcpy(&result, reinterpret_cast<BYTE*>(bstr) - sizeof(UINT),
+      sizeof(result));
+  return result;
+}
+
+inline UINT SysStringLen(const BSTR bstr)
+{
+  return SysStringByteLen(bstr) / sizeof(OLECHAR);
+}
+
+// -----------------------------------------------------------------------------
+// SAFEARRAY
+// -----------------------------------------------------------------------------
+
+inline HRESULT VariantInit(VARIANTARG*);
+inline HRESULT VariantClear(VARIANTARG*);
+inline HRESULT VariantCopy(VARIANTARG*, const VARIANTARG*);
+
+namespace dmitigr::winbase::ole_model {
+
+/**
+ * The size of the hidden prefix of the SAFEARRAY descriptor. (As on Windows,
+ * the VARTYPE is stored in its last four bytes.)
+ */
+inline constexpr std::size_t descriptor_prefix_size{16};
+
+/// @returns The size of the element of SAFEARRAY of `vt`, or `0`.
+constexpr ULONG element_size(const VARTYPE vt) noexcept
+{
+  switch (vt) {
+  case VT_I1: case VT_UI1:
+    return 1;
+  case VT_I2: case VT_UI2: case VT_BOOL:
+    return 2;
+  case VT_I4: case VT_UI4: case VT_INT: case VT_UINT: case VT_R4:
+  case VT_ERROR:
+    return 4;
+  case VT_I8: case VT_UI8: case VT_R8: case VT_CY: case VT_DATE:
+    return 8;
+  case VT_DECIMAL:
+    return sizeof(DECIMAL);
+  case VT_BSTR:
+    return sizeof(BSTR);
+  case VT_UNKNOWN: case VT_DISPATCH:
+    return sizeof(IUnknown*);
+  case VT_VARIANT:
+    return sizeof(VARIANT);
+  default:
+    return 0;
+  }
+}
+
+/// @returns The features of SAFEARRAY of `vt`.
+constexpr USHORT features(const VARTYPE vt) noexcept
+{
+  switch (vt) {
+  case VT_BSTR:
+    return FADF_HAVEVARTYPE | FADF_BSTR;
+  case VT_UNKNOWN:
+    return FADF_HAVEVARTYPE | FADF_UNKNOWN;
+  case VT_DISPATCH:
+    return FADF_HAVEVARTYPE | FADF_DISPATCH;
+  case VT_VARIANT:
+    return FADF_HAVEVARTYPE | FADF_VARIANT;
+  default:
+    return FADF_HAVEVARTYPE;
+  }
+}
+
+inline BYTE* descriptor_block(SAFEARRAY* const array) noexcept
+{
+  return reinterpret_cast<BYTE*>(array) - descriptor_prefix_size;
+}
+
+inline VARTYPE vartype(SAFEARRAY* const array) noexcept
+{
+  VARTYPE result{};
+  std::memcpy(&result, reinterpret_cast<BYTE*>(array) - 4, sizeof(result));
+  return result;
+}
+
+/// @returns The number of elements of `array`, or `0` on overflow.
+inline std::size_t element_count(const SAFEARRAY* const array) noexcept
+{
+  std::size_t result{1};
+  for (USHORT d{}; d < array->cDims; ++d) {
+    const std::size_t count{array->rgsabound[d].cElements};
+    if (count && result > std::numeric_limits<std::size_t>::max() / count)
+      return 0;
+    result *= count;
+  }
+  return result;
+}
+
+/// Releases the resources of elements of `array`.
+inline void clear_elements(SAFEARRAY* const array) noexcept
+{
+  const auto count = element_count(array);
+  if (array->fFeatures & FADF_BSTR) {
+    for (std::size_t i{}; i < count; ++i)
+      SysFreeString(static_cast<BSTR*>(array->pvData)[i]);
+  } else if (array->fFeatures & FADF_VARIANT) {
+    for (std::size_t i{}; i < count; ++i)
+      VariantClear(static_cast<VARIANT*>(array->pvData) + i);
+  } else if (array->fFeatures & (FADF_UNKNOWN | FADF_DISPATCH)) {
+    for (std::size_t i{}; i < count; ++i) {
+      if (const auto unknown = static_cast<IUnknown**>(array->pvData)[i])
+        unknown->Release();
+    }
+  }
+}
+
+} // namespace dmitigr::winbase::ole_model
+
+inline HRESULT SafeArrayAllocDescriptorEx(const VARTYPE vt, const UINT dims,
+  SAFEARRAY** const result)
+{
+  namespace model = dmitigr::winbase::ole_model;
+  if (!result || !dims || dims > 0xFFFF)
+    return E_INVALIDARG;
+
+  auto* const block = static_cast<BYTE*>(std::calloc(1,
+    model::descriptor_prefix_size + sizeof(SAFEARRAY) +
+    (dims - 1)*sizeof(SAFEARRAYBOUND)));
+  if (!block)
+    return E_OUTOFMEMORY;
+
+  std::memcpy(block + model::descriptor_prefix_size - 4, &vt, sizeof(vt));
+  auto* const array = reinterpret_cast<SAFEARRAY*>(block +
+    model::descriptor_prefix_size);
+  array->cDims = static_cast<USHORT>(dims);
+  array->fFeatures = model::features(vt);
+  array->cbElements = model::element_size(vt);
+  *result = array;
+  return S_OK;
+}
+
+inline HRESULT SafeArrayDestroyDescriptor(SAFEARRAY* const array)
+{
+  if (!array)
+    return S_OK;
+  else if (array->cLocks)
+    return DISP_E_ARRAYISLOCKED;
+  std::free(dmitigr::winbase::ole_model::descriptor_block(array));
+  return S_OK;
+}
+
+inline SAFEARRAY* SafeArrayCreate(const VARTYPE vt, const UINT dims,
+  SAFEARRAYBOUND* const bounds)
+{
+  namespace model = dmitigr::winbase::ole_model;
+  if (!model::element_size(vt) || !bounds)
+    return nullptr;
+
+  SAFEARRAY* result{};
+  if (FAILED(SafeArrayAllocDescriptorEx(vt, dims, &result)))
+    return nullptr;
+
+  // The bounds are stored in the reverse order.
+  for (UINT d{}; d < dims; ++d)
+    result->rgsabound[d] = bounds[dims - 1 - d];
+
+  const auto count = model::element_count(result);
+  bool is_empty{};
+  for (UINT d{}; d < dims; ++d)
+    is_empty |= !bounds[d].cElements;
+  if (!count && !is_empty) {
+    SafeArrayDestroyDescriptor(result);
+    return nullptr;
+  }
+
+  result->pvData = std::calloc(std::max<std::size_t>(count, 1),
+    result->cbElements);
+  if (!result->pvData) {
+    SafeArrayDestroyDescriptor(result);
+    return nullptr;
+  }
+  return result;
+}
+
+inline HRESULT SafeArrayDestroy(SAFEARRAY* const array)
+{
+  if (!array)
+    return S_OK;
+  else if (array->cLocks)
+    return DISP_E_ARRAYISLOCKED;
+
+  if (array->pvData &&
+    !(array->fFeatures & (FADF_AUTO | FADF_STATIC | FADF_EMBEDDED))) {
+    dmitigr::winbase::ole_model::clear_elements(array);
+    std::free(array->pvData);
+  }
+  array->pvData = nullptr;
+  return SafeArrayDestroyDescriptor(array);
+}
+
+inline HRESULT SafeArrayLock(SAFEARRAY* const array)
+{
+  if (!array)
+    return E_INVALIDARG;
+  ++array->cLocks;
+  return S_OK;
+}
+
+inline HRESULT SafeArrayUnlock(SAFEARRAY* const array)
+{
+  if (!array)
+    return E_INVALIDARG;
+  else if (!array->cLocks)
+    return E_UNEXPECTED;
+  --array->cLocks;
+  return S_OK;
+}
+
+inline HRESULT SafeArrayGetVartype(SAFEARRAY* const array, VARTYPE* const vt)
+{
+  if (!array || !vt)
+    return E_INVALIDARG;
+  else if (array->fFeatures & FADF_HAVEVARTYPE)
+    *vt = dmitigr::winbase::ole_model::vartype(array);
+  else if (array->fFeatures & FADF_BSTR)
+    *vt = VT_BSTR;
+  else if (array->fFeatures & FADF_VARIANT)
+    *vt = VT_VARIANT;
+  else if (array->fFeatures & FADF_UNKNOWN)
+    *vt = VT_UNKNOWN;
+  else if (array->fFeatures & FADF_DISPATCH)
+    *vt = VT_DISPATCH;
+  else
+    return E_INVALIDARG;
+  return S_OK;
+}
+
+inline HRESULT SafeArrayPtrOfIndex(SAFEARRAY* const array, LONG* const indices,
+  void** const result)
+{
+  if (!array || !indices || !result)
+    return E_INVALIDARG;
+
+  // The indices are in the order of dimensions, the bounds are in the reverse
+  // order, and the first dimension varies fastest.
+  std::size_t offset{};
+  std::size_t stride{1};
+  for (USHORT d{}; d < array->cDims; ++d) {
+    const auto& bound = array->rgsabound[array->cDims - 1 - d];
+    const auto index = LONGLONG{indices[d]} - bound.lLbound;
+    if (index < 0 || index >= LONGLONG{bound.cElements})
+      return DISP_E_BADINDEX;
+    offset += static_cast<std::size_t>(index)*stride;
+    stride *= bound.cElements;
+  }
+  *result = static_cast<BYTE*>(array->pvData) + offset*array->cbElements;
+  return S_OK;
+}
+
+inline HRESULT SafeArrayGetElement(SAFEARRAY* const array, LONG* const indices,
+  void* const result)
+{
+  void* element{};
+  if (const HRESULT err{SafeArrayPtrOfIndex(array, indices, &element)};
+    FAILED(err))
+    return err;
+  else if (!result)
+    return E_INVALIDARG;
+
+  if (array->fFeatures & FADF_BSTR) {
+    const auto bstr = *static_cast<BSTR*>(element);
+    BSTR copy{};
+    if (bstr && !(copy = SysAllocStringLen(bstr, SysStringLen(bstr))))
+      return E_OUTOFMEMORY;
+    *static_cast<BSTR*>(result) = copy;
+  } else if (array->fFeatures & FADF_VARIANT) {
+    VariantInit(static_cast<VARIANT*>(result));
+    return VariantCopy(static_cast<VARIANT*>(result),
+      static_cast<VARIANT*>(element));
+  } else {
+    std::memcpy(result, element, array->cbElements);
+    if (array->fFeatures & (FADF_UNKNOWN | FADF_DISPATCH)) {
+      if (const auto unknown = *static_cast<IUnknown**>(result))
+        unknown->AddRef();
+    }
+  }
+  return S_OK;
+}
+
+inline HRESULT SafeArrayCopy(SAFEARRAY* const array, SAFEARRAY** const result)
+{
+  namespace model = dmitigr::winbase::ole_model;
+  if (!result)
+    return E_INVALIDARG;
+  *result = nullptr;
+  if (!array)
+    return S_OK;
+
+  SAFEARRAY* copy{};
+  if (const HRESULT err{SafeArrayAllocDescriptorEx(model::vartype(array),
+      array->cDims, &copy)}; FAILED(err))
+    return err;
+  copy->fFeatures = array->fFeatures &
+    ~(FADF_AUTO | FADF_STATIC | FADF_EMBEDDED | FADF_FIXEDSIZE);
+  copy->cbElements = array->cbElements;
+  std::copy_n(array->rgsabound, array->cDims, copy->rgsabound);
+
+  const auto count = model::element_count(array);
+  copy->pvData = std::calloc(std::max<std::size_t>(count, 1),
+    copy->cbElements);
+  if (!copy->pvData) {
+    SafeArrayDestroyDescriptor(copy);
+    return E_OUTOFMEMORY;
+  }
+
+  if (array->fFeatures & FADF_BSTR) {
+    const auto from = static_cast<BSTR*>(array->pvData);
+    const auto to = static_cast<BSTR*>(copy->pvData);
+    for (std::size_t i{}; i < count; ++i) {
+      if (from[i] && !(to[i] = SysAllocStringLen(from[i],
+            SysStringLen(from[i])))) {
+        SafeArrayDestroy(copy);
+        return E_OUTOFMEMORY;
+      }
+    }
+  } else if (array->fFeatures & FADF_VARIANT) {
+    const auto from = static_cast<VARIANT*>(array->pvData);
+    const auto to = static_cast<VARIANT*>(copy->pvData);
+    for (std::size_t i{}; i < count; ++i) {
+      if (const HRESULT err{VariantCopy(to + i, from + i)}; FAILED(err)) {
+        SafeArrayDestroy(copy);
+        return err;
+      }
+    }
+  } else {
+    std::memcpy(copy->pvData, array->pvData, count*copy->cbElements);
+    if (array->fFeatures & (FADF_UNKNOWN | FADF_DISPATCH)) {
+      for (std::size_t i{}; i < count; ++i) {
+        if (const auto unknown = static_cast<IUnknown**>(copy->pvData)[i])
+          unknown->AddRef();
+      }
+    }
+  }
+  *result = copy;
+  return S_OK;
+}
+
+// -----------------------------------------------------------------------------
+// VARIANT
+// -----------------------------------------------------------------------------
+
+inline HRESULT VariantInit(VARIANTARG* const value)
+{
+  value->vt = VT_EMPTY;
+  value->wReserved1 = value->wReserved2 = value->wReserved3 = 0;
+  return S_OK;
+}
+
+inline HRESULT VariantClear(VARIANTARG* const value)
+{
+  const VARTYPE vt{value->vt};
+  if (!(vt & VT_BYREF)) {
+    if (vt & VT_ARRAY) {
+      if (const HRESULT err{SafeArrayDestroy(value->parray)}; FAILED(err))
+        return err;
+    } else if (vt == VT_BSTR)
+      SysFreeString(value->bstrVal);
+    else if ((vt == VT_UNKNOWN || vt == VT_DISPATCH) && value->punkVal)
+      value->punkVal->Release();
+  }
+  VariantInit(value);
+  return S_OK;
+}
+
+inline HRESULT VariantCopy(VARIANTARG* const result,
+  const VARIANTARG* const value)
+{
+  if (result == value)
+    return S_OK;
+
+  VARIANT copy{*value};
+  const VARTYPE vt{value->vt};
+  if (!(vt & VT_BYREF)) {
+    if (vt & VT_ARRAY) {
+      if (const HRESULT err{SafeArrayCopy(value->parray, &copy.parray)};
+        FAILED(err))
+        return err;
+    } else if (vt == VT_BSTR && value->bstrVal) {
+      copy.bstrVal = SysAllocStringLen(value->bstrVal,
+        SysStringLen(value->bstrVal));
+      if (!copy.bstrVal)
+        return E_OUTOFMEMORY;
+    } else if ((vt == VT_UNKNOWN || vt == VT_DISPATCH) && value->punkVal)
+      value->punkVal->AddRef();
+  }
+  VariantClear(result);
+  *result = copy;
+  return S_OK;
+}
+
+inline HRESULT VariantCopyInd(VARIANT* const result,
+  const VARIANTARG* const value)
+{
+  namespace model = dmitigr::winbase::ole_model;
+  const VARTYPE vt{value->vt};
+  if (!(vt & VT_BYREF))
+    return VariantCopy(result, value);
+  else if (!value->byref)
+    return E_INVALIDARG;
+
+  const VARTYPE base{static_cast<VARTYPE>(vt & ~VT_BYREF)};
+  VARIANT deref;
+  VariantInit(&deref);
+  if (base == VT_VARIANT)
+    deref = *value->pvarVal;
+  else if (base & VT_ARRAY)
+    deref.parray = *value->pparray;
+  else if (base == VT_BSTR)
+    deref.bstrVal = *value->pbstrVal;
+  else if (base == VT_DECIMAL)
+    deref.decVal = *value->pdecVal;
+  else if (base == VT_UNKNOWN || base == VT_DISPATCH)
+    deref.punkVal = *value->ppunkVal;
+  else if (const auto size = model::element_size(base))
+    std::memcpy(&deref.llVal, value->byref, size);
+  else
+    return DISP_E_BADVARTYPE;
+  if (base != VT_VARIANT)
+    deref.vt = base;
+  else if (deref.vt & VT_BYREF)
+    return E_INVALIDARG;
+
+  VARIANT copy;
+  VariantInit(&copy);
+  if (const HRESULT err{VariantCopy(&copy, &deref)}; FAILED(err))
+    return err;
+  VariantClear(result);
+  *result = copy;
+  return S_OK;
+}
+
+namespace dmitigr::winbase::ole_model {
+
+/// The numeric value of VARIANT.
+struct Number final {
+  enum Kind { signed_integer, unsigned_integer, real } kind{};
+  std::int64_t i{};
+  std::uint64_t u{};
+  double r{};
+};
+
+/// @returns The numeric value of `value`.
+inline HRESULT to_number(const VARIANT& value, Number& result)
+{
+  const auto sint = [&result](const std::int64_t i)
+  {
+    result.kind = Number::signed_integer;
+    result.i = i;
+    return S_OK;
+  };
+  const auto uint = [&result](const std::uint64_t u)
+  {
+    result.kind = Number::unsigned_integer;
+    result.u = u;
+    return S_OK;
+  };
+  const auto real = [&result](const double r)
+  {
+    result.kind = Number::real;
+    result.r = r;
+    return S_OK;
+  };
+
+  switch (value.vt) {
+  case VT_EMPTY: return sint(0);
+  case VT_I1: return sint(value.cVal);
+  case VT_I2: return sint(value.iVal);
+  case VT_I4: return sint(value.lVal);
+  case VT_INT: return sint(value.intVal);
+  case VT_I8: return sint(value.llVal);
+  case VT_UI1: return uint(value.bVal);
+  case VT_UI2: return uint(value.uiVal);
+  case VT_UI4: return uint(value.ulVal);
+  case VT_UINT: return uint(value.uintVal);
+  case VT_UI8: return uint(value.ullVal);
+  case VT_BOOL: return sint(value.boolVal ? -1 : 0);
+  case VT_R4: return real(value.fltVal);
+  case VT_R8: return real(value.dblVal);
+  case VT_DATE: return real(value.date);
+  case VT_CY: return real(static_cast<double>(value.cyVal.int64) / 10000);
+  case VT_DECIMAL: {
+    const auto& dec = value.decVal;
+    const double magnitude{(dec.Hi32*18446744073709551616.0 + dec.Lo64) /
+      std::pow(10., dec.scale)};
+    return real(dec.sign & DECIMAL_NEG ? -magnitude : magnitude);
+  }
+  case VT_BSTR: {
+    const std::u16string_view str{value.bstrVal, SysStringLen(value.bstrVal)};
+    if (str == u"True" || str == u"true")
+      return sint(-1);
+    else if (str == u"False" || str == u"false")
+      return sint(0);
+    else if (str.empty() || std::any_of(str.begin(), str.end(),
+        [](const char16_t ch){return ch >= 0x80;}))
+      return DISP_E_TYPEMISMATCH;
+    const std::string copy(str.begin(), str.end());
+    char* end{};
+    errno = 0;
+    if (const auto i = std::strtoll(copy.c_str(), &end, 10); !*end && !errno)
+      return sint(i);
+    errno = 0;
+    if (const auto r = std::strtod(copy.c_str(), &end); !*end && !errno)
+      return real(r);
+    return DISP_E_TYPEMISMATCH;
+  }
+  default:
+    return DISP_E_TYPEMISMATCH;
+  }
+}
+
+/// Converts `number` to the integer `result` rounding half to even.
+template<typename T>
+HRESULT to_integer(const Number& number, T& result)
+{
+  switch (number.kind) {
+  case Number::signed_integer:
+    if (!std::in_range<T>(number.i))
+      return DISP_E_OVERFLOW;
+    result = static_cast<T>(number.i);
+    return S_OK;
+  case Number::unsigned_integer:
+    if (!std::in_range<T>(number.u))
+      return DISP_E_OVERFLOW;
+    result = static_cast<T>(number.u);
+    return S_OK;
+  case Number::real: {
+    const double rounded{std::nearbyint(number.r)};
+    if (!(rounded >= static_cast<double>(std::numeric_limits<T>::min()) &&
+        rounded < std::ldexp(1., std::numeric_limits<T>::digits)))
+      return DISP_E_OVERFLOW; // NaN too
+    result = static_cast<T>(rounded);
+    return S_OK;
+  }
+  }
+  return E_UNEXPECTED;
+}
+
+inline double to_real(const Number& number) noexcept
+{
+  switch (number.kind) {
+  case Number::signed_integer: return static_cast<double>(number.i);
+  case Number::unsigned_integer: return static_cast<double>(number.u);
+  case Number::real: return number.r;
+  }
+  return 0;
+}
+
+/// @returns The string representation of `number`.
+inline std::u16string to_u16string(const Number& number, const VARTYPE vt)
+{
+  std::string str;
+  switch (number.kind) {
+  case Number::signed_integer: str = std::to_string(number.i); break;
+  case Number::unsigned_integer: str = std::to_string(number.u); break;
+  case Number::real: {
+    char buf[32];
+    const int size{std::snprintf(buf, sizeof(buf),
+      vt == VT_R4 ? "%.7G" : "%.15G", number.r)};
+    str.assign(buf, size > 0 ? size : 0);
+    break;
+  }
+  }
+  return std::u16string(str.begin(), str.end());
+}
+
+/**
+ * @brief Converts `value` to `result` of `vt`.
+ *
+ * @par Requires
+ * `value` must not be by reference, `result` must be empty.
+ */
+inline HRESULT change_type(VARIANT& result, const VARIANT& value,
+  const USHORT flags, const VARTYPE vt)
+{
+  if (value.vt == vt)
+    return VariantCopy(&result, &value);
+
+  Number number;
+  if (const HRESULT err{to_number(value, number)}; FAILED(err))
+    return err;
+
+  HRESULT err{S_OK};
+  switch (vt) {
+  case VT_I1: {
+    signed char value{};
+    err = to_integer(number, value);
+    result.cVal = static_cast<CHAR>(value);
+    break;
+  }
+  case VT_I2: err = to_integer(number, result.iVal); break;
+  case VT_I4: err = to_integer(number, result.lVal); break;
+  case VT_INT: err = to_integer(number, result.intVal); break;
+  case VT_I8: err = to_integer(number, result.llVal); break;
+  case VT_UI1: err = to_integer(number, result.bVal); break;
+  case VT_UI2: err = to_integer(number, result.uiVal); break;
+  case VT_UI4: err = to_integer(number, result.ulVal); break;
+  case VT_UINT: err = to_integer(number, result.uintVal); break;
+  case VT_UI8: err = to_integer(number, result.ullVal); break;
+  case VT_R4: result.fltVal = static_cast<float>(to_real(number)); break;
+  case VT_R8: result.dblVal = to_real(number); break;
+  case VT_DATE: result.date = to_real(number); break;
+  case VT_BOOL:
+    result.boolVal = to_real(number) != 0 ? VARIANT_TRUE : VARIANT_FALSE;
+    break;
+  case VT_CY:
+    err = to_integer(Number{Number::real, 0, 0, to_real(number)*10000},
+      result.cyVal.int64);
+    break;
+  case VT_DECIMAL: {
+    if (number.kind == Number::real)
+      return DISP_E_TYPEMISMATCH;
+    DECIMAL dec{};
+    const bool is_negative{number.kind == Number::signed_integer &&
+      number.i < 0};
+    dec.Lo64 = number.kind == Number::unsigned_integer ? number.u :
+      is_negative ? 0 - static_cast<std::uint64_t>(number.i) :
+      static_cast<std::uint64_t>(number.i);
+    dec.sign = is_negative ? DECIMAL_NEG : 0;
+    result.decVal = dec;
+    break;
+  }
+  case VT_BSTR: {
+    const std::u16string str{value.vt == VT_BOOL && (flags & VARIANT_ALPHABOOL)
+      ? std::u16string{value.boolVal ? u"True" : u"False"}
+      : to_u16string(number, value.vt)};
+    result.bstrVal = SysAllocStringLen(str.data(),
+      static_cast<UINT>(str.size()));
+    if (!result.bstrVal)
+      return E_OUTOFMEMORY;
+    break;
+  }
+  default:
+    return DISP_E_TYPEMISMATCH;
+  }
+  if (SUCCEEDED(err))
+    result.vt = vt;
+  return err;
+}
+
+} // namespace dmitigr::winbase::ole_model
+
+inline HRESULT VariantChangeType(VARIANTARG* const result,
+  const VARIANTARG* const value, const USHORT flags, const VARTYPE vt)
+{
+  VARIANT deref;
+  VariantInit(&deref);
+  if (const HRESULT err{VariantCopyInd(&deref, value)}; FAILED(err))
+    return err;
+
+  VARIANT converted;
+  VariantInit(&converted);
+  const HRESULT err{dmitigr::winbase::ole_model::change_type(converted, deref,
+    flags, vt)};
+  VariantClear(&deref);
+  if (FAILED(err))
+    return err;
+  VariantClear(result);
+  *result = converted;
+  return S_OK;
+}
+
+// -----------------------------------------------------------------------------
+// Strings
+// -----------------------------------------------------------------------------
+
+/// Converts UTF-8 to UTF-16.
+inline int MultiByteToWideChar(UINT, const DWORD flags, const LPCSTR str,
+  const int size, const LPWSTR result, const int capacity)
+{
+  const std::size_t length{size < 0 ? std::strlen(str) + 1 :
+    static_cast<std::size_t>(size)};
+  const auto* const bytes = reinterpret_cast<const unsigned char*>(str);
+  int count{};
+  const auto put = [&](const char32_t code)
+  {
+    if (code > 0xFFFF) {
+      if (result && count + 2 > capacity)
+        return false;
+      if (result) {
+        result[count] = static_cast<WCHAR>(0xD800 + ((code - 0x10000) >> 10));
+        result[count + 1] = static_cast<WCHAR>(0xDC00 + (code & 0x3FF));
+      }
+      count += 2;
+      return true;
+    }
+    if (result && count + 1 > capacity)
+      return false;
+    if (result)
+      result[count] = static_cast<WCHAR>(code);
+    ++count;
+    return true;
+  };
+
+  for (std::size_t i{}; i < length;) {
+    const unsigned char lead{bytes[i]};
+    const std::size_t n{lead < 0x80 ? 1u : (lead >> 5) == 0x6 ? 2u :
+      (lead >> 4) == 0xE ? 3u : (lead >> 3) == 0x1E ? 4u : 0u};
+    char32_t code{n == 1 ? lead : n == 2 ? lead & 0x1Fu : n == 3 ?
+      lead & 0x0Fu : lead & 0x07u};
+    bool is_valid{n && i + n <= length};
+    for (std::size_t j{1}; is_valid && j < n; ++j) {
+      is_valid = (bytes[i + j] & 0xC0) == 0x80;
+      code = code << 6 | (bytes[i + j] & 0x3F);
+    }
+    is_valid = is_valid && code <= 0x10FFFF &&
+      !(0xD800 <= code && code <= 0xDFFF);
+    if (!is_valid) {
+      if (flags & MB_ERR_INVALID_CHARS)
+        return 0;
+      code = 0xFFFD;
+    }
+    if (!put(code))
+      return 0;
+    i += is_valid ? n : 1;
+  }
+  return count;
+}
+
+/// Converts UTF-16 to UTF-8.
+inline int WideCharToMultiByte(UINT, DWORD, const LPCWSTR str, const int size,
+  const LPSTR result, const int capacity, LPCSTR, BOOL*)
+{
+  const std::size_t length{size < 0 ? std::char_traits<WCHAR>::length(str) + 1 :
+    static_cast<std::size_t>(size)};
+  int count{};
+  for (std::size_t i{}; i < length; ++i) {
+    char32_t code{static_cast<char32_t>(str[i])};
+    if (0xD800 <= code && code <= 0xDBFF && i + 1 < length &&
+      0xDC00 <= static_cast<char32_t>(str[i + 1]) &&
+      static_cast<char32_t>(str[i + 1]) <= 0xDFFF)
+      code = 0x10000 + ((code - 0xD800) << 10) + (str[++i] - 0xDC00);
+    else if (0xD800 <= code && code <= 0xDFFF)
+      code = 0xFFFD;
+
+    char buf[4];
+    int n{};
+    if (code < 0x80)
+      buf[n++] = static_cast<char>(code);
+    else if (code < 0x800) {
+      buf[n++] = static_cast<char>(0xC0 | code >> 6);
+      buf[n++] = static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+      buf[n++] = static_cast<char>(0xE0 | code >> 12);
+      buf[n++] = static_cast<char>(0x80 | (code >> 6 & 0x3F));
+      buf[n++] = static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+      buf[n++] = static_cast<char>(0xF0 | code >> 18);
+      buf[n++] = static_cast<char>(0x80 | (code >> 12 & 0x3F));
+      buf[n++] = static_cast<char>(0x80 | (code >> 6 & 0x3F));
+      buf[n++] = static_cast<char>(0x80 | (code & 0x3F));
+    }
+    if (result) {
+      if (count + n > capacity)
+        return 0;
+      std::memcpy(result + count, buf, n);
+    }
+    count += n;
+  }
+  return count;
+}
+
+inline DWORD CharUpperBuffW(const LPWSTR str, const DWORD size)
+{
+  for (DWORD i{}; i < size; ++i)
+    str[i] = static_cast<WCHAR>(std::towupper(str[i]));
+  return size;
+}
+
+inline DWORD CharLowerBuffW(const LPWSTR str, const DWORD size)
+{
+  for (DWORD i{}; i < size; ++i)
+    str[i] = static_cast<WCHAR>(std::towlower(str[i]));
+  return size;
+}
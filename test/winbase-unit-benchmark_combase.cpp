@@ -0,0 +1,211 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// The microbenchmarks of the hot paths of combase.hpp. On the platforms other
+// than Windows they're built against the portable OLE model (see ole_model/).
+// The optional argument scales the iteration counts.
+
+#include "../../base/assert.hpp"
+#include "../combase.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#define ASSERT DMITIGR_ASSERT
+
+namespace {
+
+/// Prevents the results of the benchmarked code from being optimized out.
+volatile std::uint64_t sink;
+
+/// The multiplier of iteration counts.
+std::size_t scale{1};
+
+/// Runs `f` `iterations*scale` times and prints the mean time per run.
+template<typename F>
+void bench(const std::string_view name, const std::size_t iterations, F&& f)
+{
+  using Clock = std::chrono::steady_clock;
+  const std::size_t count{iterations*scale};
+  f(); // warm-up
+  const auto start = Clock::now();
+  for (std::size_t i{}; i < count; ++i)
+    f();
+  const std::chrono::duration<double, std::nano> elapsed{Clock::now() - start};
+  std::cout << std::left << std::setw(40) << name << std::right
+            << std::setw(12) << std::fixed << std::setprecision(1)
+            << elapsed.count() / count << " ns/op" << std::endl;
+}
+
+} // namespace
+
+int main(const int argc, char* const argv[])
+{
+  try {
+    namespace com = dmitigr::winbase::com;
+    using com::Native_variant;
+    using com::Safe_array;
+    using com::Variant;
+
+    if (argc > 1)
+      scale = std::max(std::strtoul(argv[1], nullptr, 10), 1ul);
+
+    const std::string text(64, 'x');
+    const std::string utf8_text{"Привет, мир! Hello, world!"};
+
+    // Variant construction.
+    {
+      ASSERT(com::to<std::int32_t>(com::to_variant(Native_variant{42})) == 42);
+      bench("Variant from Native_variant (int)", 1'000'000, []
+      {
+        const auto v = com::to_variant(Native_variant{std::int32_t{42}});
+        sink = sink + v.data().lVal;
+      });
+      bench("Variant from Native_variant (string)", 200'000, [&text]
+      {
+        const auto v = com::to_variant(Native_variant{text});
+        sink = sink + v.data().bstrVal[0];
+      });
+    }
+
+    // Variant copy.
+    {
+      const auto number = com::to_variant(Native_variant{1.5});
+      const auto string = com::to_variant(Native_variant{text});
+      const com::Const_variant copy{string};
+      ASSERT(copy.data().bstrVal != string.data().bstrVal);
+      ASSERT(com::to_wstring(copy.data().bstrVal) ==
+        com::to_wstring(string.data().bstrVal));
+      bench("Variant copy (double)", 1'000'000, [&number]
+      {
+        const com::Const_variant v{number};
+        sink = sink + static_cast<std::uint64_t>(v.data().dblVal);
+      });
+      bench("Variant copy (string)", 200'000, [&string]
+      {
+        const com::Const_variant v{string};
+        sink = sink + v.data().bstrVal[0];
+      });
+    }
+
+    // Coercion.
+    {
+      const auto integer = com::to_variant(Native_variant{std::int32_t{-7}});
+      const auto string = com::to_variant(Native_variant{"12345.5"});
+      ASSERT(com::to<std::int64_t>(integer) == -7);
+      ASSERT(com::to<double>(string) == 12345.5);
+      ASSERT(com::to<std::string>(integer) == "-7");
+      bench("to<std::int64_t>(VT_I4)", 1'000'000, [&integer]
+      {
+        sink = sink + static_cast<std::uint64_t>(
+          com::to<std::int64_t>(integer));
+      });
+      bench("to<double>(VT_BSTR)", 200'000, [&string]
+      {
+        sink = sink + static_cast<std::uint64_t>(com::to<double>(string));
+      });
+      bench("to<std::string>(VT_I4)", 200'000, [&integer]
+      {
+        sink = sink + com::to<std::string>(integer).size();
+      });
+    }
+
+    // Slice iteration.
+    {
+      constexpr ULONG rows{100}, columns{100};
+      Safe_array array{VT_R8, {{.cElements = columns, .lLbound = 0},
+          {.cElements = rows, .lLbound = 0}}};
+      {
+        auto slice = array.slice();
+        for (std::size_t i{}; i < slice.slice_count(); ++i) {
+          for (auto& element : slice.slice(i).span<double>())
+            element = 1;
+        }
+      }
+      bench("Safe_array slice iteration (100x100)", 10'000, [&array]
+      {
+        const auto slice = std::as_const(array).slice();
+        double sum{};
+        for (std::size_t i{}; i < slice.slice_count(); ++i) {
+          for (const auto element : slice.slice(i).span<double>())
+            sum += element;
+        }
+        ASSERT(sum == rows*columns);
+        sink = sink + static_cast<std::uint64_t>(sum);
+      });
+    }
+
+    // BSTR conversion.
+    {
+      const auto string = com::to_variant(Native_variant{utf8_text});
+      const BSTR bstr{string.data().bstrVal};
+      ASSERT(com::to_string(bstr) == utf8_text);
+      bench("to_string(BSTR)", 500'000, [bstr]
+      {
+        sink = sink + com::to_string(bstr).size();
+      });
+      bench("to_wstring(BSTR)", 1'000'000, [bstr]
+      {
+        sink = sink + com::to_wstring(bstr).size();
+      });
+
+      const std::vector<std::string> strings(100, utf8_text);
+      const auto array = com::to_safe_array(strings);
+      ASSERT(com::to_vector<std::string>(array) == strings);
+      bench("to_vector<std::string>(100 BSTRs)", 10'000, [&array]
+      {
+        sink = sink + com::to_vector<std::string>(array).size();
+      });
+    }
+
+    // Safe_array creation.
+    {
+      const std::vector<std::int32_t> integers(1000, 7);
+      const std::vector<std::string> strings(100, text);
+      ASSERT(com::to_vector<std::int32_t>(com::to_safe_array(integers)) ==
+        integers);
+      bench("Safe_array of 1000 VT_I4", 100'000, []
+      {
+        const Safe_array array{VT_I4, {{.cElements = 1000, .lLbound = 0}}};
+        sink = sink + array.data().cbElements;
+      });
+      bench("to_safe_array(1000 int32)", 100'000, [&integers]
+      {
+        const auto array = com::to_safe_array(integers);
+        sink = sink + array.data().cbElements;
+      });
+      bench("to_safe_array(100 strings)", 10'000, [&strings]
+      {
+        const auto array = com::to_safe_array(strings);
+        sink = sink + array.data().cbElements;
+      });
+    }
+  } catch (const std::exception& e) {
+    std::clog << "error: " << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::clog << "unknown error" << std::endl;
+    return 2;
+  }
+}
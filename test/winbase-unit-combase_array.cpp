@@ -0,0 +1,202 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// The tests of the arrays and variants of combase. On the platforms other than
+// Windows they're built against the portable OLE model (see ole_model/).
+
+#include "../../base/assert.hpp"
+#include "../combase.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define ASSERT DMITIGR_ASSERT
+
+/// The number of calls of counting_change_type().
+int change_type_count;
+
+/// VariantChangeType() which counts the calls.
+HRESULT WINAPI counting_change_type(VARIANTARG* const result,
+  const VARIANTARG* const value, const USHORT flags, const VARTYPE vt)
+{
+  ++change_type_count;
+  return VariantChangeType(result, value, flags, vt);
+}
+
+int main()
+{
+  try {
+    namespace winbase = dmitigr::winbase;
+    namespace com = winbase::com;
+
+    // Typed access to elements of numeric array.
+    {
+      com::Safe_array nums{VT_R8,
+                           {{.cElements = 3, .lLbound = 0},
+                            {.cElements = 3, .lLbound = 0}}};
+      auto row = nums.slice().slice(1);
+      const auto elems = row.span<double>();
+      ASSERT(elems.size() == 3);
+      for (std::size_t i{}; i < elems.size(); ++i)
+        elems[i] = static_cast<double>(i);
+      double sum{};
+      for (const auto e : std::as_const(nums).slice().span<double>())
+        sum += e;
+      ASSERT(sum == 3);
+      try {
+        row.span<float>();
+        ASSERT(false);
+      } catch (const std::runtime_error&) {}
+    }
+
+    // Multi-dimensional view.
+    {
+      com::Safe_array arr{VT_I4,
+                          {{.cElements = 3, .lLbound = 1},
+                           {.cElements = 2, .lLbound = -1}}};
+      {
+        auto md = arr.md_view<std::int32_t, 2>();
+        ASSERT(md.extent(0) == 3 && md.lower_bound(0) == 1);
+        ASSERT(md.extent(1) == 2 && md.lower_bound(1) == -1);
+        ASSERT(arr.lock_count() == 1);
+        for (std::size_t j{}; j < md.extent(1); ++j) {
+          for (std::size_t i{}; i < md.extent(0); ++i)
+            md(i, j) = static_cast<std::int32_t>(i + 10*j);
+        }
+        ASSERT(md.at(3, 0) == 12);
+        try {
+          md.at(0, 0);
+          ASSERT(false);
+        } catch (const std::out_of_range&) {}
+      }
+      ASSERT(arr.lock_count() == 0);
+      LONG indices[]{3, 0};
+      std::int32_t element{};
+      ASSERT(SUCCEEDED(SafeArrayGetElement(arr.data_ptr(), indices, &element)));
+      ASSERT(element == 12);
+    }
+
+    // Borrowed elements.
+    {
+      std::vector<double> reals{1, 2, 3, 4, 5, 6};
+      {
+        const com::Borrowed_safe_array<double> arr{reals};
+        ASSERT(arr.data_ptr()->pvData == reals.data());
+        ASSERT(arr.view().vartype() == VT_R8);
+        ASSERT(arr.view().lock_count() == 1);
+        ASSERT(com::to_vector<double>(arr.view()) == reals);
+        ASSERT(FAILED(SafeArrayDestroy(arr.data_ptr())));
+      }
+      {
+        const com::Borrowed_safe_array<double> arr{std::span{reals},
+          {{.cElements = 3, .lLbound = 0}, {.cElements = 2, .lLbound = 0}}};
+        LONG indices[]{2, 1};
+        double element{};
+        ASSERT(SUCCEEDED(SafeArrayGetElement(arr.data_ptr(), indices, &element)));
+        ASSERT(element == 6);
+      }
+      ASSERT(reals[5] == 6);
+    }
+
+    // Pooled and arena-allocated BSTRs.
+    {
+      const std::vector<std::string> strs{"one", "two", "three"};
+      com::Bstr_pool pool;
+      for (int i{}; i < 2; ++i) {
+        const auto arr = com::to_safe_array(std::span{strs}, pool);
+        ASSERT(com::to_vector<std::string>(arr.view()) == strs);
+      }
+      ASSERT(pool.size() == strs.size());
+
+      com::Bstr_arena arena;
+      {
+        const auto arr = com::to_safe_array(std::span{strs}, arena);
+        ASSERT(com::to_vector<std::string>(arr.view()) == strs);
+      }
+      ASSERT(arena.block_count() == 1);
+    }
+
+    // Column of VARIANTs.
+    {
+      com::Safe_array col{VT_VARIANT, {{.cElements = 3, .lLbound = 0}}};
+      auto sli = col.slice();
+      const auto vars = sli.array<VARIANT>();
+      for (std::size_t i{}; i < sli.size(); ++i) {
+        vars[i].vt = VT_I4;
+        vars[i].lVal = static_cast<LONG>(i);
+      }
+
+      // The column of the target type is copied without coercion.
+      auto ints = com::to_column<std::int32_t>(sli, 0, counting_change_type);
+      ASSERT((ints == std::vector<std::int32_t>{0, 1, 2}));
+      ASSERT(!change_type_count);
+
+      // Only the mismatching elements are coerced.
+      vars[0].vt = VT_I2;
+      vars[0].iVal = 5;
+      vars[2].vt = VT_R8;
+      vars[2].dblVal = 7;
+      com::to_column(sli, ints, 0, counting_change_type);
+      ASSERT((ints == std::vector<std::int32_t>{5, 1, 7}));
+      ASSERT(change_type_count == 2);
+      ASSERT((com::to_column<std::int32_t>(sli) == ints));
+
+      vars[1].vt = VT_ERROR;
+      try {
+        com::to_column<std::int32_t>(sli, 0, counting_change_type);
+        ASSERT(false);
+      } catch (const std::runtime_error&) {}
+    }
+
+    // Visitation.
+    {
+      const auto kind = [](const com::Const_variant_view& var)
+      {
+        return com::visit(var, com::Overloaded{
+          [](com::Empty){return 0;},
+          [](const std::int32_t){return 1;},
+          [](const winbase::Wstring_view){return 2;},
+          [](const com::Const_safe_array_view){return 3;},
+          [](const auto&){return 4;}});
+      };
+      com::Safe_array arr{VT_VARIANT, {{.cElements = 2, .lLbound = 0}}};
+      VARIANT var;
+      VariantInit(&var);
+      ASSERT(kind(com::Const_variant_view{var}) == 0);
+      var.vt = VT_INT;
+      ASSERT(kind(com::Const_variant_view{var}) == 1);
+      var.vt = VT_ARRAY | VT_VARIANT;
+      var.parray = arr.data_ptr();
+      ASSERT(kind(com::Const_variant_view{var}) == 3);
+      var.vt = VT_ERROR;
+      ASSERT(kind(com::Const_variant_view{var}) == 4);
+
+      const auto str = com::to_variant(com::Native_variant{"abc"});
+      ASSERT(kind(com::Const_variant_view{str.data()}) == 2);
+    }
+  } catch (const std::exception& e) {
+    std::clog << "error: " << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::clog << "unknown error" << std::endl;
+    return 2;
+  }
+}
@@ -0,0 +1,212 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// The tests of the binary codec of VARIANT. On the platforms other than
+// Windows they're built against the portable OLE model (see ole_model/).
+
+#include "../../base/assert.hpp"
+#include "../combase.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define ASSERT DMITIGR_ASSERT
+
+int main()
+{
+  try {
+    namespace com = dmitigr::winbase::com;
+    using com::Native_variant;
+
+    // Writer and reader.
+    {
+      com::Binary_writer writer;
+      writer.write_type(VT_I4);
+      const std::int32_t value{42};
+      writer.write_fixed(&value, sizeof(value));
+      writer.write_string(u"abc", 3);
+      writer.write_null_string();
+      const com::Binary_bound bounds[]{{2, 1}, {3, 0}};
+      writer.write_bounds(bounds);
+      const std::string bytes{writer.release()};
+      ASSERT(writer.bytes().size() == 4);
+
+      com::Binary_reader reader{bytes};
+      ASSERT(reader.read_type() == VT_I4);
+      std::int32_t value2{};
+      std::memcpy(&value2, reader.read_fixed(sizeof(value2)).data(),
+        sizeof(value2));
+      ASSERT(value2 == value);
+      ASSERT(reader.read_string() == std::u16string_view{u"abc"});
+      ASSERT(!reader.read_string());
+      const auto bounds2 = reader.read_bounds();
+      ASSERT(bounds2.size() == 2);
+      ASSERT(bounds2[0].count == 2 && bounds2[0].lower_bound == 1);
+      ASSERT(bounds2[1].count == 3 && bounds2[1].lower_bound == 0);
+      ASSERT(reader.is_end());
+
+      try {
+        alignas(8) const char header[]{'D', 'M', 'V', '\x7f'};
+        com::Binary_reader invalid{std::string_view{header, sizeof(header)}};
+        ASSERT(false);
+      } catch (const std::runtime_error&) {}
+
+      // The string must be terminated by zero.
+      writer.write_string(u"abc", 3);
+      std::string unterminated{writer.release()};
+      ASSERT(unterminated.ends_with(std::string(sizeof(char16_t), '\0')));
+      unterminated[unterminated.size() - 1] = 'x';
+      try {
+        com::Binary_reader reader{unterminated};
+        reader.read_string();
+        ASSERT(false);
+      } catch (const std::runtime_error&) {}
+    }
+
+    // Scalars and strings.
+    {
+      const Native_variant values[]{{}, std::int8_t{-8}, std::uint16_t{16},
+        42, std::int64_t{-64}, 2.5, 1.5f, true, com::Date{45000.5}, "short",
+        "Привет, мир!", std::string(100, 'x')};
+      com::Binary_writer writer;
+      for (const auto& value : values)
+        com::encode(writer, com::to_variant(value));
+
+      com::Variant currency;
+      currency.data().cyVal.int64 = -123456;
+      currency.data().vt = VT_CY;
+      com::encode(writer, currency);
+
+      com::Variant decimal;
+      decimal.data().decVal.Lo64 = 12345;
+      decimal.data().decVal.scale = 2;
+      decimal.data().decVal.sign = DECIMAL_NEG;
+      decimal.data().vt = VT_DECIMAL;
+      com::encode(writer, decimal);
+
+      com::Variant null_string;
+      null_string.data().vt = VT_BSTR;
+      com::encode(writer, null_string);
+      const std::string bytes{writer.release()};
+
+      com::Binary_reader reader{bytes};
+      for (const auto& value : values)
+        ASSERT(com::to_native_variant(com::decode_variant(reader)) == value);
+      ASSERT(com::decode_variant(reader).as_currency() ==
+        currency.as_currency());
+      ASSERT(com::decode_variant(reader).as_decimal() ==
+        decimal.as_decimal());
+      ASSERT(!com::decode_variant(reader).data().bstrVal);
+      ASSERT(reader.is_end());
+
+      com::Binary_reader view_reader{bytes};
+      for (const auto& value : values) {
+        const com::Binary_variant_view view{view_reader};
+        ASSERT(com::to_native_variant(view.value()) == value);
+      }
+      ASSERT(com::Binary_variant_view{view_reader}.value().as_currency() ==
+        currency.as_currency());
+      ASSERT(com::Binary_variant_view{view_reader}.value().as_decimal() ==
+        decimal.as_decimal());
+      {
+        const com::Binary_variant_view view{view_reader};
+        const auto value = view.value();
+        ASSERT(value.data().vt == VT_BSTR && !value.data().bstrVal);
+      }
+      ASSERT(view_reader.is_end());
+
+      com::Binary_reader truncated{std::string_view{bytes}.substr(0,
+          bytes.size() - 1)};
+      try {
+        while (true)
+          com::decode_variant(truncated);
+      } catch (const std::runtime_error&) {}
+
+      // The copying decoders accept the buffer at any address.
+      const std::string shifted{'\0' + bytes};
+      com::Binary_reader misaligned{std::string_view{shifted}.substr(1)};
+      ASSERT(!misaligned.is_aligned());
+      for (const auto& value : values)
+        ASSERT(com::to_native_variant(com::decode_variant(misaligned)) ==
+          value);
+      try {
+        const com::Binary_variant_view view{misaligned};
+        ASSERT(false);
+      } catch (const std::invalid_argument&) {}
+    }
+
+    // Arrays.
+    {
+      com::Safe_array reals{VT_R8, {{.cElements = 3, .lLbound = 1},
+          {.cElements = 2, .lLbound = 0}}};
+      {
+        auto md = reals.md_view<double, 2>();
+        md.at(3, 1) = 42;
+        md.at(1, 0) = -1;
+      }
+      const std::vector<std::string> strs{"a", "", "Привет"};
+      const auto strings = com::to_safe_array(strs);
+      com::Safe_array variants{VT_VARIANT, {{.cElements = 2, .lLbound = 0}}};
+      {
+        auto slice = variants.slice();
+        const auto elements = slice.array<VARIANT>();
+        elements[0].vt = VT_I4;
+        elements[0].lVal = 7;
+        ASSERT(SafeArrayCopy(const_cast<SAFEARRAY*>(strings.data_ptr()),
+          &elements[1].parray) == S_OK);
+        elements[1].vt = VT_ARRAY | VT_BSTR;
+      }
+
+      com::Binary_writer writer;
+      com::encode(writer, reals);
+      com::encode(writer, strings);
+      com::encode(writer, variants);
+      const std::string bytes{writer.release()};
+
+      // Decoding and encoding back must give the same bytes.
+      com::Binary_reader reader{bytes};
+      const auto reals2 = com::decode_safe_array(reader);
+      const auto strings2 = com::decode_safe_array(reader);
+      const auto variants2 = com::decode_safe_array(reader);
+      ASSERT(reader.is_end());
+      ASSERT(reals2.dimension_count() == 2);
+      ASSERT(com::to_vector<double>(reals2) == com::to_vector<double>(reals));
+      ASSERT(com::to_vector<std::string>(strings2) == strs);
+      ASSERT(variants2.slice().variant(0).as_int32() == 7);
+      com::encode(writer, reals2);
+      com::encode(writer, strings2);
+      com::encode(writer, variants2);
+      ASSERT(writer.release() == bytes);
+
+      com::Binary_reader view_reader{bytes};
+      for (int i{}; i < 3; ++i)
+        com::encode(writer, com::Binary_variant_view{view_reader}.value());
+      ASSERT(view_reader.is_end());
+      ASSERT(writer.release() == bytes);
+    }
+  } catch (const std::exception& e) {
+    std::clog << "error: " << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::clog << "unknown error" << std::endl;
+    return 2;
+  }
+}
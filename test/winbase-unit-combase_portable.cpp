@@ -0,0 +1,336 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// The tests of the headers of combase (and of memory.hpp) which don't depend
+// on the Windows SDK.
+
+#include "../../base/assert.hpp"
+#include "../combase_date.hpp"
+#include "../combase_decimal.hpp"
+#include "../combase_guid.hpp"
+#include "../combase_memory.hpp"
+#include "../memory.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <limits>
+#include <memory_resource>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#define ASSERT DMITIGR_ASSERT
+
+/// The string allocator of `std::malloc()` which counts the live strings.
+struct Counting_string_source final {
+  int* count{};
+
+  char16_t* allocate(const char16_t* const data, const std::size_t size)
+  {
+    auto* const block = static_cast<char*>(std::malloc(sizeof(std::uint32_t) +
+        (size + 1)*sizeof(char16_t)));
+    if (!block)
+      throw std::bad_alloc{};
+    auto* const result = reinterpret_cast<char16_t*>(block +
+      sizeof(std::uint32_t));
+    const auto bytes = static_cast<std::uint32_t>(size*sizeof(char16_t));
+    std::memcpy(block, &bytes, sizeof(bytes));
+    result[size] = 0;
+    if (data)
+      std::memcpy(result, data, size*sizeof(char16_t));
+    ++*count;
+    return result;
+  }
+
+  void deallocate(char16_t* const str) noexcept
+  {
+    if (str) {
+      std::free(reinterpret_cast<char*>(str) - sizeof(std::uint32_t));
+      --*count;
+    }
+  }
+};
+
+int main()
+{
+  try {
+    namespace winbase = dmitigr::winbase;
+    namespace com = winbase::com;
+
+    // String pool.
+    {
+      using Pool = com::Basic_string_pool<char16_t, Counting_string_source>;
+      int count{};
+      {
+        Pool pool{Counting_string_source{&count}, 1};
+        auto* const abc = pool.allocate(u"abc", 3);
+        ASSERT(std::u16string_view{abc} == u"abc");
+        ASSERT(com::detail::string_size(abc) == 3);
+        pool.deallocate(abc);
+        ASSERT(pool.size() == 1 && count == 1);
+
+        // The released string of the same size class is reused.
+        auto* const hello = pool.allocate(u"hello", 5);
+        ASSERT(hello == abc);
+        ASSERT(std::u16string_view{hello} == u"hello");
+        ASSERT(com::detail::string_size(hello) == 5);
+        ASSERT(!pool.size() && count == 1);
+
+        // The string of another size class is allocated.
+        auto* const empty = pool.allocate(nullptr, 9);
+        ASSERT(empty != hello && count == 2);
+
+        // The string is released if its size class is full.
+        pool.deallocate(hello);
+        auto* const x = pool.allocate(u"x", 1);
+        auto* const y = pool.allocate(u"y", 1);
+        ASSERT(count == 3);
+        pool.deallocate(x);
+        pool.deallocate(y);
+        ASSERT(pool.size() == 1 && count == 2);
+        pool.deallocate(empty);
+        ASSERT(pool.size() == 2 && count == 2);
+
+        // The long strings are not pooled.
+        pool.deallocate(pool.allocate(nullptr, Pool::max_pooled_size + 1));
+        ASSERT(pool.size() == 2 && count == 2);
+        pool.deallocate(nullptr);
+        pool.clear();
+        ASSERT(!pool.size() && !count);
+        pool.deallocate(pool.allocate(u"abc", 3));
+        ASSERT(pool.size() == 1);
+      }
+      ASSERT(!count);
+    }
+
+    // String arena.
+    {
+      com::Basic_string_arena<char16_t> arena{64};
+      ASSERT(!arena.block_count());
+      auto* const abc = arena.allocate(u"abc", 3);
+      auto* const de = arena.allocate(u"de", 2);
+      ASSERT(std::u16string_view{abc} == u"abc" &&
+        com::detail::string_size(abc) == 3);
+      ASSERT(std::u16string_view{de} == u"de" &&
+        com::detail::string_size(de) == 2);
+      ASSERT(reinterpret_cast<std::uintptr_t>(abc) % 4 == 0);
+      ASSERT(reinterpret_cast<std::uintptr_t>(de) % 4 == 0);
+      ASSERT(arena.block_count() == 1);
+      arena.deallocate(abc);
+      ASSERT(std::u16string_view{abc} == u"abc");
+
+      // The strings which don't fit the block get their own ones.
+      auto* const large = arena.allocate(nullptr, 100);
+      ASSERT(com::detail::string_size(large) == 100 && !large[100]);
+      ASSERT(arena.block_count() == 2);
+      arena.clear();
+      ASSERT(!arena.block_count());
+    }
+
+    // Dates.
+    {
+      using namespace std::chrono;
+      ASSERT(com::to_iso8601(com::Date{-1.25}) == "1899-12-29T06:00:00");
+      ASSERT(com::to_iso8601(com::Date{45000.0001}) ==
+        "2023-03-15T00:00:08.640");
+      ASSERT(com::to_date(2024y/1/1d).value == 45292);
+      ASSERT(com::to_year_month_day(com::Date{45292.9}) == 2024y/1/1d);
+      const std::vector<com::Date> dates{{-1.25}, {0}, {45292.5}};
+      std::vector<com::Date_time> times(dates.size());
+      com::to_date_time(dates, times);
+      ASSERT(times[2] == sys_days{2024y/1/1d} + 12h);
+      std::vector<com::Date> dates2(times.size());
+      com::to_date(times, dates2);
+      for (std::size_t i{}; i < dates.size(); ++i)
+        ASSERT(dates2[i].value == dates[i].value);
+      try {
+        com::to_date_time(com::Date{-657435});
+        ASSERT(false);
+      } catch (const std::out_of_range&) {}
+
+      // The range of OLE Automation dates.
+      ASSERT(com::to_iso8601(com::Date{-657434}) == "0100-01-01T00:00:00");
+      ASSERT(com::to_iso8601(com::Date{2958465.99999}) ==
+        "9999-12-31T23:59:59.136");
+      ASSERT(com::to_date(sys_days{100y/1/1d}).value == -657434);
+      try {
+        com::to_date(sys_days{10000y/1/1d});
+        ASSERT(false);
+      } catch (const std::out_of_range&) {}
+      try {
+        com::to_date(2024y/2/30d);
+        ASSERT(false);
+      } catch (const std::out_of_range&) {}
+      try {
+        std::vector<com::Date_time> result(1);
+        com::to_date_time(dates, result);
+        ASSERT(false);
+      } catch (const std::invalid_argument&) {}
+
+      // The time is measured from midnight in both directions.
+      const auto time = com::to_date_time(com::Date{-2.5});
+      ASSERT(time == sys_days{1899y/12/28d} + 12h);
+      ASSERT(com::to_date(time).value == -2.5);
+    }
+
+    // Decimals and currency.
+    {
+      const com::Decimal dec{150, 0, 2, true};
+      ASSERT(com::to_string(dec) == "-1.5");
+      ASSERT(dec == com::Decimal(15, 0, 1, true));
+      ASSERT(com::to_string(dec + com::Decimal{3}) == "1.5");
+      ASSERT(com::to_string(com::Decimal{135, 0, 2}.rescaled(1)) == "1.4");
+      ASSERT(com::to_string(com::Decimal{125, 0, 2}.rescaled(1)) == "1.2");
+      ASSERT(com::to_string(com::Currency{-12345}) == "-1.2345");
+      ASSERT(com::to_currency(dec) == com::Currency{-15000});
+      ASSERT(com::to_decimal(com::Currency{-15000}) == dec);
+      static_assert(com::Decimal{1} + com::Decimal{2} == com::Decimal{3});
+      static_assert(com::Decimal{1, 0, 1} < com::Decimal{11, 0, 2});
+      ASSERT(com::Decimal(0, 0, 0, true) == com::Decimal{});
+      ASSERT(com::to_string(com::Decimal(0, 0, 3, true)) == "0");
+
+      // The 96-bit limits.
+      const com::Decimal max{~std::uint64_t{}, ~std::uint32_t{}, 0};
+      ASSERT(com::to_string(max) == "79228162514264337593543950335");
+      ASSERT(com::to_string(-max) == "-79228162514264337593543950335");
+      try {
+        max + com::Decimal{1};
+        ASSERT(false);
+      } catch (const std::overflow_error&) {}
+      const com::Decimal third{~std::uint64_t{}, ~std::uint32_t{},
+        com::Decimal::max_scale};
+      ASSERT((third + third).scale() == com::Decimal::max_scale - 1);
+      try {
+        com::to_currency(max);
+        ASSERT(false);
+      } catch (const std::overflow_error&) {}
+
+      // The currency limits.
+      using Limits = std::numeric_limits<std::int64_t>;
+      ASSERT(com::to_string(com::Currency{Limits::min()}) ==
+        "-922337203685477.5808");
+      ASSERT(com::Currency::from_units(12, 3400) == com::Currency{123400});
+      ASSERT(com::to_string(com::Currency::from_units(12, 3400)) == "12.34");
+      try {
+        com::Currency{Limits::max()} + com::Currency{1};
+        ASSERT(false);
+      } catch (const std::overflow_error&) {}
+      try {
+        -com::Currency{Limits::min()};
+        ASSERT(false);
+      } catch (const std::overflow_error&) {}
+
+      const std::vector<com::Decimal> decs{dec, com::Decimal{7}};
+      std::vector<double> reals(decs.size());
+      com::to_double(decs, reals);
+      ASSERT(reals[0] == -1.5 && reals[1] == 7);
+      const std::vector<com::Currency> amounts{{-15000}, {70000}};
+      com::to_double(amounts, reals);
+      ASSERT(reals[0] == -1.5 && reals[1] == 7);
+    }
+
+    // GUIDs.
+    {
+      constexpr auto id =
+        com::to_guid("{0002df01-0000-0000-C000-000000000046}");
+      static_assert(id.data1 == 0x0002DF01 && id.data2 == 0 && id.data3 == 0);
+      static_assert(id.data4[0] == 0xC0 && id.data4[7] == 0x46);
+      static_assert(com::to_guid(u"0002DF01-0000-0000-C000-000000000046") ==
+        id);
+      const auto str = com::to_guid_string(id);
+      ASSERT(std::wstring_view{str.data()} ==
+        L"{0002DF01-0000-0000-C000-000000000046}");
+      ASSERT(std::u16string_view{com::to_guid_string<char16_t>(id).data()} ==
+        u"{0002DF01-0000-0000-C000-000000000046}");
+      ASSERT(com::to_guid(str.data()) == id);
+
+      const auto id2 = com::to_guid(L"0002DF02-0000-0000-C000-000000000046");
+      ASSERT(id < id2);
+      ASSERT(std::hash<com::Guid>{}(id) != std::hash<com::Guid>{}(id2));
+      ASSERT(com::hash(id) == com::hash(com::to_guid(str.data())));
+
+      for (const auto* const invalid : {"",
+          "{0002DF01-0000-0000-C000-000000000046",
+          "(0002DF01-0000-0000-C000-000000000046)",
+          "0002DF01-0000-0000-C000+000000000046",
+          "0002DF0G-0000-0000-C000-000000000046"}) {
+        try {
+          com::to_guid(invalid);
+          ASSERT(false);
+        } catch (const std::invalid_argument&) {}
+      }
+    }
+
+    // Memory resources.
+    {
+      using Resource = winbase::Basic_memory_resource<winbase::Malloc_source>;
+      Resource resource;
+      std::pmr::unsynchronized_pool_resource pool{&resource};
+      std::pmr::vector<double> reals{100, &pool};
+      ASSERT(reals.size() == 100);
+      ASSERT(resource.is_equal(Resource{}));
+      ASSERT(!resource.is_equal(pool));
+
+      // The over-aligned blocks.
+      constexpr std::size_t alignment{4*winbase::Malloc_source::alignment};
+      void* const block{resource.allocate(10, alignment)};
+      ASSERT(reinterpret_cast<std::uintptr_t>(block) % alignment == 0);
+      std::memset(block, 0, 10);
+      resource.deallocate(block, 10, alignment);
+
+      // The buffer released to the code which frees it by std::free().
+      winbase::Basic_outbound_buffer<std::int32_t, winbase::Malloc_source> buf;
+      for (std::int32_t i{}; i < 100; ++i)
+        buf.push_back(i);
+      const std::int32_t tail[]{7, 8};
+      buf.append(tail);
+      ASSERT(buf.size() == 102 && buf.data()[101] == 8);
+      buf.resize(105);
+      ASSERT(buf.size() == 105 && !buf.data()[104]);
+      buf.shrink_to_fit();
+      ASSERT(buf.capacity() == 105);
+      auto buf2 = std::move(buf);
+      ASSERT(!buf.data() && !buf.size() && buf2.size() == 105);
+      auto* const data = buf2.release();
+      ASSERT(data[99] == 99 && !buf2.data() && !buf2.capacity());
+      std::free(data);
+
+      // The elements of the buffer itself can be appended.
+      buf.push_back(1);
+      buf.shrink_to_fit();
+      buf.push_back(buf.data()[0]);
+      ASSERT(buf.size() == 2 && buf.data()[1] == 1);
+      buf.shrink_to_fit();
+      buf.append(buf.span());
+      buf.append(buf.span().subspan(1));
+      ASSERT(buf.size() == 7);
+      for (std::size_t i{}; i < buf.size(); ++i)
+        ASSERT(buf.data()[i] == 1);
+    }
+  } catch (const std::exception& e) {
+    std::clog << "error: " << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::clog << "unknown error" << std::endl;
+    return 2;
+  }
+}
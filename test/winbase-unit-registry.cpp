@@ -0,0 +1,695 @@
+// -*- C++ -*-
+//
+// Copyright 2024 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../../base/assert.hpp"
+#include "../registry_async.hpp"
+#include "../registry_batch.hpp"
+#include "../registry_hive.hpp"
+#include "../registry_image.hpp"
+#include "../registry_memory.hpp"
+#include "../registry_text.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#define ASSERT DMITIGR_ASSERT
+
+namespace {
+
+namespace reg = dmitigr::winbase::registry;
+
+std::vector<std::byte> utf16(const std::wstring_view str)
+{
+  std::vector<std::byte> result;
+  for (const wchar_t ch : str) {
+    result.push_back(static_cast<std::byte>(ch & 0xff));
+    result.push_back(static_cast<std::byte>(ch >> 8 & 0xff));
+  }
+  return result;
+}
+
+std::vector<std::byte> dword(const std::uint32_t value)
+{
+  return {static_cast<std::byte>(value), static_cast<std::byte>(value >> 8),
+    static_cast<std::byte>(value >> 16), static_cast<std::byte>(value >> 24)};
+}
+
+reg::Key_snapshot make_snapshot(const std::uint32_t seed)
+{
+  reg::Key_snapshot::Builder builder;
+  builder.append(L"Version", reg::Value_type::dword, dword(seed));
+  builder.append(L"name", reg::Value_type::sz, utf16(std::wstring_view{L"dmitigr\0", 8}));
+  builder.append(L"List", reg::Value_type::multi_sz,
+    utf16(std::wstring_view{L"one\0two\0\0", 9}));
+  return std::move(builder).finish();
+}
+
+/// A generator of regf hives.
+class Hive_builder final {
+public:
+  Hive_builder()
+    : bytes_(4096 + 32)
+  {}
+
+  /// @returns The offset of the new cell with `data`.
+  std::uint32_t cell(const std::vector<std::byte>& data)
+  {
+    const auto offset = static_cast<std::uint32_t>(bytes_.size() - 4096);
+    const auto size = (4 + data.size() + 7) / 8 * 8;
+    const auto d = dword(static_cast<std::uint32_t>(-static_cast<std::int32_t>(size)));
+    bytes_.insert(bytes_.end(), d.begin(), d.end());
+    bytes_.insert(bytes_.end(), data.begin(), data.end());
+    bytes_.resize(4096 + offset + size);
+    return offset;
+  }
+
+  /// @returns The offset of the new "nk" cell.
+  std::uint32_t key(const std::wstring_view name, const bool is_ascii,
+    const std::uint32_t subkey_count, const std::uint32_t subkeys,
+    const std::uint32_t value_count, const std::uint32_t values)
+  {
+    std::vector<std::byte> d(76);
+    put16(d, 0, u'n' | u'k' << 8);
+    put16(d, 2, is_ascii ? 0x0020 : 0);
+    put(d, 20, subkey_count);
+    put(d, 28, subkeys);
+    put(d, 36, value_count);
+    put(d, 40, values);
+    append_name(d, 72, name, is_ascii);
+    return cell(d);
+  }
+
+  /// @returns The offset of the new "vk" cell.
+  std::uint32_t value(const std::wstring_view name, const reg::Value_type type,
+    const std::vector<std::byte>& data)
+  {
+    std::vector<std::byte> d(20);
+    put16(d, 0, u'v' | u'k' << 8);
+    put16(d, 16, 0x0001);
+    put(d, 12, static_cast<std::uint32_t>(type));
+    const auto size = static_cast<std::uint32_t>(data.size());
+    if (size <= 4) {
+      put(d, 4, size | 0x80000000);
+      std::copy(data.begin(), data.end(), d.begin() + 8);
+    } else if (size > 16344) {
+      std::vector<std::byte> segments;
+      for (std::size_t i{}; i < size; i += 16344) {
+        const auto n = std::min<std::size_t>(16344, size - i);
+        const auto o = dword(cell({data.begin() + i, data.begin() + i + n}));
+        segments.insert(segments.end(), o.begin(), o.end());
+      }
+      std::vector<std::byte> db(8);
+      put16(db, 0, u'd' | u'b' << 8);
+      put16(db, 2, static_cast<std::uint16_t>(segments.size() / 4));
+      put(db, 4, cell(segments));
+      put(d, 4, size);
+      put(d, 8, cell(db));
+    } else {
+      put(d, 4, size);
+      put(d, 8, cell(data));
+    }
+    append_name(d, 2, name, true);
+    return cell(d);
+  }
+
+  /// @returns The offset of the new subkey list of `signature`.
+  std::uint32_t list(const char (&signature)[3],
+    const std::vector<std::pair<std::uint32_t, std::uint32_t>>& entries)
+  {
+    const bool has_hints = signature[1] == 'f' || signature[1] == 'h';
+    std::vector<std::byte> d(4 + entries.size()*(has_hints ? 8 : 4));
+    put16(d, 0, static_cast<std::uint16_t>(signature[0] | signature[1] << 8));
+    put16(d, 2, static_cast<std::uint16_t>(entries.size()));
+    for (std::size_t i{}; i < entries.size(); ++i) {
+      if (has_hints) {
+        put(d, 4 + 8*i, entries[i].first);
+        put(d, 8 + 8*i, entries[i].second);
+      } else
+        put(d, 4 + 4*i, entries[i].first);
+    }
+    return cell(d);
+  }
+
+  /// @returns The offset of the new value list.
+  std::uint32_t values(const std::vector<std::uint32_t>& offsets)
+  {
+    std::vector<std::byte> d;
+    for (const auto o : offsets) {
+      const auto b = dword(o);
+      d.insert(d.end(), b.begin(), b.end());
+    }
+    return cell(d);
+  }
+
+  /// @returns The hive bytes.
+  std::vector<std::byte> finish(const std::uint32_t root) &&
+  {
+    const auto bins_size = (bytes_.size() - 4096 + 4095) / 4096 * 4096;
+    if (const auto free = 4096 + bins_size - bytes_.size()) {
+      const auto d = dword(static_cast<std::uint32_t>(free));
+      bytes_.insert(bytes_.end(), d.begin(), d.end());
+      bytes_.resize(4096 + bins_size);
+    }
+    std::memcpy(bytes_.data(), "regf", 4);
+    put(bytes_, 4, 1);
+    put(bytes_, 8, 1);
+    put(bytes_, 20, 1);
+    put(bytes_, 24, 5);
+    put(bytes_, 32, 1);
+    put(bytes_, 36, root);
+    put(bytes_, 40, static_cast<std::uint32_t>(bins_size));
+    std::memcpy(bytes_.data() + 4096, "hbin", 4);
+    put(bytes_, 4096 + 8, static_cast<std::uint32_t>(bins_size));
+    return std::move(bytes_);
+  }
+
+private:
+  std::vector<std::byte> bytes_;
+
+  static void put(std::vector<std::byte>& d, const std::size_t offset,
+    const std::uint32_t value)
+  {
+    const auto b = dword(value);
+    std::copy(b.begin(), b.end(), d.begin() + offset);
+  }
+
+  static void put16(std::vector<std::byte>& d, const std::size_t offset,
+    const std::uint16_t value)
+  {
+    d[offset] = static_cast<std::byte>(value);
+    d[offset + 1] = static_cast<std::byte>(value >> 8);
+  }
+
+  static void append_name(std::vector<std::byte>& d,
+    const std::size_t size_offset, const std::wstring_view name,
+    const bool is_ascii)
+  {
+    std::vector<std::byte> n;
+    if (is_ascii) {
+      for (const wchar_t ch : name)
+        n.push_back(static_cast<std::byte>(ch));
+    } else
+      n = utf16(name);
+    put16(d, size_offset, static_cast<std::uint16_t>(n.size()));
+    d.insert(d.end(), n.begin(), n.end());
+  }
+};
+
+/// A backend which slows down reads and tracks their concurrency.
+class Slow_backend final : public reg::Backend {
+public:
+  reg::Memory_backend base;
+  std::atomic_int read_count{};
+  std::atomic_int running_count{};
+  std::atomic_int max_running_count{};
+
+  reg::Key_handle root(const reg::Root root) const noexcept override
+  {
+    return base.root(root);
+  }
+
+  reg::Status open_key(const reg::Key_handle key, const wchar_t* const subkey,
+    const reg::Access access, reg::Key_handle& result) override
+  {
+    return base.open_key(key, subkey, access, result);
+  }
+
+  reg::Status create_key(const reg::Key_handle key, const wchar_t* const subkey,
+    const reg::Access access, reg::Key_handle& result, bool& is_created) override
+  {
+    return base.create_key(key, subkey, access, result, is_created);
+  }
+
+  reg::Status close_key(const reg::Key_handle key) noexcept override
+  {
+    return base.close_key(key);
+  }
+
+  reg::Status query_info(const reg::Key_handle key, reg::Key_info& result) override
+  {
+    return base.query_info(key, result);
+  }
+
+  reg::Status enum_key(const reg::Key_handle key, const std::uint32_t index,
+    wchar_t* const name, std::uint32_t& name_size) override
+  {
+    return base.enum_key(key, index, name, name_size);
+  }
+
+  reg::Status enum_value(const reg::Key_handle key, const std::uint32_t index,
+    wchar_t* const name, std::uint32_t& name_size, reg::Value_type& type,
+    std::byte* const data, std::uint32_t& data_size) override
+  {
+    return base.enum_value(key, index, name, name_size, type, data, data_size);
+  }
+
+  reg::Status get_value(const reg::Key_handle key, const wchar_t* const subkey,
+    const wchar_t* const name, reg::Value_type& type, std::byte* const data,
+    std::uint32_t& data_size) override
+  {
+    ++read_count;
+    const int running = ++running_count;
+    for (int max = max_running_count; max < running &&
+      !max_running_count.compare_exchange_weak(max, running););
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    --running_count;
+    return base.get_value(key, subkey, name, type, data, data_size);
+  }
+
+  reg::Status set_value(const reg::Key_handle key, const wchar_t* const name,
+    const reg::Value_type type, const std::byte* const data,
+    const std::uint32_t data_size) override
+  {
+    return base.set_value(key, name, type, data, data_size);
+  }
+
+  reg::Status remove_value(const reg::Key_handle key, const wchar_t* const subkey,
+    const wchar_t* const name) override
+  {
+    return base.remove_value(key, subkey, name);
+  }
+
+  reg::Status remove_key(const reg::Key_handle key,
+    const wchar_t* const subkey) override
+  {
+    return base.remove_key(key, subkey);
+  }
+};
+
+} // namespace
+
+int main()
+{
+  try {
+    // Key snapshot.
+    {
+      const auto snap = make_snapshot(7);
+      ASSERT(snap.size() == 3);
+      ASSERT(snap[0].name == L"List");
+      ASSERT(snap[2].name == L"Version");
+      ASSERT(snap.value<std::uint32_t>(L"VERSION") == 7);
+      ASSERT(snap.value<std::wstring>(L"Name") == L"dmitigr");
+      ASSERT(!snap.value<std::wstring>(L"nonexistent"));
+      const auto list = snap.value<reg::Multi_sz>(L"list");
+      ASSERT(list && list->size() == 2 && *list->begin() == L"one");
+    }
+
+    // Multi_sz.
+    {
+      const reg::Multi_sz list(std::wstring{L"one\0two\0\0three\0\0", 16});
+      ASSERT(list.size() == 2);
+      ASSERT(std::vector<std::wstring_view>(list.begin(), list.end()) ==
+        (std::vector<std::wstring_view>{L"one", L"two"}));
+      ASSERT(list.buffer() == std::wstring(L"one\0two\0\0", 9));
+      ASSERT(reg::Multi_sz(std::wstring{L"\0one\0\0", 6}).is_empty());
+      ASSERT(reg::Multi_sz(std::wstring{L"one", 3}).size() == 1);
+      ASSERT(reg::Multi_sz{}.is_empty() && !reg::Multi_sz{}.size());
+      try {
+        reg::Multi_sz{L"one", L"", L"three"};
+        ASSERT(false);
+      } catch (const std::invalid_argument&) {}
+      try {
+        reg::Multi_sz{std::wstring_view{L"one\0two", 7}};
+        ASSERT(false);
+      } catch (const std::invalid_argument&) {}
+
+      // The registry data may hold the strings past the empty one.
+      reg::Key_snapshot::Builder builder;
+      builder.append(L"List", reg::Value_type::multi_sz,
+        utf16(std::wstring_view{L"a\0\0b\0\0", 6}));
+      const auto snap = std::move(builder).finish();
+      const auto list2 = snap.value<reg::Multi_sz>(L"List");
+      ASSERT(list2->size() == 1);
+      ASSERT(list2->buffer() == std::wstring(L"a\0\0", 3));
+    }
+
+    // Image.
+    {
+      reg::Image_writer writer;
+      writer.add_key(L"Sub\\B", make_snapshot(2));
+      writer.add_key(L"", make_snapshot(0));
+      writer.add_key(L"Sub\\a", make_snapshot(1));
+      const auto bytes = writer.to_bytes();
+      const auto check = [](const reg::Image& image)
+      {
+        ASSERT(image.key_count() == 3);
+        ASSERT(image.key(0).path().empty());
+        ASSERT(image.key(1).path() == L"Sub\\a");
+        ASSERT(image.value<std::uint32_t>(L"sub\\b", L"version") == 2);
+        ASSERT(image.value<std::wstring>(L"SUB\\A", L"name") == L"dmitigr");
+        ASSERT(!image.value<std::uint32_t>(L"Sub\\C", L"Version"));
+        ASSERT(!image.value<std::uint32_t>(L"Sub\\B", L"Other"));
+        const auto root = image.find(L"");
+        ASSERT(root->size() == 3);
+        ASSERT(root->find((*root)[2].name));
+        try {
+          (*root)[root->size()];
+          ASSERT(false);
+        } catch (const std::out_of_range&) {}
+      };
+      check(reg::Image{bytes});
+
+      const auto path = std::filesystem::temp_directory_path() /
+        "dmitigr_winbase_unit_registry.img";
+      writer.write(path);
+      check(reg::Image{path});
+      std::filesystem::remove(path);
+    }
+
+    // Memory backend.
+    {
+      reg::Memory_backend backend;
+      const auto hklm = backend.root(reg::Root::local_machine);
+      ASSERT(!reg::open_key(backend, hklm, L"Software\\dmitigr"));
+      ASSERT(!reg::value<std::uint32_t>(backend, hklm, L"Software", L"Version"));
+      {
+        auto [key, is_created] = reg::create_key(backend, hklm, L"Software\\dmitigr");
+        ASSERT(key && is_created);
+        ASSERT(!reg::create_key(backend, hklm, L"SOFTWARE\\Dmitigr").second);
+        reg::set_value(backend, key, L"Version", std::uint32_t{3});
+        reg::set_value(backend, key, L"Name", std::wstring{L"winbase"});
+        reg::set_value(backend, key, L"List", reg::Multi_sz{L"a", L"b"});
+        reg::set_value(backend, key, L"version", std::uint32_t{4});
+      }
+      ASSERT(reg::value<std::uint32_t>(backend, hklm, L"software\\DMITIGR", L"VERSION") == 4);
+      ASSERT(reg::value<std::wstring>(backend, hklm, L"Software\\dmitigr", L"name") == L"winbase");
+      ASSERT(reg::value<reg::Multi_sz>(backend, hklm, L"Software\\dmitigr", L"List")->size() == 2);
+      try {
+        reg::value<std::wstring>(backend, hklm, L"Software\\dmitigr", L"Version");
+        ASSERT(false);
+      } catch (const std::system_error& e) {
+        ASSERT(e.code().value() == static_cast<int>(reg::Status::unsupported_type));
+        ASSERT(e.code() == reg::Status::unsupported_type);
+        ASSERT(e.code().category() == reg::error_category());
+        ASSERT(e.code() == std::errc::not_supported);
+      }
+
+      const auto key = reg::open_key(backend, hklm, L"Software\\dmitigr");
+      ASSERT(key);
+      const auto snap = reg::snapshot(backend, key);
+      ASSERT(snap.size() == 3 && snap[2].name == L"Version");
+      ASSERT(reg::subkey_names(backend, hklm) == std::vector<std::wstring>{L"Software"});
+
+      reg::remove_value(backend, hklm, L"Software\\dmitigr", L"List");
+      reg::remove_value(backend, hklm, L"Software\\dmitigr", L"List");
+      ASSERT(!reg::value<reg::Multi_sz>(backend, key, nullptr, L"List"));
+      try {
+        reg::remove_key(backend, hklm, L"Software");
+        ASSERT(false);
+      } catch (const std::system_error& e) {
+        ASSERT(e.code() == reg::Status::access_denied);
+        ASSERT(e.code() == std::errc::permission_denied);
+        ASSERT(e.code().message() == "access denied");
+      }
+      reg::remove_key(backend, hklm, L"Software\\dmitigr");
+      ASSERT(!reg::open_key(backend, hklm, L"Software\\dmitigr"));
+      std::uint32_t size{};
+      reg::Value_type type{};
+      ASSERT(backend.get_value(key, nullptr, L"Version", type, nullptr, size) ==
+        reg::Status::key_deleted);
+
+      std::vector<std::thread> threads;
+      for (std::uint32_t t{}; t < 4; ++t) {
+        threads.emplace_back([&backend, hklm, t]
+        {
+          const auto name = L"Thread" + std::to_wstring(t);
+          for (std::uint32_t i{}; i < 100; ++i) {
+            const auto key = reg::create_key(backend, hklm, name.c_str()).first;
+            reg::set_value(backend, key, L"Counter", i);
+            ASSERT(reg::value<std::uint32_t>(backend, key, nullptr, L"Counter") == i);
+          }
+        });
+      }
+      for (auto& thread : threads)
+        thread.join();
+      ASSERT(reg::subkey_names(backend, hklm).size() == 5);
+    }
+
+    // Batch.
+    {
+      reg::Memory_backend backend;
+      const auto hkcu = backend.root(reg::Root::current_user);
+      reg::set_value(backend,
+        reg::create_key(backend, hkcu, L"Software\\Old\\Sub").first,
+        L"Value", std::uint32_t{1});
+
+      reg::Batch batch;
+      batch.set_value(L"Software\\Old\\Sub", L"Value", std::uint32_t{2})
+        .remove_key(L"software\\old")
+        .set_value(L"Software\\New", L"Version", std::uint32_t{1})
+        .set_value(L"Software\\\\New\\", L"VERSION", std::uint32_t{2})
+        .set_value(L"Software\\New\\Sub", L"Name", std::wstring{L"winbase"})
+        .remove_value(L"Software\\New\\Sub", L"Missing")
+        .create_key(L"Software\\Empty");
+      ASSERT(!batch.is_empty());
+      ASSERT(batch.size() == 7);
+      batch.apply(backend, hkcu);
+
+      ASSERT(!reg::open_key(backend, hkcu, L"Software\\Old"));
+      ASSERT(reg::open_key(backend, hkcu, L"Software\\Empty"));
+      ASSERT(reg::value<std::uint32_t>(backend, hkcu, L"Software\\New", L"Version") == 2);
+      ASSERT(reg::value<std::wstring>(backend, hkcu, L"Software\\New\\Sub", L"Name") == L"winbase");
+      batch.clear();
+      ASSERT(batch.is_empty() && !batch.size());
+    }
+
+    // .reg text.
+    {
+      const auto utf16 = [](const std::wstring_view str)
+      {
+        std::string result{"\xff\xfe", 2};
+        for (const auto ch : str) {
+          result.push_back(static_cast<char>(ch & 0xff));
+          result.push_back(static_cast<char>(ch >> 8 & 0xff));
+        }
+        return result;
+      };
+      const auto is_equal = [](const reg::Key_snapshot& lhs,
+        const reg::Key_snapshot& rhs)
+      {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+          [](const auto& l, const auto& r)
+          {
+            return l.name == r.name && l.type == r.type &&
+              std::ranges::equal(l.data, r.data);
+          });
+      };
+
+      reg::Memory_backend backend;
+      const auto hkcu = backend.root(reg::Root::current_user);
+      const auto hklm = backend.root(reg::Root::local_machine);
+      reg::create_key(backend, hkcu, L"Software\\Old\\Sub");
+      reg::set_value(backend, reg::create_key(backend, hklm,
+        L"Software\\dmitigr").first, L"Gone", std::uint32_t{1});
+
+      std::istringstream input{utf16(LR"(Windows Registry Editor Version 5.00
+
+; Comment.
+[HKEY_CURRENT_USER\Software\dmitigr]
+@="default"
+"Path"="C:\\Program Files\\\"dmitigr\""
+"Version"=dword:0000001f
+"List"=hex(7):61,00,00,00,62,00,\
+  00,00,00,00
+"Blob"=hex:01,02,\
+   03
+
+[-HKEY_CURRENT_USER\Software\Old]
+"Ignored"="x"
+
+[HKLM\Software\dmitigr]
+"Gone"=-
+)")};
+      ASSERT(reg::import_text(input, backend) == 9);
+      const auto* const sub = L"Software\\dmitigr";
+      ASSERT(reg::value<std::wstring>(backend, hkcu, sub, L"") == L"default");
+      ASSERT(reg::value<std::wstring>(backend, hkcu, sub, L"Path") ==
+        LR"(C:\Program Files\"dmitigr")");
+      ASSERT(reg::value<std::uint32_t>(backend, hkcu, sub, L"Version") == 31);
+      ASSERT(reg::value<reg::Multi_sz>(backend, hkcu, sub, L"List")->size() == 2);
+      ASSERT(reg::value<std::vector<std::byte>>(backend, hkcu, sub, L"Blob")->size() == 3);
+      ASSERT(!reg::open_key(backend, hkcu, L"Software\\Old"));
+      ASSERT(!reg::value<std::uint32_t>(backend, hklm, sub, L"Gone"));
+
+      {
+        const auto key = reg::open_key(backend, hkcu, sub);
+        reg::set_value(backend, key, L"Long", std::vector<std::byte>(300, std::byte{0xab}));
+        reg::set_value(backend, key, L"Lines", std::wstring{L"a\r\nb"});
+        reg::set_value(backend, key, L"Big", std::uint64_t{1} << 40);
+        reg::set_value(backend, reg::create_key(backend, key, L"Child").first,
+          L"Expand", reg::Expand_sz{L"%TEMP%"});
+      }
+      std::stringstream text;
+      reg::export_text(text, backend, reg::Root::current_user, L"Software");
+      reg::Memory_backend copy;
+      const auto copy_hkcu = copy.root(reg::Root::current_user);
+      ASSERT(reg::import_text(text, copy) == 12);
+      for (const auto* const path : {sub, L"Software\\dmitigr\\Child"}) {
+        const auto key = reg::open_key(backend, hkcu, path);
+        const auto copy_key = reg::open_key(copy, copy_hkcu, path);
+        ASSERT(copy_key);
+        ASSERT(is_equal(reg::snapshot(backend, key), reg::snapshot(copy, copy_key)));
+      }
+
+      std::istringstream ansi{"REGEDIT4\r\n\r\n[HKEY_USERS\\x]\r\n\"a\"=\"b\"\r\n"};
+      ASSERT(reg::import_text(ansi, copy) == 2);
+      ASSERT(reg::value<std::wstring>(copy, copy.root(reg::Root::users), L"x", L"a") == L"b");
+    }
+
+    // Async executor.
+    {
+      Slow_backend backend;
+      const auto hklm = backend.root(reg::Root::local_machine);
+      const auto key = reg::create_key(backend, hklm, L"Software\\dmitigr").first;
+      for (std::uint32_t i{}; i < 6; ++i)
+        reg::set_value(backend, key, (L"Value" + std::to_wstring(i)).c_str(), i);
+
+      reg::Async_executor executor{backend, 4, 2};
+      {
+        std::vector<std::shared_future<std::optional<std::uint32_t>>> futures;
+        for (int i{}; i < 10; ++i)
+          futures.push_back(executor.value<std::uint32_t>(L"a", hklm,
+            L"Software\\dmitigr", L"VALUE1"));
+        for (const auto& f : futures)
+          ASSERT(f.get() == 1);
+        ASSERT(backend.read_count == 1);
+      }
+      {
+        std::vector<std::shared_future<std::optional<std::uint32_t>>> futures;
+        for (std::uint32_t i{}; i < 6; ++i)
+          futures.push_back(executor.value<std::uint32_t>(L"b", key, {},
+            L"Value" + std::to_wstring(i)));
+        for (std::uint32_t i{}; i < 6; ++i)
+          ASSERT(futures[i].get() == i);
+        ASSERT(backend.max_running_count <= 2);
+      }
+      executor.set_value(L"", key, L"Name", std::wstring{L"winbase"}).get();
+      ASSERT(executor.value<std::wstring>(L"", key, {}, L"Name").get() == L"winbase");
+      ASSERT(executor.snapshot(L"", hklm, L"Software\\dmitigr").get().size() == 7);
+      try {
+        executor.snapshot(L"", hklm, L"Software\\Missing").get();
+        ASSERT(false);
+      } catch (const std::system_error& e) {
+        ASSERT(e.code().value() == static_cast<int>(reg::Status::file_not_found));
+      }
+      ASSERT(executor.open_key(L"", hklm, L"Software").get());
+      ASSERT(!executor.open_key(L"", hklm, L"Missing").get());
+    }
+
+    // Hive.
+    {
+      Hive_builder builder;
+      const auto alpha = builder.key(L"Alpha", false, 0, 0, 0, 0);
+      const auto beta = builder.key(L"Beta", true, 0, 0, 0, 0);
+      const auto software_subkeys = builder.list("ri", {
+          {builder.list("li", {{alpha, 0}}), 0},
+          {builder.list("lf", {{beta, 0}}), 0}});
+      std::vector<std::byte> big(40000);
+      for (std::size_t i{}; i < big.size(); ++i)
+        big[i] = static_cast<std::byte>(i % 251);
+      const auto software_values = builder.values({
+          builder.value(L"Version", reg::Value_type::dword, dword(7)),
+          builder.value(L"Name", reg::Value_type::sz,
+            utf16(std::wstring_view{L"winbase\0", 8})),
+          builder.value(L"Big", reg::Value_type::binary, big),
+          builder.value(L"", reg::Value_type::sz, utf16(std::wstring_view{L"\0", 1}))});
+      const auto software = builder.key(L"Software", true, 2, software_subkeys,
+        4, software_values);
+      const auto cyrillic = builder.key(L"Ключ", false, 0, 0, 0, 0);
+      const auto root = builder.key(L"ROOT", true, 2, builder.list("lh", {
+            {software, reg::detail::hive_name_hash(L"Software")},
+            {cyrillic, reg::detail::hive_name_hash(L"Ключ")}}), 0, 0);
+      const auto bytes = std::move(builder).finish(root);
+
+      const auto check = [&big](const reg::Hive& hive)
+      {
+        ASSERT(!hive.is_dirty() && hive.minor_version() == 5);
+        ASSERT(hive.root().name() == L"ROOT");
+        ASSERT(hive.root().subkeys().size() == 2);
+        ASSERT(hive.find(L"software\\ALPHA")->name() == L"Alpha");
+        ASSERT(hive.find(L"\\Software\\Beta\\")->name() == L"Beta");
+        ASSERT(!hive.find(L"Software\\Gamma"));
+        ASSERT(!hive.find(L"Software\\Beta\\Gamma"));
+        ASSERT(hive.find(L"КЛЮЧ"));
+
+        const auto key = hive.find(L"Software");
+        ASSERT(key && key->size() == 4 && key->subkey_count() == 2);
+        ASSERT((*key)[1].name() == L"Name");
+        ASSERT(!key->find(L"Missing"));
+        ASSERT(hive.value<std::uint32_t>(L"Software", L"version") == 7);
+        ASSERT(hive.value<std::wstring>(L"Software", L"Name") == L"winbase");
+        ASSERT(hive.value<std::wstring>(L"Software", L"")->empty());
+        ASSERT(hive.value<std::vector<std::byte>>(L"Software", L"Big") == big);
+        std::vector<std::byte> buffer;
+        ASSERT(key->find(L"Name")->data(buffer).size() == 16 && buffer.empty());
+      };
+      check(reg::Hive{bytes});
+
+      const auto path = std::filesystem::temp_directory_path() /
+        "dmitigr_winbase_unit_registry.hiv";
+      {
+        std::ofstream file{path, std::ios_base::binary | std::ios_base::trunc};
+        file.write(reinterpret_cast<const char*>(bytes.data()),
+          static_cast<std::streamsize>(bytes.size()));
+      }
+      check(reg::Hive{path});
+      std::filesystem::remove(path);
+
+      auto corrupted = bytes;
+      corrupted[36] = std::byte{0xff};
+      try {
+        reg::Hive{corrupted}.root();
+        ASSERT(false);
+      } catch (const std::runtime_error&) {}
+
+      // The counts and sizes stored in the hive are not trusted.
+      Hive_builder hostile_builder;
+      const auto gamma = hostile_builder.key(L"Gamma", true, 0, 0, 0, 0);
+      const auto huge = hostile_builder.value(L"Huge", reg::Value_type::binary,
+        big);
+      const auto hostile_root = hostile_builder.key(L"ROOT", true, 0xFFFFFFFF,
+        hostile_builder.list("lh", {{gamma, reg::detail::hive_name_hash(L"Gamma")}}),
+        1, hostile_builder.values({huge}));
+      auto hostile = std::move(hostile_builder).finish(hostile_root);
+      const auto huge_size = dword(0x7FFFFFFF);
+      std::copy(huge_size.begin(), huge_size.end(),
+        hostile.begin() + 4096 + huge + 8);
+      const reg::Hive hostile_hive{hostile};
+      ASSERT(hostile_hive.root().subkeys().size() == 1);
+      ASSERT(hostile_hive.find(L"gamma"));
+      try {
+        std::vector<std::byte> buffer;
+        hostile_hive.root()[0].data(buffer);
+        ASSERT(false);
+      } catch (const std::runtime_error&) {}
+    }
+  } catch (const std::exception& e) {
+    std::clog << "error: " << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::clog << "unknown error" << std::endl;
+    return 2;
+  }
+}
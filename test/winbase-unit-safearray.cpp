@@ -18,9 +18,211 @@
 #include "../combase.hpp"
 
 #include <iostream>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #define ASSERT DMITIGR_ASSERT
 
+/// The type information which provides the GUID of the type only.
+class Test_type_info final : public ITypeInfo {
+public:
+  ULONG refs{1};
+  TYPEATTR attr{};
+
+  explicit Test_type_info(const GUID& guid)
+  {
+    attr.guid = guid;
+  }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** result) override
+  {
+    *result = nullptr;
+    return E_NOINTERFACE;
+  }
+
+  ULONG STDMETHODCALLTYPE AddRef() override
+  {
+    return ++refs;
+  }
+
+  ULONG STDMETHODCALLTYPE Release() override
+  {
+    return --refs;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetTypeAttr(TYPEATTR** const result) override
+  {
+    *result = &attr;
+    return S_OK;
+  }
+
+  void STDMETHODCALLTYPE ReleaseTypeAttr(TYPEATTR*) override
+  {}
+
+  HRESULT STDMETHODCALLTYPE GetTypeComp(ITypeComp**) override
+  {
+    return E_NOTIMPL;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetFuncDesc(UINT, FUNCDESC**) override
+  {
+    return E_NOTIMPL;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetVarDesc(UINT, VARDESC**) override
+  {
+    return E_NOTIMPL;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetNames(MEMBERID, BSTR*, UINT, UINT*) override
+  {
+    return E_NOTIMPL;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetRefTypeOfImplType(UINT, HREFTYPE*) override
+  {
+    return E_NOTIMPL;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetImplTypeFlags(UINT, INT*) override
+  {
+    return E_NOTIMPL;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetIDsOfNames(LPOLESTR*, UINT, MEMBERID*) override
+  {
+    return E_NOTIMPL;
+  }
+
+  HRESULT STDMETHODCALLTYPE Invoke(PVOID, MEMBERID, WORD, DISPPARAMS*,
+    VARIANT*, EXCEPINFO*, UINT*) override
+  {
+    return E_NOTIMPL;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetDocumentation(MEMBERID, BSTR*, BSTR*, DWORD*,
+    BSTR*) override
+  {
+    return E_NOTIMPL;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetDllEntry(MEMBERID, INVOKEKIND, BSTR*, BSTR*,
+    WORD*) override
+  {
+    return E_NOTIMPL;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetRefTypeInfo(HREFTYPE, ITypeInfo**) override
+  {
+    return E_NOTIMPL;
+  }
+
+  HRESULT STDMETHODCALLTYPE AddressOfMember(MEMBERID, INVOKEKIND,
+    PVOID*) override
+  {
+    return E_NOTIMPL;
+  }
+
+  HRESULT STDMETHODCALLTYPE CreateInstance(IUnknown*, REFIID, PVOID*) override
+  {
+    return E_NOTIMPL;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetMops(MEMBERID, BSTR*) override
+  {
+    return E_NOTIMPL;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetContainingTypeLib(ITypeLib**, UINT*) override
+  {
+    return E_NOTIMPL;
+  }
+
+  void STDMETHODCALLTYPE ReleaseFuncDesc(FUNCDESC*) override
+  {}
+
+  void STDMETHODCALLTYPE ReleaseVarDesc(VARDESC*) override
+  {}
+};
+
+/**
+ * The object with property `Value` and method `Sub(a, b)`, with the type info
+ * if `type` is not null.
+ */
+class Test_dispatch final : public IDispatch {
+public:
+  ULONG refs{1};
+  LONG value{};
+  int lookup_count{};
+  ITypeInfo* type{};
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** result) override
+  {
+    *result = nullptr;
+    return E_NOINTERFACE;
+  }
+
+  ULONG STDMETHODCALLTYPE AddRef() override
+  {
+    return ++refs;
+  }
+
+  ULONG STDMETHODCALLTYPE Release() override
+  {
+    return --refs;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetTypeInfoCount(UINT* const count) override
+  {
+    *count = type ? 1 : 0;
+    return S_OK;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetTypeInfo(UINT, LCID,
+    ITypeInfo** const result) override
+  {
+    if (!type)
+      return E_NOTIMPL;
+    type->AddRef();
+    *result = type;
+    return S_OK;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetIDsOfNames(REFIID, LPOLESTR* const names,
+    UINT, LCID, DISPID* const ids) override
+  {
+    ++lookup_count;
+    const std::wstring_view name{names[0]};
+    if (name == L"Value")
+      *ids = 1;
+    else if (name == L"Sub")
+      *ids = 2;
+    else
+      return DISP_E_UNKNOWNNAME;
+    return S_OK;
+  }
+
+  HRESULT STDMETHODCALLTYPE Invoke(const DISPID id, REFIID, LCID,
+    const WORD flags, DISPPARAMS* const params, VARIANT* const result,
+    EXCEPINFO*, UINT*) override
+  {
+    if (id == 1 && flags == DISPATCH_PROPERTYPUT)
+      value = params->rgvarg[0].lVal;
+    else if (id == 1 && flags == DISPATCH_PROPERTYGET) {
+      result->vt = VT_I4;
+      result->lVal = value;
+    } else if (id == 2 && params->cArgs == 2) {
+      result->vt = VT_I4;
+      result->lVal = params->rgvarg[1].lVal - params->rgvarg[0].lVal;
+    } else
+      return DISP_E_MEMBERNOTFOUND;
+    return S_OK;
+  }
+};
+
 int main()
 {
   try {
@@ -50,6 +252,167 @@ int main()
     com::Variant v{var[3]};
     auto s = com::to<std::int64_t>(v);
     ASSERT(s == 41);
+
+    // Bulk conversions.
+    {
+      const std::vector<std::int32_t> ints{1, -2, 3};
+      const auto arr = com::to_safe_array(ints);
+      ASSERT(arr.vartype() == VT_I4);
+      ASSERT(com::to_vector<std::int32_t>(arr) == ints);
+      ASSERT(arr.lock_count() == 0);
+
+      const std::vector<std::string> strs{"abc", "", "\xd0\xbf\xd1\x80\xd0\xb8"};
+      const auto bstrs = com::to_safe_array(strs);
+      ASSERT(bstrs.vartype() == VT_BSTR);
+      ASSERT(com::to_vector<std::string>(bstrs) == strs);
+      ASSERT(com::to_vector<std::wstring>(bstrs)[2].size() == 3);
+      const auto arena = com::to_utf8_arena(bstrs);
+      ASSERT(arena.size() == strs.size());
+      for (std::size_t i{}; i < strs.size(); ++i)
+        ASSERT(arena[i] == strs[i]);
+      try {
+        com::to_vector<double>(bstrs);
+        ASSERT(false);
+      } catch (const std::runtime_error&) {}
+    }
+
+    // Decimals.
+    {
+      const std::vector<com::Decimal> decs{com::Decimal{150, 0, 2, true},
+        com::Decimal{7}};
+      const auto arr = com::to_safe_array(std::span{decs});
+      ASSERT(arr.vartype() == VT_DECIMAL);
+      ASSERT(com::to_vector<com::Decimal>(arr) == decs);
+    }
+
+    // Binary codec.
+    {
+      com::Safe_array reals{VT_R8, {{.cElements = 3, .lLbound = 1},
+          {.cElements = 2, .lLbound = 0}}};
+      {
+        auto md = reals.md_view<double, 2>();
+        md.at(3, 1) = 42;
+      }
+      com::Variant str;
+      str.data().vt = VT_BSTR;
+      str.data().bstrVal = SysAllocString(L"abc");
+
+      com::Binary_writer writer;
+      com::encode(writer, reals);
+      com::encode(writer, str);
+      const std::string bytes{writer.release()};
+
+      com::Binary_reader reader{bytes};
+      const auto reals2 = com::decode_safe_array(reader);
+      ASSERT(reals2.dimension_count() == 2);
+      ASSERT(com::to_vector<double>(reals2) == com::to_vector<double>(reals));
+      const com::Binary_variant_view str2{reader};
+      ASSERT(str2.value().as_wstring() == L"abc");
+      ASSERT(reader.is_end());
+
+      com::Binary_reader truncated{std::string_view{bytes}.substr(0, 16)};
+      try {
+        com::decode_variant(truncated);
+        ASSERT(false);
+      } catch (const std::runtime_error&) {}
+    }
+
+    // GUIDs.
+    {
+      constexpr auto id =
+        com::to_guid("{0002df01-0000-0000-C000-000000000046}");
+      const auto str = com::to_guid_string(id);
+      const GUID native{com::to_com_guid(id)};
+      ASSERT(com::to_guid(native) == id);
+      ASSERT(std::wstring_view{com::to_com_string(native).value()} ==
+        str.data());
+      ASSERT(com::server_registry_root(native) ==
+        std::wstring{LR"(SOFTWARE\Classes\CLSID\)"}.append(str.data()));
+    }
+
+    // Memory resources.
+    {
+      std::pmr::vector<char> chars{com::taskmem_resource()};
+      chars.assign(1000, 'x');
+      ASSERT(com::taskmem_resource()->is_equal(com::Taskmem_resource{}));
+
+      com::Taskmem_buffer<std::int32_t> buf;
+      for (std::int32_t i{}; i < 100; ++i)
+        buf.push_back(i);
+      const std::int32_t tail[]{7, 8};
+      buf.append(tail);
+      ASSERT(buf.size() == 102 && buf.data()[101] == 8);
+      const com::Taskmem<std::int32_t> mem{buf.release()};
+      ASSERT(mem.value()[99] == 99 && !buf.data());
+    }
+
+    // IDispatch.
+    {
+      Test_dispatch object;
+      com::Dispid_cache cache;
+      {
+        com::Dispatcher dispatcher{object, cache};
+        com::Dispatch_arguments args;
+        args.push_back(com::Native_variant{10});
+        args.push_back(com::Native_variant{3});
+        ASSERT(dispatcher.call(L"Sub", args).as_int32() == 7);
+        ASSERT(dispatcher.call(L"Sub", args).as_int32() == 7);
+        ASSERT(object.lookup_count == 1 && cache.size() == 1);
+
+        com::Dispatch_batch batch;
+        batch.add(dispatcher.dispid(L"Value"), DISPATCH_PROPERTYPUT)
+          .arg(com::Native_variant{42});
+        batch.add(dispatcher.dispid(L"Value"), DISPATCH_PROPERTYGET);
+        dispatcher.invoke(batch);
+        ASSERT(batch.results()[1].as_int32() == 42);
+        try {
+          dispatcher.get(L"Unknown");
+          ASSERT(false);
+        } catch (const std::runtime_error&) {}
+      }
+      cache.clear();
+      ASSERT(object.refs == 1);
+
+      // The objects of the same type share the DISPIDs even if they provide
+      // distinct instances of the type info.
+      const GUID guid{0x0002DF01, 0, 0, {0xC0, 0, 0, 0, 0, 0, 0, 0x46}};
+      Test_type_info type1{guid}, type2{guid};
+      Test_dispatch object1, object2;
+      object1.type = &type1;
+      object2.type = &type2;
+      {
+        com::Dispatcher dispatcher1{object1, cache};
+        com::Dispatcher dispatcher2{object2, cache};
+        ASSERT(dispatcher1.dispid(L"Value") == 1);
+        ASSERT(dispatcher2.dispid(L"Value") == 1);
+        ASSERT(object1.lookup_count == 1 && !object2.lookup_count);
+        ASSERT(cache.size() == 1);
+      }
+      ASSERT(object1.refs == 1 && object2.refs == 1);
+      ASSERT(type1.refs == 1 && type2.refs == 1);
+    }
+
+    // Native variant.
+    {
+      using com::Native_variant;
+      static_assert(sizeof(Native_variant) <= 32);
+      const Native_variant values[]{{}, 42, 2.5, true, "short",
+        std::string(Native_variant::inline_capacity + 1, 'x')};
+      for (const auto& value : values) {
+        const auto var = com::to_variant(value);
+        ASSERT(var.type() == static_cast<VARENUM>(value.type()));
+        ASSERT(com::to_native_variant(var) == value);
+      }
+
+      LONG referenced{7};
+      VARIANT byref{};
+      byref.vt = VT_BYREF | VT_I4;
+      byref.plVal = &referenced;
+      try {
+        com::to_native_variant(com::Const_variant_view{byref});
+        ASSERT(false);
+      } catch (const std::runtime_error&) {}
+    }
   } catch (const std::exception& e) {
     std::clog << "error: " << e.what() << std::endl;
     return 1;
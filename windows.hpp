@@ -35,9 +35,16 @@
 #include <Windows.h>
 
 #include <string>
+#include <string_view>
 
 namespace dmitigr::winbase {
 
+/// The string of `WCHAR`. (It's `std::wstring` on Windows.)
+using Wstring = std::basic_string<WCHAR>;
+
+/// The view of string of `WCHAR`. (It's `std::wstring_view` on Windows.)
+using Wstring_view = std::basic_string_view<WCHAR>;
+
 DWORD last_error() noexcept;
 std::wstring system_message_w(DWORD);
 std::string system_message(DWORD);